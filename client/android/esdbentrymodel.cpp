@@ -0,0 +1,118 @@
+#include "esdbentrymodel.h"
+#include "esdb.h"
+
+EsdbEntryModel::EsdbEntryModel(QList<esdbEntry *> *entries) :
+	m_entries(entries),
+	m_fetched(0)
+{
+}
+
+QVariant EsdbEntryModel::data(const QModelIndex &index, int role) const
+{
+	if (index.row() >= m_fetched) {
+		return QVariant();
+	}
+	esdbEntry *entry = m_entries->at(index.row());
+	switch (role) {
+	case Qt::DisplayRole:
+	case TitleRole:
+		return entry->getTitle();
+	case PathRole:
+		return entry->getPath();
+	default:
+		break;
+	}
+	return QVariant();
+}
+
+int EsdbEntryModel::rowCount(const QModelIndex &parent) const
+{
+	if (parent.isValid()) {
+		return 0;
+	}
+	return m_fetched;
+}
+
+QHash<int, QByteArray> EsdbEntryModel::roleNames() const
+{
+	QHash<int, QByteArray> roles;
+	roles[Qt::DisplayRole] = "display";
+	roles[TitleRole] = "title";
+	roles[PathRole] = "path";
+	return roles;
+}
+
+bool EsdbEntryModel::canFetchMore(const QModelIndex &parent) const
+{
+	if (parent.isValid()) {
+		return false;
+	}
+	return m_fetched < m_entries->size();
+}
+
+void EsdbEntryModel::fetchMore(const QModelIndex &parent)
+{
+	if (parent.isValid()) {
+		return;
+	}
+	int count = qMin(s_fetchBatch, m_entries->size() - m_fetched);
+	if (count <= 0) {
+		return;
+	}
+	beginInsertRows(QModelIndex(), m_fetched, m_fetched + count - 1);
+	m_fetched += count;
+	endInsertRows();
+}
+
+void EsdbEntryModel::resetEntries(const QList<esdbEntry *> &entries)
+{
+	beginResetModel();
+	*m_entries = entries;
+	m_fetched = qMin(s_fetchBatch, m_entries->size());
+	endResetModel();
+}
+
+void EsdbEntryModel::insertEntries(int row, const QList<esdbEntry *> &entries)
+{
+	if (entries.isEmpty()) {
+		return;
+	}
+	//Rows past the fetched ones aren't visible to the view yet
+	bool visible = row <= m_fetched;
+	if (visible) {
+		beginInsertRows(QModelIndex(), row, row + entries.size() - 1);
+	}
+	for (int i = 0; i < entries.size(); i++) {
+		m_entries->insert(row + i, entries.at(i));
+	}
+	if (visible) {
+		m_fetched += entries.size();
+		endInsertRows();
+	}
+}
+
+void EsdbEntryModel::removeEntries(int first, int last)
+{
+	if (last < first) {
+		return;
+	}
+	int visibleLast = qMin(last, m_fetched - 1);
+	bool visible = first <= visibleLast;
+	if (visible) {
+		beginRemoveRows(QModelIndex(), first, visibleLast);
+	}
+	m_entries->erase(m_entries->begin() + first, m_entries->begin() + last + 1);
+	if (visible) {
+		m_fetched -= visibleLast - first + 1;
+		endRemoveRows();
+	}
+}
+
+QString EsdbEntryModel::text(int index)
+{
+	if (index >= 0 && index < m_fetched) {
+		return m_entries->at(index)->getTitle();
+	} else {
+		return QString();
+	}
+}
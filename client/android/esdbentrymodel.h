@@ -0,0 +1,40 @@
+#ifndef ESDBENTRYMODEL_H
+#define ESDBENTRYMODEL_H
+
+#include <QAbstractListModel>
+#include <QList>
+
+struct esdbEntry;
+
+//
+// List model over the filtered entries. Rows are handed to the view in
+// batches through fetchMore() so a large vault doesn't create a delegate
+// for every entry up front. The backing list must only be changed through
+// resetEntries(), insertEntries() and removeEntries() so the view is told
+// exactly which rows changed.
+//
+class EsdbEntryModel : public QAbstractListModel
+{
+	Q_OBJECT
+	QList<esdbEntry *> *m_entries;
+	int m_fetched;
+	static const int s_fetchBatch = 100;
+public:
+	enum entryRoles {
+		TitleRole = Qt::UserRole + 1,
+		PathRole
+	};
+	EsdbEntryModel(QList<esdbEntry *> *entries);
+	QVariant data(const QModelIndex &index, int role) const;
+	int rowCount(const QModelIndex &parent) const;
+	QHash<int, QByteArray> roleNames() const;
+	bool canFetchMore(const QModelIndex &parent) const;
+	void fetchMore(const QModelIndex &parent);
+	void resetEntries(const QList<esdbEntry *> &entries);
+	void insertEntries(int row, const QList<esdbEntry *> &entries);
+	void removeEntries(int first, int last);
+public slots:
+	QString text(int index);
+};
+
+#endif // ESDBENTRYMODEL_H
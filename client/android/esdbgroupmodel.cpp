@@ -1,29 +1,75 @@
 #include "esdbgroupmodel.h"
 
 EsdbGroupModel::EsdbGroupModel(QStringList *entries) :
-	m_entries(entries)
+	m_entries(entries),
+	m_fetched(0)
 {
 }
 
 QVariant EsdbGroupModel::data(const QModelIndex &index, int role) const
 {
-	if (role == Qt::DisplayRole) {
-		if (index.row() < m_entries->size()) {
-			return m_entries->at(index.row());
-		}
+	if (index.row() >= m_fetched) {
+		return QVariant();
+	}
+	switch (role) {
+	case Qt::DisplayRole:
+	case TitleRole:
+		return m_entries->at(index.row());
+	default:
+		break;
 	}
 	return QVariant();
 }
 
 int EsdbGroupModel::rowCount(const QModelIndex &parent) const
 {
-    Q_UNUSED(parent);
-    return m_entries->length();
+	if (parent.isValid()) {
+		return 0;
+	}
+	return m_fetched;
+}
+
+QHash<int, QByteArray> EsdbGroupModel::roleNames() const
+{
+	QHash<int, QByteArray> roles;
+	roles[Qt::DisplayRole] = "display";
+	roles[TitleRole] = "title";
+	return roles;
+}
+
+bool EsdbGroupModel::canFetchMore(const QModelIndex &parent) const
+{
+	if (parent.isValid()) {
+		return false;
+	}
+	return m_fetched < m_entries->size();
+}
+
+void EsdbGroupModel::fetchMore(const QModelIndex &parent)
+{
+	if (parent.isValid()) {
+		return;
+	}
+	int count = qMin(s_fetchBatch, m_entries->size() - m_fetched);
+	if (count <= 0) {
+		return;
+	}
+	beginInsertRows(QModelIndex(), m_fetched, m_fetched + count - 1);
+	m_fetched += count;
+	endInsertRows();
+}
+
+void EsdbGroupModel::resetGroups(const QStringList &groups)
+{
+	beginResetModel();
+	*m_entries = groups;
+	m_fetched = qMin(s_fetchBatch, m_entries->size());
+	endResetModel();
 }
 
 QString EsdbGroupModel::text(int index)
 {
-	if (index != -1) {
+	if (index >= 0 && index < m_fetched) {
 		return m_entries->at(index);
 	} else {
 		return QString();
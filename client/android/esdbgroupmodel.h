@@ -3,14 +3,27 @@
 
 #include <QAbstractListModel>
 
+//
+// Group names for the group selector, fetched in batches like the entry
+// list. Only change the list through resetGroups().
+//
 class EsdbGroupModel : public QAbstractListModel
 {
 	Q_OBJECT
 	QStringList *m_entries;
+	int m_fetched;
+	static const int s_fetchBatch = 100;
 public:
+	enum groupRoles {
+		TitleRole = Qt::UserRole + 1
+	};
 	EsdbGroupModel(QStringList *entries);
 	QVariant data(const QModelIndex &index, int role) const;
 	int rowCount(const QModelIndex &parent) const;
+	QHash<int, QByteArray> roleNames() const;
+	bool canFetchMore(const QModelIndex &parent) const;
+	void fetchMore(const QModelIndex &parent);
+	void resetGroups(const QStringList &groups);
 public slots:
 	QString text(int index);
 };
@@ -1,7 +1,8 @@
 #include "signetdevicemanager.h"
 #include "signetapplication.h"
-#include "keygeneratorthread.h"
+#include "keyderivationservice.h"
 #include "esdbgroupmodel.h"
+#include "esdbentrymodel.h"
 
 #include <android/log.h>
 
@@ -17,77 +18,23 @@
 
 #include <algorithm>
 
-class EsdbEntryModel : public QAbstractListModel
-{
-	QList<esdbEntry *> *m_entries;
-public:
-	EsdbEntryModel(QList<esdbEntry *> *entries);
-	QVariant data(const QModelIndex &index, int role) const;
-	int rowCount(const QModelIndex &parent) const;
-public slots:
-	QString text(int index);
-};
-
-EsdbEntryModel::EsdbEntryModel(QList<esdbEntry *> *entries) :
-	m_entries(entries)
-{
-}
-
-QVariant EsdbEntryModel::data(const QModelIndex &index, int role) const
-{
-	if (role == Qt::DisplayRole) {
-		if (index.row() < m_entries->size()) {
-			return m_entries->at(index.row())->getTitle();
-		}
-	}
-	return QVariant();
-}
-
-int EsdbEntryModel::rowCount(const QModelIndex &parent) const
-{
-    Q_UNUSED(parent);
-	return m_entries->length();
-}
-
-QString EsdbEntryModel::text(int index)
-{
-	if (index != -1) {
-		return m_entries->at(index)->getTitle();
-	} else {
-		return QString();
-	}
-}
-
 SignetDeviceManager::SignetDeviceManager(QQmlApplicationEngine &engine, QObject *parent) :
 	QObject(parent),
-	m_qmlEngine(engine)
+	m_qmlEngine(engine),
+	m_keyDerivation(nullptr),
+	m_filterApplied(false)
 {
 	SignetApplication *app = SignetApplication::get();
 
 	m_model = new EsdbEntryModel(&m_entriesFiltered);
 	m_groupModel = new EsdbGroupModel(&m_groupsSorted);
 
-	m_keyGeneratorThread = new KeyGeneratorThread();
-	connect(m_keyGeneratorThread, SIGNAL(finished()), this, SLOT(keyGenerationFinished()));
-
 	QObject *mainLoader = findQMLObject("mainLoader");
 	connect(mainLoader, SIGNAL(loaded()), this, SLOT(loaded()));
 	app->setAsyncListener(this);
 
 	connect(app, SIGNAL(deviceOpened()), this, SLOT(deviceOpened()));
 	connect(app, SIGNAL(deviceClosed()), this, SLOT(deviceClosed()));
-	connect(app, SIGNAL(signetdevCmdResp(signetdevCmdRespInfo)),
-		this, SLOT(signetdevCmdResp(signetdevCmdRespInfo)));
-	connect(app, SIGNAL(signetdevGetProgressResp(signetdevCmdRespInfo, signetdev_get_progress_resp_data)),
-		this, SLOT(signetdevGetProgressResp(signetdevCmdRespInfo, signetdev_get_progress_resp_data)));
-	connect(app, SIGNAL(signetdevStartupResp(signetdevCmdRespInfo, signetdev_startup_resp_data)),
-		this, SLOT(signetdevStartupResp(signetdevCmdRespInfo, signetdev_startup_resp_data)));
-	connect(app, SIGNAL(signetdevReadBlockResp(signetdevCmdRespInfo, QByteArray)),
-		this, SLOT(signetdevReadBlockResp(signetdevCmdRespInfo, QByteArray)));
-	connect(app, SIGNAL(signetdevReadAllUIdsResp(signetdevCmdRespInfo, int, QByteArray, QByteArray)),
-		this, SLOT(signetdevReadAllUIdsResp(signetdevCmdRespInfo, int, QByteArray, QByteArray)));
-	connect(app, SIGNAL(signetdevReadUIdResp(signetdevCmdRespInfo, QByteArray, QByteArray)),
-		this, SLOT(signetdevReadUIdResp(signetdevCmdRespInfo, QByteArray, QByteArray)));
 	connect(app, SIGNAL(signetdevEvent(int)), this, SLOT(signetdevEvent(int)));
 	connect(app, SIGNAL(connectionError()), this, SLOT(connectionError()));
 
@@ -102,9 +49,17 @@ SignetDeviceManager::SignetDeviceManager(QQmlApplicationEngine &engine, QObject
 
 void SignetDeviceManager::keyGenerationFinished()
 {
-    ::signetdev_login(nullptr, &m_signetdevCmdToken,
-			  (u8 *)m_keyGeneratorThread->getKey().data(),
-			  m_keyGeneratorThread->getKey().length(), 0);
+	if (sender() != m_keyDerivation || !m_keyDerivation) {
+		return;
+	}
+	QByteArray key = m_keyDerivation->takeKey();
+	m_keyDerivation->release();
+	m_keyDerivation = nullptr;
+	::signetdev_login(nullptr, &m_signetdevCmdToken,
+			  (u8 *)key.data(),
+			  key.length(), 0);
+	SignetApplication::routeResponses(m_signetdevCmdToken, this);
+	SignetApplication::wipeKey(key);
 }
 
 void SignetDeviceManager::connectingTimer()
@@ -116,6 +71,7 @@ void SignetDeviceManager::deviceOpened()
 {
 	m_connectingTimer.stop();
     ::signetdev_startup(nullptr, &m_signetdevCmdToken);
+    SignetApplication::routeResponses(m_signetdevCmdToken, this);
 }
 
 void SignetDeviceManager::connectionError()
@@ -142,21 +98,97 @@ QObject *SignetDeviceManager::findQMLObject(QString name)
 	return ret;
 }
 
-void SignetDeviceManager::filterEntries(QString groupName, QString search)
+static bool entryMatches(esdbEntry *e, const QString &search)
+{
+	return e->getTitle().startsWith(search, Qt::CaseInsensitive);
+}
+
+//
+// Bucket the entries by group and sort each bucket by title once they are
+// all loaded, so filtering never has to sort.
+//
+void SignetDeviceManager::buildGroupIndex()
 {
-	m_entriesFiltered.clear();
-	for (auto e : m_entries) {
-		if (e->getPath() == groupName && e->getTitle().startsWith(search, Qt::CaseInsensitive)) {
-			m_entriesFiltered.push_back(e);
-		}
-	}
 	struct {
-		bool operator() (esdbEntry *& i, esdbEntry *& j) {
+		bool operator() (esdbEntry *i, esdbEntry *j) {
 			return (QString::compare(i->getTitle(), j->getTitle(), Qt::CaseInsensitive) < 0);
 		}
 	} entrySortOp;
-	std::sort(m_entries.begin(), m_entries.end(), entrySortOp);
-	m_model->layoutChanged();
+	m_groupIndex.clear();
+	for (auto e : m_entries) {
+		m_groupIndex[e->getPath()].append(e);
+	}
+	for (auto iter = m_groupIndex.begin(); iter != m_groupIndex.end(); iter++) {
+		std::stable_sort(iter->begin(), iter->end(), entrySortOp);
+	}
+}
+
+void SignetDeviceManager::filterEntries(QString groupName, QString search)
+{
+	static const QList<esdbEntry *> noEntries;
+	auto bucketIter = m_groupIndex.constFind(groupName);
+	const QList<esdbEntry *> &bucket = (bucketIter == m_groupIndex.constEnd()) ? noEntries : bucketIter.value();
+
+	if (!m_filterApplied || groupName != m_filteredGroup) {
+		//A different group shares no rows with the current list
+		QList<esdbEntry *> filtered;
+		for (auto e : bucket) {
+			if (entryMatches(e, search)) {
+				filtered.append(e);
+			}
+		}
+		m_model->resetEntries(filtered);
+	} else if (search.startsWith(m_filteredSearch, Qt::CaseInsensitive)) {
+		//The query grew, so only rows already shown can still match.
+		//Remove the runs that no longer do, last first.
+		int i = m_entriesFiltered.size() - 1;
+		while (i >= 0) {
+			if (entryMatches(m_entriesFiltered.at(i), search)) {
+				i--;
+				continue;
+			}
+			int last = i;
+			while (i >= 0 && !entryMatches(m_entriesFiltered.at(i), search)) {
+				i--;
+			}
+			m_model->removeEntries(i + 1, last);
+		}
+	} else {
+		//Both lists are in bucket order so a single pass over the bucket
+		//finds the runs to insert and remove
+		int row = 0;
+		int removing = 0;
+		QList<esdbEntry *> inserting;
+		for (auto e : bucket) {
+			bool shown = (row + removing) < m_entriesFiltered.size() &&
+				m_entriesFiltered.at(row + removing) == e;
+			bool match = entryMatches(e, search);
+			if (shown && !match) {
+				m_model->insertEntries(row, inserting);
+				row += inserting.size();
+				inserting.clear();
+				removing++;
+			} else if (!shown && match) {
+				m_model->removeEntries(row, row + removing - 1);
+				removing = 0;
+				inserting.append(e);
+			} else {
+				m_model->removeEntries(row, row + removing - 1);
+				removing = 0;
+				m_model->insertEntries(row, inserting);
+				row += inserting.size();
+				inserting.clear();
+				if (shown) {
+					row++;
+				}
+			}
+		}
+		m_model->removeEntries(row, row + removing - 1);
+		m_model->insertEntries(row, inserting);
+	}
+	m_filterApplied = true;
+	m_filteredGroup = groupName;
+	m_filteredSearch = search;
 }
 
 void SignetDeviceManager::setLoaderSource(QString str)
@@ -184,6 +216,7 @@ void SignetDeviceManager::loaded()
 		m_loadingProgress = loader->findChild<QObject *>("loadingProgress");
 		m_entriesLoaded = 0;
         ::signetdev_read_all_uids(nullptr, &m_signetdevCmdToken, 1);
+        SignetApplication::routeResponses(m_signetdevCmdToken, this);
 		} break;
 	case SignetApplication::STATE_LOGGED_IN: {
 		QObject *loader = findQMLObject("mainLoader");
@@ -206,14 +239,18 @@ void SignetDeviceManager::loginSignal(QString password)
 {
 	__android_log_print(ANDROID_LOG_DEBUG, "SIGNET_ACTIVITY", "Login password: %s", password.toLatin1().data());
 	SignetApplication *app = SignetApplication::get();
-	m_keyGeneratorThread->setParams(password, app->getHashfn(), app->getSalt(), app->getKeyLength());
-	m_keyGeneratorThread->start();
+	if (m_keyDerivation) {
+		m_keyDerivation->release();
+	}
+	m_keyDerivation = KeyDerivationService::get()->derive(password, app->getHashfn(), app->getSalt(), app->getKeyLength());
+	connect(m_keyDerivation, SIGNAL(finished()), this, SLOT(keyGenerationFinished()));
 }
 
 void SignetDeviceManager::lockSignal()
 {
 	__android_log_print(ANDROID_LOG_DEBUG, "SIGNET_ACTIVITY", "Lock");
     ::signetdev_logout(nullptr, &m_signetdevCmdToken);
+    SignetApplication::routeResponses(m_signetdevCmdToken, this);
 }
 
 void SignetDeviceManager::filterTextChangedSignal(QString text)
@@ -249,6 +286,7 @@ void SignetDeviceManager::copyPasswordSignal(int index)
 	if (index >= 0) {
 		account *a = (account *)m_entriesFiltered.at(index);
         ::signetdev_read_uid(nullptr, &m_signetdevCmdToken, a->id, 0);
+        SignetApplication::routeResponses(m_signetdevCmdToken, this);
 	}
 }
 
@@ -257,9 +295,10 @@ void SignetDeviceManager::enterDeviceState(int state)
 	if (m_deviceState == SignetApplication::STATE_LOGGED_IN &&
 			state != SignetApplication::STATE_LOGGED_IN) {
 		m_groups.clear();
-		m_groupsSorted.clear();
-		m_entriesFiltered.clear();
-		m_model->layoutChanged();
+		m_groupModel->resetGroups(QStringList());
+		m_model->resetEntries(QList<esdbEntry *>());
+		m_groupIndex.clear();
+		m_filterApplied = false;
 		for (auto e : m_entries) {
 			delete e;
 		}
@@ -280,6 +319,8 @@ void SignetDeviceManager::enterDeviceState(int state)
 		setLoaderSource("login.qml");
 	} break;
 	case SignetApplication::STATE_LOGGED_IN_LOADING_ACCOUNTS: {
+		//The login key is derived, its scratch memory can go
+		KeyDerivationService::get()->releaseScratchMemory();
 		setLoaderSource("loading_entries.qml");
 	}
 	break;
@@ -428,14 +469,11 @@ void SignetDeviceManager::signetdevReadAllUIdsResp(signetdevCmdRespInfo info, in
         esdbEntry *entry = m_acctTypeModule.decodeEntry(id, tmp.revision, nullptr, b);
 		if (entry) {
 			m_entries.push_back(entry);
-		}
-		QString group = entry->getPath();
-		if (!group.size()) {
-			group = "Unsorted";
-		}
-		if (!m_groups.contains(group)) {
+			QString group = entry->getPath();
+			if (!group.size()) {
+				group = "Unsorted";
+			}
 			m_groups.insert(group);
-			m_groupsSorted.append(group);
 		}
 	}
 	if (!info.messages_remaining) {
@@ -444,8 +482,10 @@ void SignetDeviceManager::signetdevReadAllUIdsResp(signetdevCmdRespInfo info, in
 				return (QString::compare(i, j, Qt::CaseInsensitive) < 0);
 			}
 		} groupSortOp;
-		std::sort(m_groupsSorted.begin(), m_groupsSorted.end(), groupSortOp);
-		m_groupModel->layoutChanged();
+		QStringList groups = m_groups.values();
+		std::sort(groups.begin(), groups.end(), groupSortOp);
+		m_groupModel->resetGroups(groups);
+		buildGroupIndex();
 		filterEntries("","");
 		enterDeviceState(SignetApplication::STATE_LOGGED_IN);
 	}
@@ -8,6 +8,7 @@
 #include <QTimer>
 #include <QQmlApplicationEngine>
 #include <QSet>
+#include <QHash>
 #include <QStringList>
 
 #include "esdb/account/esdbaccountmodule.h"
@@ -17,7 +18,7 @@
 class EsdbEntryModel;
 class EsdbGroupModel;
 
-class KeyGeneratorThread;
+class KeyDerivation;
 #include <QString>
 
 class SignetDeviceManager : public QObject, public SignetAsyncListener
@@ -27,7 +28,7 @@ class SignetDeviceManager : public QObject, public SignetAsyncListener
 	int m_signetdevCmdToken;
 	QTimer m_connectingTimer;
 	QQmlApplicationEngine &m_qmlEngine;
-	KeyGeneratorThread *m_keyGeneratorThread;
+	KeyDerivation *m_keyDerivation;
 	void setLoaderSource(QString str);
 	QObject *findQMLObject(QString name);
 	QList<esdbEntry *> m_entries;
@@ -41,6 +42,13 @@ class SignetDeviceManager : public QObject, public SignetAsyncListener
 	QString m_filterGroup;
 	QString m_filterEntry;
 	int m_entriesLoaded;
+	//Entries by group, each sorted by title
+	QHash<QString, QList<esdbEntry *> > m_groupIndex;
+	//Group and query m_entriesFiltered currently holds
+	bool m_filterApplied;
+	QString m_filteredGroup;
+	QString m_filteredSearch;
+	void buildGroupIndex();
 	void filterEntries(QString groupName, QString search);
 public:
 	explicit SignetDeviceManager(QQmlApplicationEngine &engine, QObject *parent = nullptr);
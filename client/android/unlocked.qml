@@ -83,13 +83,13 @@ Item {
             anchors.right: parent.right
             anchors.margins: 10
             anchors.verticalCenter: parent.verticalCenter
-            textRole: "display"
+            textRole: "title"
 
             model: groupModel
             Component {
                 id: groupDelegate
                 Text {
-                    text: display
+                    text: title
                     MouseArea {
                         anchors.fill: parent
                         onClicked: {
@@ -124,10 +124,15 @@ Item {
             anchors.fill: parent
             anchors.margins: 10
             model: entryModel
+            // Only visible rows and a screen's worth on either side get
+            // delegates. The model hands out more rows as the list scrolls.
+            cacheBuffer: height
             Component {
                 id: entryDelegate
                 Text {
-                    text: display
+                    width: entryListView.width
+                    text: title
+                    elide: Text.ElideRight
                     MouseArea {
                         anchors.fill: parent
                         onClicked: entryListView.currentIndex = index
@@ -0,0 +1,149 @@
+#include "signetapplication.h"
+#include "signetbench.h"
+#include "commandtracer.h"
+#include "vaultgenerator.h"
+
+#include <QCommandLineParser>
+#include <QFile>
+#include <QJsonDocument>
+#include <QTextStream>
+
+int main(int argc, char **argv)
+{
+	//Nothing is ever shown; don't require a display
+	if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+		qputenv("QT_QPA_PLATFORM", "offscreen");
+	}
+	SignetApplication *app = new SignetApplication(argc, argv);
+
+	QCommandLineParser parser;
+	parser.setApplicationDescription("Time client code paths against an emulated Signet device");
+	QCommandLineOption file("file", "Emulated device database. It is copied, never modified.", "file-name");
+	QCommandLineOption password("password", "Master password of the database", "password");
+	QCommandLineOption entries("entries", "Synthetic entries to write before measuring (default 1000, 0 to use the database as is)", "count", "1000");
+	QCommandLineOption seed("seed", "Seed for the synthetic entries (default 1)", "seed", "1");
+	QCommandLineOption mix("mix", "Relative weights of accounts, bookmarks and generic entries (default 70:10:20)", "account:bookmark:generic", "70:10:20");
+	QCommandLineOption genericTypes("generic-types", "Generic type descriptions to create (default 8)", "count", "8");
+	QCommandLineOption fields("fields", "Fields per generic type (default 4)", "count", "4");
+	QCommandLineOption accountFields("account-fields", "Extra fields per account (default 1)", "count", "1");
+	QCommandLineOption pathDepth("path-depth", "Depth of the group tree (default 3)", "levels", "3");
+	QCommandLineOption pathFanout("path-fanout", "Subgroups per group (default 4)", "count", "4");
+	QCommandLineOption grouped("grouped", "Percentage of entries placed in a group (default 60)", "percent", "60");
+	QCommandLineOption fieldSize("field-size", "Characters per field value (default 24)", "chars", "24");
+	QCommandLineOption revisions("revisions", "Percentage of entries written in each older revision (default account:3=10)", "type:revision=percent,...", "account:3=10");
+	QCommandLineOption csvRows("csv-rows", "Also time CSV export and import of this many synthetic entries, which never go to the device (default 0)", "count", "0");
+	QCommandLineOption memoryEntries("memory-entries", "Also report the memory held by synthetic vaults of these sizes, decoded without the device", "count,...");
+	QCommandLineOption generate("generate", "Only write the synthetic vault and save the resulting database as this file", "file-name");
+	QCommandLineOption output("output", "Write JSON results to this file instead of stdout", "file-name");
+	QCommandLineOption trace("trace", "Also write per command latencies as a Chrome trace event file", "file-name");
+	parser.addOption(file);
+	parser.addOption(password);
+	parser.addOption(entries);
+	parser.addOption(seed);
+	parser.addOption(mix);
+	parser.addOption(genericTypes);
+	parser.addOption(fields);
+	parser.addOption(accountFields);
+	parser.addOption(pathDepth);
+	parser.addOption(pathFanout);
+	parser.addOption(grouped);
+	parser.addOption(fieldSize);
+	parser.addOption(revisions);
+	parser.addOption(csvRows);
+	parser.addOption(memoryEntries);
+	parser.addOption(generate);
+	parser.addOption(output);
+	parser.addOption(trace);
+	parser.addHelpOption();
+	parser.process(*app);
+
+	if (!parser.isSet(file) || !parser.isSet(password)) {
+		QTextStream(stderr) << "signet-bench: --file and --password are required" << endl;
+		delete app;
+		return 2;
+	}
+
+	vaultGeneratorParams params;
+	params.entryCount = parser.value(entries).toInt();
+	params.seed = parser.value(seed).toUInt();
+	params.genericTypes = parser.value(genericTypes).toInt();
+	params.fieldsPerType = parser.value(fields).toInt();
+	params.accountFields = parser.value(accountFields).toInt();
+	params.pathDepth = parser.value(pathDepth).toInt();
+	params.pathFanout = parser.value(pathFanout).toInt();
+	params.groupedPercent = parser.value(grouped).toInt();
+	params.fieldSize = parser.value(fieldSize).toInt();
+	QString revisionsError = VaultGenerator::parseRevisions(parser.value(revisions), params);
+	if (revisionsError.size()) {
+		QTextStream(stderr) << "signet-bench: --revisions: " << revisionsError << endl;
+		delete app;
+		return 2;
+	}
+	QStringList weights = parser.value(mix).split(":");
+	if (weights.size() != 3) {
+		QTextStream(stderr) << "signet-bench: --mix expects three weights such as 70:10:20" << endl;
+		delete app;
+		return 2;
+	}
+	params.accountWeight = weights.at(0).toInt();
+	params.bookmarkWeight = weights.at(1).toInt();
+	params.genericWeight = weights.at(2).toInt();
+
+	QList<int> memoryCounts;
+	if (parser.isSet(memoryEntries)) {
+		for (const QString &count : parser.value(memoryEntries).split(",")) {
+			int n = count.toInt();
+			if (n <= 0) {
+				QTextStream(stderr) << "signet-bench: --memory-entries expects entry counts such as 10000,50000" << endl;
+				delete app;
+				return 2;
+			}
+			memoryCounts.append(n);
+		}
+	}
+
+	if (parser.isSet(trace)) {
+		CommandTracer::start();
+	}
+	app->initDeviceApi();
+
+	SignetBench *bench = new SignetBench(parser.value(file),
+					     parser.value(password),
+					     params);
+	bench->setCSVRows(parser.value(csvRows).toInt());
+	bench->setMemoryEntries(memoryCounts);
+	bool ok;
+	if (parser.isSet(generate)) {
+		ok = bench->generate(parser.value(generate));
+	} else {
+		ok = bench->run();
+	}
+	QByteArray json = QJsonDocument(bench->results()).toJson();
+	if (!ok) {
+		QTextStream(stderr) << "signet-bench: " << bench->error() << endl;
+	}
+	delete bench;
+
+	if (parser.isSet(output)) {
+		QFile out(parser.value(output));
+		if (!out.open(QFile::WriteOnly)) {
+			QTextStream(stderr) << "signet-bench: failed to write " << parser.value(output) << endl;
+			ok = false;
+		} else {
+			out.write(json);
+		}
+	} else {
+		QTextStream(stdout) << json;
+	}
+
+	signetdev_deinitialize_api();
+	if (parser.isSet(trace)) {
+		if (!CommandTracer::writeTrace(parser.value(trace))) {
+			QTextStream(stderr) << "signet-bench: failed to write " << parser.value(trace) << endl;
+			ok = false;
+		}
+		CommandTracer::stop();
+	}
+	delete app;
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,907 @@
+#include "signetbench.h"
+
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFile>
+#include <QFileInfo>
+#include <QTextStream>
+#include <QTimer>
+
+#include <algorithm>
+
+#ifdef Q_OS_LINUX
+#include <unistd.h>
+#endif
+#ifdef Q_OS_UNIX
+#include <sys/resource.h>
+#endif
+#if defined(Q_OS_LINUX) && defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+#include "esdb.h"
+#include "esdbmodel.h"
+#include "esdbtypemodule.h"
+#include "esdbaccountmodule.h"
+#include "esdbbookmarkmodule.h"
+#include "esdbgenericmodule.h"
+#include "esdb/generictype/esdbgenerictypemodule.h"
+#include "generictypedesc.h"
+#include "keyderivationservice.h"
+#include "desktop/loggedinwidget.h"
+#include "desktop/mainwindow.h"
+#include "import/csvstreamreader.h"
+#include "commandtracer.h"
+
+extern "C" {
+#include "signetdev/host/signetdev.h"
+}
+
+static double elapsedMs(const QElapsedTimer &t)
+{
+	return t.nsecsElapsed() / 1000000.0;
+}
+
+//CPU time used by every thread of the process in ms, or -1 where we
+//can't tell
+static double cpuMs()
+{
+#ifdef Q_OS_UNIX
+	struct rusage ru;
+	if (getrusage(RUSAGE_SELF, &ru)) {
+		return -1;
+	}
+	return (ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1000.0 +
+	       (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1000.0;
+#else
+	return -1;
+#endif
+}
+
+//Resident set size in KiB, or -1 where we can't tell
+static qint64 residentKb()
+{
+#ifdef Q_OS_LINUX
+	QFile f("/proc/self/statm");
+	if (!f.open(QFile::ReadOnly)) {
+		return -1;
+	}
+	QList<QByteArray> fields = f.readAll().split(' ');
+	if (fields.size() < 2) {
+		return -1;
+	}
+	return fields.at(1).toLongLong() * sysconf(_SC_PAGESIZE) / 1024;
+#else
+	return -1;
+#endif
+}
+
+//Hand freed heap back to the system so the resident set size reflects
+//what is still allocated
+static void trimHeap()
+{
+#if defined(Q_OS_LINUX) && defined(__GLIBC__)
+	malloc_trim(0);
+#endif
+}
+
+SignetBench::SignetBench(const QString &dbFile, const QString &password, const vaultGeneratorParams &params, QObject *parent) :
+	QObject(parent),
+	m_dbFile(dbFile),
+	m_password(password),
+	m_params(params),
+	m_csvRows(0),
+	m_loop(nullptr),
+	m_token(-1),
+	m_respCode(OKAY),
+	m_responseDone(false)
+{
+	genericTypeDesc *g = new genericTypeDesc(-1);
+	g->name = "generic";
+	m_genericModule = new esdbGenericModule(g);
+	m_genericTypeModule = new esdbGenericTypeModule();
+	m_accountTypeModule = new esdbAccountModule();
+	m_bookmarkTypeModule = new esdbBookmarkModule();
+}
+
+SignetBench::~SignetBench()
+{
+	clearEntries();
+	qDeleteAll(m_blocks);
+	delete m_accountTypeModule;
+	delete m_bookmarkTypeModule;
+	delete m_genericModule;
+	delete m_genericTypeModule;
+}
+
+void SignetBench::clearEntries()
+{
+	m_accounts.clear();
+	qDeleteAll(m_entries);
+	m_entries.clear();
+	esdbStringPool::clear();
+}
+
+bool SignetBench::fail(const QString &error)
+{
+	m_error = error;
+	return false;
+}
+
+void SignetBench::addPhase(const QString &name, double ms, int count, double cpuMs)
+{
+	QJsonObject phase;
+	phase["ms"] = ms;
+	if (count) {
+		phase["count"] = count;
+		phase["per_item_us"] = ms * 1000.0 / count;
+	}
+	if (cpuMs >= 0) {
+		phase["cpu_ms"] = cpuMs;
+	}
+	m_phases[name] = phase;
+}
+
+void SignetBench::addSamples(const QString &name, const QList<double> &samples)
+{
+	QList<double> sorted = samples;
+	std::sort(sorted.begin(), sorted.end());
+	double total = 0;
+	for (double s : sorted) {
+		total += s;
+	}
+	QJsonObject phase;
+	phase["ms"] = total;
+	phase["count"] = sorted.size();
+	if (sorted.size()) {
+		phase["mean_ms"] = total / sorted.size();
+		phase["median_ms"] = sorted.at(sorted.size() / 2);
+		phase["p95_ms"] = sorted.at((sorted.size() * 95) / 100);
+		phase["max_ms"] = sorted.last();
+	}
+	m_phases[name] = phase;
+}
+
+QJsonObject SignetBench::results() const
+{
+	QJsonObject o;
+	o["database"] = QFileInfo(m_dbFile).fileName();
+	QJsonObject params;
+	params["entries"] = m_params.entryCount;
+	params["account_weight"] = m_params.accountWeight;
+	params["bookmark_weight"] = m_params.bookmarkWeight;
+	params["generic_weight"] = m_params.genericWeight;
+	params["generic_types"] = m_params.genericTypes;
+	params["fields_per_type"] = m_params.fieldsPerType;
+	params["account_fields"] = m_params.accountFields;
+	params["path_depth"] = m_params.pathDepth;
+	params["path_fanout"] = m_params.pathFanout;
+	params["grouped_percent"] = m_params.groupedPercent;
+	params["field_size"] = m_params.fieldSize;
+	params["revisions"] = VaultGenerator::revisionsString(m_params);
+	params["seed"] = (int)m_params.seed;
+	if (m_csvRows > 0) {
+		params["csv_rows"] = m_csvRows;
+	}
+	o["generator"] = params;
+	o["qt_version"] = QString(qVersion());
+	o["phases"] = m_phases;
+	if (!m_memory.isEmpty()) {
+		o["memory"] = m_memory;
+	}
+	if (CommandTracer::isEnabled()) {
+		o["commands"] = CommandTracer::histograms();
+	}
+	if (m_error.size()) {
+		o["error"] = m_error;
+	}
+	return o;
+}
+
+//
+// Spin a local event loop until the response for m_token arrives. The
+// signetdev callbacks are queued to this thread so a response can't be
+// missed between issuing a command and calling this.
+//
+bool SignetBench::waitForResponse()
+{
+	QEventLoop loop;
+	QTimer timer;
+	timer.setSingleShot(true);
+	connect(&timer, SIGNAL(timeout()), this, SLOT(responseTimeout()));
+	m_responseDone = false;
+	m_loop = &loop;
+	timer.start(SIGNET_BENCH_RESPONSE_TIMEOUT * 1000);
+	if (!m_responseDone) {
+		loop.exec();
+	}
+	m_loop = nullptr;
+	m_token = -1;
+	if (!m_responseDone) {
+		return fail("Timed out waiting for the device");
+	}
+	return true;
+}
+
+//
+// Spin a local event loop until at least one of m_pendingWrites completes
+//
+bool SignetBench::waitForWrites()
+{
+	if (m_writeCodes.isEmpty()) {
+		QEventLoop loop;
+		QTimer timer;
+		timer.setSingleShot(true);
+		connect(&timer, SIGNAL(timeout()), this, SLOT(responseTimeout()));
+		m_loop = &loop;
+		timer.start(SIGNET_BENCH_RESPONSE_TIMEOUT * 1000);
+		loop.exec();
+		m_loop = nullptr;
+	}
+	if (m_writeCodes.isEmpty()) {
+		return fail("Timed out waiting for the device");
+	}
+	return true;
+}
+
+void SignetBench::responseTimeout()
+{
+	if (m_loop) {
+		m_loop->quit();
+	}
+}
+
+void SignetBench::signetdevCmdResp(signetdevCmdRespInfo info)
+{
+	if (m_pendingWrites.remove(info.token)) {
+		m_writeCodes.append(info.resp_code);
+		if (m_loop) {
+			m_loop->quit();
+		}
+		return;
+	}
+	if (info.token != m_token) {
+		return;
+	}
+	m_respCode = info.resp_code;
+	m_responseDone = true;
+	if (m_loop) {
+		m_loop->quit();
+	}
+}
+
+void SignetBench::signetdevStartupResp(signetdevCmdRespInfo info, signetdev_startup_resp_data resp)
+{
+	if (info.token != m_token) {
+		return;
+	}
+	m_startupResp = resp;
+	signetdevCmdResp(info);
+}
+
+void SignetBench::signetdevReadBlockResp(signetdevCmdRespInfo info, QByteArray block)
+{
+	if (info.token != m_token) {
+		return;
+	}
+	m_block = block;
+	signetdevCmdResp(info);
+}
+
+void SignetBench::signetdevReadAllUIdsResp(signetdevCmdRespInfo info, int uid, QByteArray data, QByteArray mask)
+{
+	if (info.token != m_token) {
+		return;
+	}
+	if (info.resp_code == OKAY && uid != -1) {
+		block *b = new block();
+		b->data = data;
+		b->mask = mask;
+		m_blocks.append(b);
+		m_blockIds.append(uid);
+	}
+	if (!info.messages_remaining || info.resp_code != OKAY) {
+		signetdevCmdResp(info);
+	}
+}
+
+esdbTypeModule *SignetBench::typeModule(int type)
+{
+	switch (type) {
+	case ESDB_TYPE_ACCOUNT:
+		return m_accountTypeModule;
+	case ESDB_TYPE_BOOKMARK:
+		return m_bookmarkTypeModule;
+	case ESDB_TYPE_GENERIC:
+		return m_genericModule;
+	case ESDB_TYPE_GENERIC_TYPE_DESC:
+		return m_genericTypeModule;
+	default:
+		return nullptr;
+	}
+}
+
+bool SignetBench::startup()
+{
+	m_dbCopy = m_tempDir.path() + "/" + QFileInfo(m_dbFile).fileName();
+	if (!QFile::copy(m_dbFile, m_dbCopy)) {
+		return fail("Failed to copy " + m_dbFile);
+	}
+	if (!::signetdev_emulate_init(m_dbCopy.toLatin1().data())) {
+		return fail("Database file not valid");
+	}
+	if (!::signetdev_emulate_begin()) {
+		return fail("Failed to start device emulation");
+	}
+
+	QElapsedTimer t;
+	t.start();
+	::signetdev_startup(nullptr, &m_token);
+	SignetApplication::routeResponses(m_token, this);
+	if (!waitForResponse()) {
+		return false;
+	}
+	addPhase("startup", elapsedMs(t));
+	if (m_respCode == UNKNOWN_DB_FORMAT) {
+		return fail("Emulated device is not initialized");
+	}
+	if (m_respCode != OKAY) {
+		return fail("Startup failed with code " + QString::number(m_respCode));
+	}
+
+	SignetApplication *app = SignetApplication::get();
+	int keyLength;
+	int saltLength;
+	if (m_startupResp.root_block_format == 1) {
+		saltLength = AES_128_KEY_SIZE;
+		keyLength = AES_128_KEY_SIZE;
+	} else {
+		saltLength = AES_256_KEY_SIZE;
+		keyLength = AES_256_KEY_SIZE;
+	}
+	app->setSaltLength(saltLength);
+	app->setSalt(QByteArray((const char *)m_startupResp.salt, saltLength));
+	app->setHashfn(QByteArray((const char *)m_startupResp.hashfn, HASH_FN_SZ));
+	app->setKeyLength(keyLength);
+	app->setDBFormat(m_startupResp.db_format);
+	app->setConnectedFirmwareVersion(m_startupResp.fw_major_version, m_startupResp.fw_minor_version, m_startupResp.fw_step_version);
+	return true;
+}
+
+bool SignetBench::login()
+{
+	SignetApplication *app = SignetApplication::get();
+	QEventLoop loop;
+	QElapsedTimer t;
+	t.start();
+	KeyDerivation *d = KeyDerivationService::get()->derive(m_password, app->getHashfn(), app->getSalt(), app->getKeyLength());
+	connect(d, SIGNAL(finished()), &loop, SLOT(quit()));
+	loop.exec();
+	QByteArray key = d->takeKey();
+	d->release();
+	addPhase("login_key_derivation", elapsedMs(t));
+	if (key.isEmpty()) {
+		return fail("Key derivation failed");
+	}
+
+	t.start();
+	::signetdev_login(nullptr, &m_token, (u8 *)key.data(), key.length(), 0);
+	SignetApplication::routeResponses(m_token, this);
+	SignetApplication::wipeKey(key);
+	if (!waitForResponse()) {
+		return false;
+	}
+	addPhase("login", elapsedMs(t));
+	if (m_respCode != OKAY) {
+		return fail("Login failed with code " + QString::number(m_respCode));
+	}
+	return true;
+}
+
+bool SignetBench::populate()
+{
+	VaultGenerator generator(m_params);
+	generator.setMaxEntrySize(::signetdev_max_entry_data_size());
+	QList<esdbEntry *> entries = generator.generate(MIN_UID, MAX_UID);
+	QElapsedTimer t;
+	t.start();
+	bool ok = true;
+	for (esdbEntry *entry : entries) {
+		block blk;
+		entry->toBlock(&blk);
+		::signetdev_update_uid(nullptr, &m_token, entry->id,
+				       blk.data.size(),
+				       (const u8 *)blk.data.data(),
+				       (const u8 *)blk.mask.data());
+		SignetApplication::routeResponses(m_token, this);
+		if (!waitForResponse()) {
+			ok = false;
+			break;
+		}
+		if (m_respCode != OKAY) {
+			ok = fail("Write failed with code " + QString::number(m_respCode));
+			break;
+		}
+	}
+	if (ok) {
+		double ms = elapsedMs(t);
+		addPhase("populate", ms, entries.size());
+		QJsonObject phase = m_phases["populate"].toObject();
+		phase["trimmed"] = generator.trimmedEntries();
+		if (ms > 0) {
+			phase["entries_per_sec"] = entries.size() * 1000.0 / ms;
+		}
+		m_phases["populate"] = phase;
+	}
+	qDeleteAll(entries);
+	return ok;
+}
+
+//
+// Write the same vault again the way DatabaseImportController does on
+// devices with update_uids. Entries are serialized up front and go out as
+// one batch, the first update alone since it may wait for a button press,
+// then up to s_writeWindow at a time. Its entries_per_sec compares with
+// populate, which waits for each update_uid before sending the next.
+//
+bool SignetBench::importWrite()
+{
+	VaultGenerator generator(m_params);
+	generator.setMaxEntrySize(::signetdev_max_entry_data_size());
+	QList<esdbEntry *> entries = generator.generate(MIN_UID, MAX_UID);
+	QList<block> blocks;
+	for (esdbEntry *entry : entries) {
+		block blk;
+		entry->toBlock(&blk);
+		blocks.append(blk);
+	}
+
+	QElapsedTimer t;
+	t.start();
+	int next = 0;
+	int written = 0;
+	int window = 1;
+	int code = OKAY;
+	bool ok = true;
+	while (written < blocks.size() && code == OKAY) {
+		while (next < blocks.size() && m_pendingWrites.size() < window) {
+			const block &blk = blocks.at(next);
+			int token;
+			::signetdev_update_uids(nullptr, &token, entries.at(next)->id,
+						blk.data.size(),
+						(const u8 *)blk.data.data(),
+						(const u8 *)blk.mask.data(),
+						blocks.size() - next - 1);
+			SignetApplication::routeResponses(token, this);
+			m_pendingWrites.insert(token);
+			next++;
+		}
+		if (!waitForWrites()) {
+			ok = false;
+			break;
+		}
+		while (!m_writeCodes.isEmpty()) {
+			int c = m_writeCodes.takeFirst();
+			if (c != OKAY) {
+				code = c;
+			}
+			written++;
+		}
+		window = s_writeWindow;
+	}
+	double ms = elapsedMs(t);
+	m_pendingWrites.clear();
+	m_writeCodes.clear();
+	qDeleteAll(entries);
+	if (!ok) {
+		return false;
+	}
+	if (code != OKAY && written == 1) {
+		//The first update went alone so nothing else is outstanding. The
+		//device lacks update_uids, note it and carry on.
+		QJsonObject phase;
+		phase["error"] = code;
+		m_phases["import_write"] = phase;
+		return true;
+	}
+	if (code != OKAY) {
+		return fail("Batched write failed with code " + QString::number(code));
+	}
+	addPhase("import_write", ms, written);
+	QJsonObject phase = m_phases["import_write"].toObject();
+	phase["window"] = s_writeWindow;
+	if (ms > 0) {
+		phase["entries_per_sec"] = written * 1000.0 / ms;
+	}
+	m_phases["import_write"] = phase;
+	return true;
+}
+
+void SignetBench::decodeBlock(int id, block *blk)
+{
+	esdbEntry_1 tmp(id);
+	tmp.fromBlock(blk);
+	esdbTypeModule *module = typeModule(tmp.type);
+	if (!module) {
+		return;
+	}
+	esdbEntry *entry = module->decodeEntry(id, tmp.revision, nullptr, blk);
+	if (entry) {
+		m_entries.insert(id, entry);
+		if (entry->type == ESDB_TYPE_ACCOUNT) {
+			m_accounts.insert(id, entry);
+		}
+	}
+}
+
+//
+// Same steps LoggedInWidget takes when unlocking: read every entry with
+// secrets masked and decode each block through its type module.
+//
+bool SignetBench::loadEntries()
+{
+	clearEntries();
+	qDeleteAll(m_blocks);
+	m_blocks.clear();
+	m_blockIds.clear();
+
+	QElapsedTimer t;
+	t.start();
+	::signetdev_read_all_uids(nullptr, &m_token, 1);
+	SignetApplication::routeResponses(m_token, this);
+	if (!waitForResponse()) {
+		return false;
+	}
+	double readMs = elapsedMs(t);
+	if (m_respCode != OKAY && m_respCode != ID_INVALID) {
+		return fail("read_all_uids failed with code " + QString::number(m_respCode));
+	}
+
+	QElapsedTimer d;
+	d.start();
+	for (int i = 0; i < m_blocks.size(); i++) {
+		decodeBlock(m_blockIds.at(i), m_blocks.at(i));
+	}
+	double decodeMs = elapsedMs(d);
+	addPhase("read_all_uids", readMs, m_blocks.size());
+	addPhase("decode_entries", decodeMs, m_blocks.size());
+	qDeleteAll(m_blocks);
+	m_blocks.clear();
+	m_blockIds.clear();
+
+	//Memory held once every entry is decoded, as after unlocking
+	m_memory["entries"] = m_entries.size();
+	m_memory["interned_strings"] = esdbStringPool::size();
+	qint64 rss = residentKb();
+	if (rss >= 0) {
+		m_memory["rss_kb"] = (double)rss;
+	}
+
+	//Fields are decoded on first access, as when an entry is opened
+	QElapsedTimer f;
+	f.start();
+	for (esdbEntry *entry : m_entries) {
+		QVector<genericField> fields;
+		entry->getFields(fields);
+	}
+	addPhase("decode_fields", elapsedMs(f), m_entries.size());
+	rss = residentKb();
+	if (rss >= 0) {
+		m_memory["rss_kb_fields_decoded"] = (double)rss;
+	}
+	return true;
+}
+
+//
+// Type a handful of queries one character at a time, refiltering the
+// account list and refreshing its model on every keystroke as the search
+// box does.
+//
+bool SignetBench::filterEntries()
+{
+	QStringList queries;
+	queries << "mailbank" << "cloudshop1" << "work" << "https://www.news"
+		<< "example.com" << "zzzzzz";
+	QList<esdbEntry *> filtered;
+	EsdbModel model(m_accountTypeModule, &filtered);
+	QList<double> samples;
+	for (const QString &query : queries) {
+		for (int i = 1; i <= query.size(); i++) {
+			QElapsedTimer t;
+			t.start();
+			bool hasGroups = LoggedInWidget::filterEntries(m_accounts, query.left(i), filtered);
+			model.changed(hasGroups);
+			samples.append(elapsedMs(t));
+		}
+	}
+	addSamples("filter_keystroke", samples);
+	return true;
+}
+
+bool SignetBench::refreshModel()
+{
+	QList<esdbEntry *> filtered;
+	EsdbModel model(m_accountTypeModule, &filtered);
+	bool hasGroups = LoggedInWidget::filterEntries(m_accounts, QString(), filtered);
+	QList<double> samples;
+	for (int i = 0; i < 10; i++) {
+		QElapsedTimer t;
+		t.start();
+		model.changed(hasGroups);
+		samples.append(elapsedMs(t));
+	}
+	addSamples("model_refresh", samples);
+	return true;
+}
+
+//
+// Export every decoded entry to one CSV file per type, laid out as
+// MainWindow does for a CSV archive.
+//
+bool SignetBench::exportCSV(const QString &phaseName)
+{
+	QElapsedTimer t;
+	double cpu = cpuMs();
+	t.start();
+	QMap<QString, exportType> exportData;
+	for (esdbEntry *entry : m_entries) {
+		esdbTypeModule *module = typeModule(entry->type);
+		if (!module || entry->type == ESDB_TYPE_GENERIC_TYPE_DESC) {
+			continue;
+		}
+		exportType &type = exportData[module->name()];
+		QVector<genericField> fields;
+		entry->getFields(fields);
+		for (const genericField &field : fields) {
+			if (!type.m_exportFieldMap.contains(field.name)) {
+				type.m_exportField.push_back(field.name);
+				type.m_exportFieldMap[field.name] = type.m_exportField.size() - 1;
+			}
+		}
+		type.m_data.push_back(QVector<QString>());
+		QVector<QString> &csvEntry = type.m_data.back();
+		csvEntry.resize(type.m_exportField.size() + 1);
+		for (const genericField &field : fields) {
+			csvEntry[type.m_exportFieldMap[field.name]] = field.value;
+		}
+	}
+
+	m_csvFiles.clear();
+	for (auto x = exportData.begin(); x != exportData.end(); x++) {
+		QString fileName = m_tempDir.path() + "/" + x.key() + ".csv";
+		QFile file(fileName);
+		if (!file.open(QFile::WriteOnly)) {
+			return fail("Failed to write " + fileName);
+		}
+		QString outStr;
+		QTextStream out(&outStr);
+		for (auto field : x.value().m_exportField) {
+			out << MainWindow::csvQuote(field) << ",";
+		}
+		out << endl;
+		for (auto entry : x.value().m_data) {
+			for (auto value : entry) {
+				out << MainWindow::csvQuote(value) << ",";
+			}
+			out << endl;
+		}
+		out.flush();
+		file.write(outStr.toUtf8());
+		file.close();
+		m_csvFiles.append(fileName);
+	}
+	addPhase(phaseName, elapsedMs(t), m_entries.size(), cpu >= 0 ? cpuMs() - cpu : -1);
+	return true;
+}
+
+//
+// Replace the exported files with ones holding m_csvRows synthetic entries.
+// The entries never go to the device so the row count isn't limited by its
+// capacity.
+//
+bool SignetBench::syntheticCSV()
+{
+	clearEntries();
+	vaultGeneratorParams params = m_params;
+	params.entryCount = m_csvRows;
+	VaultGenerator generator(params);
+	QList<esdbEntry *> entries = generator.generate(1, m_csvRows);
+	for (esdbEntry *entry : entries) {
+		block blk;
+		entry->toBlock(&blk);
+		decodeBlock(entry->id, &blk);
+	}
+	qDeleteAll(entries);
+	return exportCSV("csv_export_synthetic");
+}
+
+//
+// Parse the exported files back into entries the way CSVImporter does once
+// the user has picked a type for each file.
+//
+bool SignetBench::importCSV()
+{
+	QElapsedTimer t;
+	double cpu = cpuMs();
+	t.start();
+	int count = 0;
+	for (const QString &fileName : m_csvFiles) {
+		QString typeName = QFileInfo(fileName).baseName();
+		esdbTypeModule *module = nullptr;
+		for (auto m : {m_accountTypeModule, m_bookmarkTypeModule, m_genericModule}) {
+			if (m->name() == typeName) {
+				module = m;
+				break;
+			}
+		}
+		if (!module) {
+			module = m_genericModule;
+		}
+		QFile file(fileName);
+		if (!file.open(QFile::ReadOnly)) {
+			return fail("Failed to read " + fileName);
+		}
+		CSVStreamReader reader(&file);
+		QStringList header;
+		QStringList row;
+		reader.readRow(header);
+		importColumnPlan plan = module->columnPlan(header);
+		while (reader.readRow(row)) {
+			esdbEntry *entry = module->decodeEntry(plan, row);
+			if (entry) {
+				count++;
+				delete entry;
+			}
+		}
+	}
+	addPhase("csv_import", elapsedMs(t), count, cpu >= 0 ? cpuMs() - cpu : -1);
+	return true;
+}
+
+bool SignetBench::backupRestore()
+{
+	int blockCount = ::signetdev_device_num_storage_blocks();
+	QList<QByteArray> blocks;
+
+	QElapsedTimer t;
+	t.start();
+	::signetdev_begin_device_backup(nullptr, &m_token);
+	SignetApplication::routeResponses(m_token, this);
+	if (!waitForResponse()) {
+		return false;
+	}
+	if (m_respCode != OKAY) {
+		return fail("Backup failed with code " + QString::number(m_respCode));
+	}
+	for (int i = 0; i < blockCount; i++) {
+		::signetdev_read_block(nullptr, &m_token, i);
+		SignetApplication::routeResponses(m_token, this);
+		if (!waitForResponse()) {
+			return false;
+		}
+		if (m_respCode != OKAY) {
+			return fail("Backup failed with code " + QString::number(m_respCode));
+		}
+		blocks.append(m_block);
+	}
+	::signetdev_end_device_backup(nullptr, &m_token);
+	SignetApplication::routeResponses(m_token, this);
+	if (!waitForResponse()) {
+		return false;
+	}
+	addPhase("backup", elapsedMs(t), blockCount);
+
+	t.start();
+	::signetdev_begin_device_restore(nullptr, &m_token);
+	SignetApplication::routeResponses(m_token, this);
+	if (!waitForResponse()) {
+		return false;
+	}
+	if (m_respCode != OKAY) {
+		return fail("Restore failed with code " + QString::number(m_respCode));
+	}
+	for (int i = 0; i < blocks.size(); i++) {
+		QByteArray block = blocks.at(i);
+		::signetdev_write_block(nullptr, &m_token, i, block.data());
+		SignetApplication::routeResponses(m_token, this);
+		if (!waitForResponse()) {
+			return false;
+		}
+		if (m_respCode != OKAY) {
+			return fail("Restore failed with code " + QString::number(m_respCode));
+		}
+	}
+	::signetdev_end_device_restore(nullptr, &m_token);
+	SignetApplication::routeResponses(m_token, this);
+	if (!waitForResponse()) {
+		return false;
+	}
+	addPhase("restore", elapsedMs(t), blocks.size());
+	return true;
+}
+
+//
+// Decode a synthetic vault of each size in m_memoryEntries as after an
+// unlock and record the memory it holds. The entries never go to the
+// device so the sizes aren't limited by its capacity.
+//
+bool SignetBench::memoryScale()
+{
+	QJsonObject scale;
+	for (int count : m_memoryEntries) {
+		clearEntries();
+		trimHeap();
+		qint64 before = residentKb();
+
+		vaultGeneratorParams params = m_params;
+		params.entryCount = count;
+		VaultGenerator generator(params);
+		QList<esdbEntry *> entries = generator.generate(1, count);
+		QList<int> ids;
+		QList<block> blocks;
+		for (esdbEntry *entry : entries) {
+			block blk;
+			entry->toBlock(&blk);
+			ids.append(entry->id);
+			blocks.append(blk);
+		}
+		qDeleteAll(entries);
+		for (int i = 0; i < blocks.size(); i++) {
+			decodeBlock(ids.at(i), &blocks[i]);
+		}
+		blocks.clear();
+		trimHeap();
+
+		QJsonObject m;
+		m["entries"] = m_entries.size();
+		m["interned_strings"] = esdbStringPool::size();
+		qint64 rss = residentKb();
+		if (rss >= 0 && before >= 0) {
+			m["rss_kb"] = (double)rss;
+			m["rss_kb_entries"] = (double)(rss - before);
+		}
+		scale[QString::number(count)] = m;
+	}
+	clearEntries();
+	m_memory["scale"] = scale;
+	return true;
+}
+
+bool SignetBench::run()
+{
+	if (!m_tempDir.isValid()) {
+		return fail("Failed to create a temporary directory");
+	}
+	bool ok = startup() &&
+		login() &&
+		(m_params.entryCount <= 0 || (populate() && importWrite())) &&
+		loadEntries() &&
+		filterEntries() &&
+		refreshModel() &&
+		exportCSV("csv_export") &&
+		(m_csvRows <= 0 || syntheticCSV()) &&
+		importCSV() &&
+		backupRestore() &&
+		(m_memoryEntries.isEmpty() || memoryScale());
+	::signetdev_emulate_end();
+	return ok;
+}
+
+bool SignetBench::generate(const QString &outFile)
+{
+	if (!m_tempDir.isValid()) {
+		return fail("Failed to create a temporary directory");
+	}
+	bool ok = startup() &&
+		login() &&
+		populate();
+	::signetdev_emulate_end();
+	if (!ok) {
+		return false;
+	}
+	QFile::remove(outFile);
+	if (!QFile::copy(m_dbCopy, outFile)) {
+		return fail("Failed to write " + outFile);
+	}
+	return true;
+}
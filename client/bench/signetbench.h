@@ -0,0 +1,122 @@
+#ifndef SIGNETBENCH_H
+#define SIGNETBENCH_H
+
+#include <QObject>
+#include <QJsonObject>
+#include <QList>
+#include <QSet>
+#include <QString>
+#include <QTemporaryDir>
+
+#include "signetapplication.h"
+#include "vaultgenerator.h"
+#include "esdbentrytable.h"
+
+struct esdbEntry;
+struct esdbTypeModule;
+struct block;
+class QEventLoop;
+
+//Seconds to wait for any single device response before giving up
+#define SIGNET_BENCH_RESPONSE_TIMEOUT 120
+
+//
+// Headless benchmark driver. Runs an emulated device from a copy of a
+// database file and times the client code paths used by the desktop UI:
+// login key derivation, loading entries with read_all_uids, per keystroke
+// filtering, model refresh, CSV export and import, and block level backup
+// and restore. Each phase adds a record to results(). The database is
+// first filled with a VaultGenerator vault unless the entry count is zero.
+//
+class SignetBench : public QObject
+{
+	Q_OBJECT
+	QString m_dbFile;
+	QString m_password;
+	vaultGeneratorParams m_params;
+	QString m_dbCopy;
+	QTemporaryDir m_tempDir;
+	QJsonObject m_phases;
+	QJsonObject m_memory;
+	QString m_error;
+
+	esdbTypeModule *m_accountTypeModule;
+	esdbTypeModule *m_bookmarkTypeModule;
+	esdbTypeModule *m_genericModule;
+	esdbTypeModule *m_genericTypeModule;
+	esdbEntryTable m_entries;
+	esdbEntryTable m_accounts;
+	QStringList m_csvFiles;
+	int m_csvRows;
+	QList<int> m_memoryEntries;
+
+	QEventLoop *m_loop;
+	int m_token;
+	int m_respCode;
+	bool m_responseDone;
+	QByteArray m_block;
+	QList<block *> m_blocks;
+	QList<int> m_blockIds;
+	signetdev_startup_resp_data m_startupResp;
+
+	//Batched updates outstanding in importWrite() and the response codes
+	//received for them. Up to s_writeWindow are kept in flight, as
+	//DatabaseImportController does.
+	static const int s_writeWindow = 4;
+	QSet<int> m_pendingWrites;
+	QList<int> m_writeCodes;
+
+	bool waitForResponse();
+	bool waitForWrites();
+	bool fail(const QString &error);
+	void addPhase(const QString &name, double ms, int count = 0, double cpuMs = -1);
+	void addSamples(const QString &name, const QList<double> &samples);
+	void clearEntries();
+	esdbTypeModule *typeModule(int type);
+	void decodeBlock(int id, block *blk);
+
+	bool startup();
+	bool login();
+	bool populate();
+	bool importWrite();
+	bool loadEntries();
+	bool filterEntries();
+	bool refreshModel();
+	bool exportCSV(const QString &phaseName);
+	bool syntheticCSV();
+	bool importCSV();
+	bool backupRestore();
+	bool memoryScale();
+public:
+	SignetBench(const QString &dbFile, const QString &password, const vaultGeneratorParams &params, QObject *parent = nullptr);
+	~SignetBench();
+	bool run();
+	//Write the generated vault into a copy of the database saved as
+	//outFile, without measuring anything else
+	bool generate(const QString &outFile);
+	//Also export and import rows synthetic entries as CSV, however many
+	//entries the device holds
+	void setCSVRows(int rows)
+	{
+		m_csvRows = rows;
+	}
+	//Also decode synthetic vaults of each of these sizes without the
+	//device and report the memory each holds
+	void setMemoryEntries(const QList<int> &counts)
+	{
+		m_memoryEntries = counts;
+	}
+	QJsonObject results() const;
+	const QString &error() const
+	{
+		return m_error;
+	}
+private slots:
+	void signetdevCmdResp(signetdevCmdRespInfo info);
+	void signetdevStartupResp(signetdevCmdRespInfo info, signetdev_startup_resp_data resp);
+	void signetdevReadAllUIdsResp(signetdevCmdRespInfo info, int uid, QByteArray data, QByteArray mask);
+	void signetdevReadBlockResp(signetdevCmdRespInfo info, QByteArray block);
+	void responseTimeout();
+};
+
+#endif // SIGNETBENCH_H
@@ -0,0 +1,427 @@
+#include "vaultgenerator.h"
+
+#include "esdb.h"
+#include "account.h"
+#include "bookmark.h"
+#include "generic.h"
+#include "generictypedesc.h"
+
+//Group paths beyond this many are not generated however deep the tree is
+#define VAULT_GENERATOR_MAX_PATHS 4096
+
+//Revisions before the current ones, which the generator can write
+#define VAULT_GENERATOR_ACCOUNT_REVISIONS 7
+#define VAULT_GENERATOR_GENERIC_REVISIONS 4
+
+static const char *s_words[] = {
+	"mail", "bank", "cloud", "shop", "news", "forum", "photo", "music",
+	"travel", "work", "school", "game", "health", "energy", "social", "video",
+	"router", "server", "wiki", "ticket", "build", "chat", "calendar", "backup"
+};
+
+static const char *s_fieldTypes[] = {"Text", ".Text", "Text block"};
+
+//
+// Entry written in the layout of an older revision so that loading it goes
+// through the upgrade path. It keeps the current revision entry it was made
+// from and writes as much of it as the old revision can hold.
+//
+struct legacyEntry : public esdbEntry {
+	esdbEntry *current;
+	QString typeName;
+	legacyEntry(esdbEntry *current_, int revision_) :
+		esdbEntry(current_->id, current_->type, revision_, current_->id, 1),
+		current(current_)
+	{
+	}
+	~legacyEntry()
+	{
+		delete current;
+	}
+	void toBlock(block *blk) const;
+};
+
+static void legacyFields(const genericFields &fields, const QString &path, genericFields_1 &out)
+{
+	//Before revision 6 accounts kept their group in a "path" field
+	if (path.size()) {
+		out.addField(genericField("path", QString(), path));
+	}
+	for (int i = 0; i < fields.fieldCount(); i++) {
+		out.addField(fields.getField(i));
+	}
+}
+
+static void legacyFields(const genericFields &fields, const QString &path, genericFields_2 &out)
+{
+	if (path.size()) {
+		out.m_fields.append(genericField("path", "Text", path));
+	}
+	for (int i = 0; i < fields.fieldCount(); i++) {
+		out.m_fields.append(fields.getField(i));
+	}
+}
+
+template <typename T> static void copyAccountStrings(const account *a, T &out)
+{
+	out.acct_name = a->acctName;
+	out.user_name = a->userName;
+	out.password = a->password;
+}
+
+template <typename T> static void copyAccount(const account *a, T &out)
+{
+	out.acctName = a->acctName;
+	out.userName = a->userName;
+	out.password = a->password;
+	out.url = a->url;
+	out.email = a->email;
+}
+
+void legacyEntry::toBlock(block *blk) const
+{
+	if (type == ESDB_TYPE_ACCOUNT) {
+		const account *a = static_cast<const account *>(current);
+		switch (revision) {
+		case 0: {
+			account_0 e(id);
+			copyAccountStrings(a, e);
+			e.toBlock(blk);
+		}
+		break;
+		case 1: {
+			account_1 e(id);
+			copyAccountStrings(a, e);
+			e.url = a->url;
+			e.toBlock(blk);
+		}
+		break;
+		case 2: {
+			account_2 e(id);
+			copyAccountStrings(a, e);
+			e.url = a->url;
+			e.email = a->email;
+			e.toBlock(blk);
+		}
+		break;
+		case 3: {
+			account_3 e(id);
+			copyAccount(a, e);
+			e.toBlock(blk);
+		}
+		break;
+		case 4: {
+			account_4 e(id);
+			copyAccount(a, e);
+			legacyFields(a->fields, a->path, e.fields);
+			e.toBlock(blk);
+		}
+		break;
+		case 5: {
+			account_5 e(id);
+			copyAccount(a, e);
+			legacyFields(a->fields, a->path, e.fields);
+			e.toBlock(blk);
+		}
+		break;
+		case 6: {
+			account_6 e(id);
+			copyAccount(a, e);
+			e.path = a->path;
+			legacyFields(a->fields, QString(), e.fields);
+			e.toBlock(blk);
+		}
+		break;
+		}
+		return;
+	}
+
+	//Generic entries only gained a group in the current revision
+	const generic *g = static_cast<const generic *>(current);
+	switch (revision) {
+	case 0: {
+		generic_1 e(id);
+		e.typeName = typeName;
+		e.name = g->name;
+		legacyFields(g->fields, QString(), e.fields);
+		e.toBlock(blk);
+	}
+	break;
+	case 1: {
+		generic_2 e(id);
+		e.typeName = typeName;
+		e.name = g->name;
+		legacyFields(g->fields, QString(), e.fields);
+		e.toBlock(blk);
+	}
+	break;
+	case 2: {
+		generic_3 e(id);
+		e.typeName = typeName;
+		e.name = g->name;
+		e.fields = g->fields;
+		e.toBlock(blk);
+	}
+	break;
+	case 3: {
+		generic_4 e(id);
+		e.typeId = g->typeId;
+		e.name = g->name;
+		e.fields = g->fields;
+		e.toBlock(blk);
+	}
+	break;
+	}
+}
+
+VaultGenerator::VaultGenerator(const vaultGeneratorParams &params) :
+	m_params(params),
+	m_rng(params.seed),
+	m_maxEntrySize(0),
+	m_trimmed(0)
+{
+	buildPaths(QString(), 1);
+}
+
+int VaultGenerator::random(int lo, int hi)
+{
+	std::uniform_int_distribution<int> d(lo, hi);
+	return d(m_rng);
+}
+
+QString VaultGenerator::word()
+{
+	return QString(s_words[random(0, (sizeof(s_words) / sizeof(s_words[0])) - 1)]);
+}
+
+QString VaultGenerator::text(int length)
+{
+	static const char chars[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789 ";
+	QString s;
+	s.reserve(length);
+	for (int i = 0; i < length; i++) {
+		s.append(QChar(chars[random(0, sizeof(chars) - 2)]));
+	}
+	return s;
+}
+
+void VaultGenerator::buildPaths(const QString &prefix, int depth)
+{
+	if (depth > m_params.pathDepth) {
+		return;
+	}
+	for (int i = 0; i < m_params.pathFanout && m_paths.size() < VAULT_GENERATOR_MAX_PATHS; i++) {
+		QString name = (depth == 1 ? "Group " : "Sub ") + QString::number(i + 1);
+		QString p = prefix.size() ? prefix + "/" + name : name;
+		m_paths.append(p);
+		buildPaths(p, depth + 1);
+	}
+}
+
+QString VaultGenerator::path()
+{
+	if (m_paths.isEmpty() || random(1, 100) > m_params.groupedPercent) {
+		return QString();
+	}
+	return m_paths.at(random(0, m_paths.size() - 1));
+}
+
+esdbEntry *VaultGenerator::makeAccount(int id, int index)
+{
+	QString site = word() + word() + QString::number(index);
+	QString userName = word() + "user" + QString::number(index);
+	QString url = "https://www." + site + ".example.com/login";
+	QString password = text(16);
+	account *a = new account(id);
+	a->acctName = site;
+	a->userName = userName;
+	a->password = password;
+	a->url = url;
+	a->email = userName + "@example.com";
+	a->path = path();
+	for (int i = 0; i < m_params.accountFields; i++) {
+		a->fields.addField(genericField("Note " + QString::number(i + 1), "Text", text(m_params.fieldSize)));
+	}
+	return a;
+}
+
+esdbEntry *VaultGenerator::makeBookmark(int id, int index)
+{
+	bookmark *b = new bookmark(id);
+	b->name = word() + " " + word() + " " + QString::number(index);
+	b->url = "https://" + word() + QString::number(index) + ".example.com/" + word();
+	return b;
+}
+
+esdbEntry *VaultGenerator::makeGeneric(int id, int index)
+{
+	genericTypeDesc *desc = m_typeDescs.at(random(0, m_typeDescs.size() - 1));
+	generic *g = new generic(id);
+	g->typeId = desc->typeId;
+	g->name = desc->name + " " + word() + " " + QString::number(index);
+	g->path = path();
+	for (const fieldSpec &spec : desc->fields) {
+		int length = m_params.fieldSize;
+		if (spec.type == "Text block") {
+			length *= 4;
+		}
+		g->fields.addField(genericField(spec.name, spec.type, text(length)));
+	}
+	return g;
+}
+
+int VaultGenerator::pickRevision(const QMap<int, int> &revisions)
+{
+	if (revisions.isEmpty()) {
+		return -1;
+	}
+	int pick = random(1, 100);
+	for (auto iter = revisions.begin(); iter != revisions.end(); iter++) {
+		if (pick <= iter.value()) {
+			return iter.key();
+		}
+		pick -= iter.value();
+	}
+	return -1;
+}
+
+esdbEntry *VaultGenerator::makeLegacy(esdbEntry *entry)
+{
+	int revision = -1;
+	if (entry->type == ESDB_TYPE_ACCOUNT) {
+		revision = pickRevision(m_params.accountRevisions);
+	} else if (entry->type == ESDB_TYPE_GENERIC) {
+		revision = pickRevision(m_params.genericRevisions);
+	}
+	if (revision < 0) {
+		return entry;
+	}
+	legacyEntry *l = new legacyEntry(entry, revision);
+	if (entry->type == ESDB_TYPE_GENERIC) {
+		//Type descriptions get ids from 1 in order
+		l->typeName = m_typeDescs.at(static_cast<generic *>(entry)->typeId - 1)->name;
+	}
+	return l;
+}
+
+void VaultGenerator::fit(esdbEntry *entry, esdbEntry *current)
+{
+	if (m_maxEntrySize <= 0) {
+		return;
+	}
+	genericFields *fields = nullptr;
+	if (current->type == ESDB_TYPE_ACCOUNT) {
+		fields = &static_cast<account *>(current)->fields;
+	} else if (current->type == ESDB_TYPE_GENERIC) {
+		fields = &static_cast<generic *>(current)->fields;
+	}
+	bool trimmed = false;
+	while (true) {
+		block blk;
+		entry->toBlock(&blk);
+		if (blk.data.size() <= m_maxEntrySize || !fields || !fields->fieldCount()) {
+			break;
+		}
+		fields->removeField(fields->fieldCount() - 1);
+		trimmed = true;
+	}
+	if (trimmed) {
+		m_trimmed++;
+	}
+}
+
+QList<esdbEntry *> VaultGenerator::generate(int firstId, int maxId)
+{
+	QList<esdbEntry *> entries;
+	int id = firstId;
+	int count = qMin(m_params.entryCount, maxId - firstId + 1);
+
+	int genericWeight = m_params.genericWeight;
+	int typeCount = genericWeight > 0 ? qMin(m_params.genericTypes, count) : 0;
+	for (int i = 0; i < typeCount; i++) {
+		genericTypeDesc *desc = new genericTypeDesc(id++);
+		desc->typeId = i + 1;
+		desc->name = "Type " + QString::number(i + 1) + " " + word();
+		for (int j = 0; j < m_params.fieldsPerType; j++) {
+			QString type = s_fieldTypes[random(0, (sizeof(s_fieldTypes) / sizeof(s_fieldTypes[0])) - 1)];
+			desc->fields.append(fieldSpec("Field " + QString::number(j + 1), type));
+		}
+		m_typeDescs.append(desc);
+		entries.append(desc);
+	}
+	if (m_typeDescs.isEmpty()) {
+		genericWeight = 0;
+	}
+
+	int totalWeight = m_params.accountWeight + m_params.bookmarkWeight + genericWeight;
+	for (int i = typeCount; i < count; i++) {
+		esdbEntry *current;
+		int pick = totalWeight > 0 ? random(1, totalWeight) : 1;
+		if (pick <= m_params.accountWeight || totalWeight <= 0) {
+			current = makeAccount(id, i);
+		} else if (pick <= m_params.accountWeight + m_params.bookmarkWeight) {
+			current = makeBookmark(id, i);
+		} else {
+			current = makeGeneric(id, i);
+		}
+		esdbEntry *entry = makeLegacy(current);
+		fit(entry, current);
+		entries.append(entry);
+		id++;
+	}
+	m_typeDescs.clear();
+	return entries;
+}
+
+QString VaultGenerator::parseRevisions(const QString &spec, vaultGeneratorParams &params)
+{
+	QMap<int, int> accountRevisions;
+	QMap<int, int> genericRevisions;
+	for (const QString &item : spec.split(",")) {
+		if (item.isEmpty()) {
+			continue;
+		}
+		QStringList kv = item.split("=");
+		QStringList tr = kv.at(0).split(":");
+		bool revisionOk = false;
+		bool percentOk = false;
+		int revision = tr.size() == 2 ? tr.at(1).toInt(&revisionOk) : -1;
+		int percent = kv.size() == 2 ? kv.at(1).toInt(&percentOk) : -1;
+		if (!revisionOk || !percentOk || percent < 0) {
+			return "Expected type:revision=percent, got \"" + item + "\"";
+		}
+		if (tr.at(0) == "account" && revision >= 0 && revision < VAULT_GENERATOR_ACCOUNT_REVISIONS) {
+			accountRevisions.insert(revision, percent);
+		} else if (tr.at(0) == "generic" && revision >= 0 && revision < VAULT_GENERATOR_GENERIC_REVISIONS) {
+			genericRevisions.insert(revision, percent);
+		} else {
+			return "No older revision \"" + kv.at(0) + "\"";
+		}
+	}
+	int accountTotal = 0;
+	for (int percent : accountRevisions) {
+		accountTotal += percent;
+	}
+	int genericTotal = 0;
+	for (int percent : genericRevisions) {
+		genericTotal += percent;
+	}
+	if (accountTotal > 100 || genericTotal > 100) {
+		return "Revision percentages add up to more than 100";
+	}
+	params.accountRevisions = accountRevisions;
+	params.genericRevisions = genericRevisions;
+	return QString();
+}
+
+QString VaultGenerator::revisionsString(const vaultGeneratorParams &params)
+{
+	QStringList items;
+	for (auto iter = params.accountRevisions.begin(); iter != params.accountRevisions.end(); iter++) {
+		items.append("account:" + QString::number(iter.key()) + "=" + QString::number(iter.value()));
+	}
+	for (auto iter = params.genericRevisions.begin(); iter != params.genericRevisions.end(); iter++) {
+		items.append("generic:" + QString::number(iter.key()) + "=" + QString::number(iter.value()));
+	}
+	return items.join(",");
+}
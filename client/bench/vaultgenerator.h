@@ -0,0 +1,99 @@
+#ifndef VAULTGENERATOR_H
+#define VAULTGENERATOR_H
+
+#include <QList>
+#include <QMap>
+#include <QString>
+#include <QStringList>
+
+#include <random>
+
+struct esdbEntry;
+struct genericTypeDesc;
+
+struct vaultGeneratorParams {
+	//Entries to generate, including generic type descriptions
+	int entryCount;
+	//Relative weights of accounts, bookmarks and generic entries
+	int accountWeight;
+	int bookmarkWeight;
+	int genericWeight;
+	int genericTypes;
+	//Fields per generic type, and extra generic fields per account
+	int fieldsPerType;
+	int accountFields;
+	//Group tree: depth levels of fanout subgroups each
+	int pathDepth;
+	int pathFanout;
+	int groupedPercent;
+	//Characters in each generated field value
+	int fieldSize;
+	//Percentage of accounts and of generic entries written in each older
+	//revision, keyed by revision. The rest use the current revision.
+	QMap<int, int> accountRevisions;
+	QMap<int, int> genericRevisions;
+	unsigned int seed;
+
+	vaultGeneratorParams() :
+		entryCount(1000),
+		accountWeight(70),
+		bookmarkWeight(10),
+		genericWeight(20),
+		genericTypes(8),
+		fieldsPerType(4),
+		accountFields(1),
+		pathDepth(3),
+		pathFanout(4),
+		groupedPercent(60),
+		fieldSize(24),
+		seed(1)
+	{
+		accountRevisions.insert(3, 10);
+	}
+};
+
+//
+// Builds a reproducible synthetic vault. The same parameters always produce
+// the same entries, serialized through the regular toBlock() methods.
+//
+class VaultGenerator
+{
+	vaultGeneratorParams m_params;
+	std::mt19937 m_rng;
+	QStringList m_paths;
+	QList<genericTypeDesc *> m_typeDescs;
+	int m_maxEntrySize;
+	int m_trimmed;
+	int random(int lo, int hi);
+	QString word();
+	QString text(int length);
+	QString path();
+	void buildPaths(const QString &prefix, int depth);
+	esdbEntry *makeAccount(int id, int index);
+	esdbEntry *makeBookmark(int id, int index);
+	esdbEntry *makeGeneric(int id, int index);
+	int pickRevision(const QMap<int, int> &revisions);
+	esdbEntry *makeLegacy(esdbEntry *entry);
+	void fit(esdbEntry *entry, esdbEntry *current);
+public:
+	explicit VaultGenerator(const vaultGeneratorParams &params);
+	//Parse older revision shares such as "account:0=5,generic:3=10" into
+	//params. Returns an empty string or what is wrong with spec.
+	static QString parseRevisions(const QString &spec, vaultGeneratorParams &params);
+	static QString revisionsString(const vaultGeneratorParams &params);
+	//Drop generic fields from entries that would serialize to more than
+	//size bytes
+	void setMaxEntrySize(int size)
+	{
+		m_maxEntrySize = size;
+	}
+	//Entries with ids from firstId up to maxId, type descriptions first.
+	//The caller owns the entries.
+	QList<esdbEntry *> generate(int firstId, int maxId);
+	int trimmedEntries() const
+	{
+		return m_trimmed;
+	}
+};
+
+#endif // VAULTGENERATOR_H
@@ -89,9 +89,11 @@ HEADERS += websockethandler.h
 
 macx|gnu_linux {
 HEADERS += import/passimporter.h \
-    import/passimportunlockdialog.h
+    import/passimportunlockdialog.h \
+    import/passdecryptpool.h
 SOURCES += import/passimporter.cpp \
-    import/passimportunlockdialog.cpp
+    import/passimportunlockdialog.cpp \
+    import/passdecryptpool.cpp
 }
 
 win32 {
@@ -121,6 +123,7 @@ SOURCES += ../signet-base/signetdev/host/signetdev_unix.h
 #
 SOURCES += esdb/esdb.cpp \
     esdb/esdbtypemodule.cpp \
+    esdb/esdbentrytable.cpp \
     esdb/account/account.cpp \
     esdb/account/esdbaccountmodule.cpp \
     esdb/bookmark/bookmark.cpp \
@@ -133,6 +136,7 @@ SOURCES += esdb/esdb.cpp \
 
 HEADERS += esdb/esdb.h \
     esdb/esdbtypemodule.h \
+    esdb/esdbentrytable.h \
     esdb/account/account.h \
     esdb/account/esdbaccountmodule.h \
     esdb/bookmark/bookmark.h \
@@ -210,10 +214,14 @@ HEADERS +=  esdb-gui/esdbmodel.h \
 #
 
 SOURCES += signetapplication.cpp \
-        keygeneratorthread.cpp
+        keyderivationservice.cpp \
+        commandtracer.cpp \
+        signetcommands.cpp
 
 HEADERS  += signetapplication.h \
-        keygeneratorthread.h
+        keyderivationservice.h \
+        commandtracer.h \
+        signetcommands.h
 
 #
 # QtCSV
@@ -234,19 +242,23 @@ SOURCES += ../scrypt/crypto_scrypt.c \
     ../scrypt/insecure_memzero.c \
     ../scrypt/sha256.c \
     ../scrypt/warnp.c \
-    ../scrypt/crypto_scrypt_smix.c
+    ../scrypt/crypto_scrypt_smix.c \
+    ../scrypt/crypto_scrypt_calibrate.c
 
 HEADERS += ../scrypt/crypto_scrypt_smix.h \
     ../scrypt/crypto_scrypt.h \
     ../scrypt/insecure_memzero.h \
     ../scrypt/sha256.h \
-    ../scrypt/warnp.h
+    ../scrypt/warnp.h \
+    ../scrypt/crypto_scrypt_calibrate.h
 
 
 
 use_sse {
-    SOURCES += ../scrypt/crypto_scrypt_smix_sse2.c
-    HEADERS += ../scrypt/crypto_scrypt_smix_sse2.h
+    SOURCES += ../scrypt/crypto_scrypt_smix_sse2.c \
+        ../scrypt/crypto_scrypt_smix_avx2.c
+    HEADERS += ../scrypt/crypto_scrypt_smix_sse2.h \
+        ../scrypt/crypto_scrypt_smix_avx2.h
 }
 
 gnu_linux|macx|win32 {
@@ -270,15 +282,19 @@ SOURCES += import/entryrenamedialog.cpp \
     import/databaseimporter.cpp \
     import/databaseimportcontroller.cpp \
     import/keepassimporter.cpp \
+    import/keepassreaderthread.cpp \
     import/csvimporter.cpp \
+    import/csvstreamreader.cpp \
     import/csvimportconfigure.cpp
 
 HEADERS += import/keepassunlockdialog.h \
     import/databaseimporter.h \
     import/databaseimportcontroller.h \
     import/keepassimporter.h \
+    import/keepassreaderthread.h \
     import/entryrenamedialog.h \
     import/csvimporter.h \
+    import/csvstreamreader.h \
     import/csvimportconfigure.h
 
 
@@ -303,7 +319,9 @@ SOURCES += desktop/main.cpp \
         desktop/loginwindow.cpp \
 	desktop/cleartextpasswordeditor.cpp \
 	desktop/cleartextpasswordselector.cpp \
-	desktop/datatypelistmodel.cpp
+	desktop/datatypelistmodel.cpp \
+	desktop/firmwareflashwriter.cpp \
+	desktop/entrymigrationcontroller.cpp
 
 
 HEADERS +=  desktop/mainwindow.h \
@@ -323,7 +341,9 @@ HEADERS +=  desktop/mainwindow.h \
         desktop/loginwindow.h \
 	desktop/cleartextpasswordeditor.h \
 	desktop/cleartextpasswordselector.h \
-	desktop/datatypelistmodel.h
+	desktop/datatypelistmodel.h \
+	desktop/firmwareflashwriter.h \
+	desktop/entrymigrationcontroller.h
 
 #
 # Qt single appliction
@@ -497,10 +517,12 @@ android {
 SOURCES += android/main.cpp \
         android/signetdevicemanager.cpp \
         android/esdbgroupmodel.cpp \
+        android/esdbentrymodel.cpp \
         android/jni/signetactivity.cpp
 
 HEADERS += android/signetdevicemanager.h \
-    android/esdbgroupmodel.h
+    android/esdbgroupmodel.h \
+    android/esdbentrymodel.h
 
 
 RESOURCES += android/qml.qrc
@@ -524,3 +546,17 @@ DISTFILES += \
 
 ANDROID_PACKAGE_SOURCE_DIR = $$PWD/android/package
 }
+
+#
+# Headless benchmark. Build with "qmake CONFIG+=signet_bench" to produce
+# signet-bench instead of the desktop client.
+#
+signet_bench {
+TARGET = signet-bench
+SOURCES -= desktop/main.cpp
+SOURCES += bench/main.cpp \
+        bench/signetbench.cpp \
+        bench/vaultgenerator.cpp
+HEADERS += bench/signetbench.h \
+        bench/vaultgenerator.h
+}
@@ -0,0 +1,277 @@
+#include "commandtracer.h"
+
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QMutexLocker>
+#include <QTextStream>
+
+extern "C" {
+#include "signetdev/host/signetdev.h"
+}
+
+CommandTracer *CommandTracer::g_singleton = nullptr;
+
+static const char *s_stageNames[CommandTracer::NUM_STAGES] = {"device", "queue", "handler"};
+
+CommandTracer::CommandTracer()
+{
+	m_clock.start();
+}
+
+void CommandTracer::start()
+{
+	if (!g_singleton) {
+		g_singleton = new CommandTracer();
+	}
+}
+
+void CommandTracer::stop()
+{
+	delete g_singleton;
+	g_singleton = nullptr;
+}
+
+QString CommandTracer::commandName(int cmd)
+{
+	switch (cmd) {
+	case SIGNETDEV_CMD_STARTUP:
+		return "STARTUP";
+	case SIGNETDEV_CMD_LOGIN:
+		return "LOGIN";
+	case SIGNETDEV_CMD_LOGOUT:
+		return "LOGOUT";
+	case SIGNETDEV_CMD_DISCONNECT:
+		return "DISCONNECT";
+	case SIGNETDEV_CMD_WIPE:
+		return "WIPE";
+	case SIGNETDEV_CMD_BUTTON_WAIT:
+		return "BUTTON_WAIT";
+	case SIGNETDEV_CMD_GET_PROGRESS:
+		return "GET_PROGRESS";
+	case SIGNETDEV_CMD_GET_RAND_BITS:
+		return "GET_RAND_BITS";
+	case SIGNETDEV_CMD_TYPE:
+		return "TYPE";
+	case SIGNETDEV_CMD_READ_UID:
+		return "READ_UID";
+	case SIGNETDEV_CMD_UPDATE_UID:
+		return "UPDATE_UID";
+	case SIGNETDEV_CMD_UPDATE_UIDS:
+		return "UPDATE_UIDS";
+	case SIGNETDEV_CMD_READ_ALL_UIDS:
+		return "READ_ALL_UIDS";
+	case SIGNETDEV_CMD_READ_BLOCK:
+		return "READ_BLOCK";
+	case SIGNETDEV_CMD_WRITE_BLOCK:
+		return "WRITE_BLOCK";
+	case SIGNETDEV_CMD_BEGIN_DEVICE_BACKUP:
+		return "BEGIN_DEVICE_BACKUP";
+	case SIGNETDEV_CMD_END_DEVICE_BACKUP:
+		return "END_DEVICE_BACKUP";
+	case SIGNETDEV_CMD_BEGIN_DEVICE_RESTORE:
+		return "BEGIN_DEVICE_RESTORE";
+	case SIGNETDEV_CMD_END_DEVICE_RESTORE:
+		return "END_DEVICE_RESTORE";
+	case SIGNETDEV_CMD_BEGIN_UPDATE_FIRMWARE:
+		return "BEGIN_UPDATE_FIRMWARE";
+	case SIGNETDEV_CMD_ERASE_PAGES:
+		return "ERASE_PAGES";
+	case SIGNETDEV_CMD_WRITE_FLASH:
+		return "WRITE_FLASH";
+	case SIGNETDEV_CMD_RESET_DEVICE:
+		return "RESET_DEVICE";
+	case SIGNETDEV_CMD_SWITCH_BOOT_MODE:
+		return "SWITCH_BOOT_MODE";
+	case SIGNETDEV_CMD_READ_CLEARTEXT_PASSWORD_NAMES:
+		return "READ_CLEARTEXT_PASSWORD_NAMES";
+	case SIGNETDEV_CMD_READ_CLEARTEXT_PASSWORD:
+		return "READ_CLEARTEXT_PASSWORD";
+	default:
+		return "CMD_" + QString::number(cmd);
+	}
+}
+
+void CommandTracer::stageStats::add(qint64 us)
+{
+	int b = 0;
+	while (b < COMMAND_TRACER_BUCKETS - 1 && (Q_INT64_C(1) << b) <= us) {
+		b++;
+	}
+	buckets[b]++;
+	samples++;
+	totalUs += us;
+	if (us > maxUs) {
+		maxUs = us;
+	}
+}
+
+void CommandTracer::record(int stage, int cmd, int token, qint64 start, qint64 end)
+{
+	QVector<stageStats> &stats = m_stats[cmd];
+	if (stats.isEmpty()) {
+		stats.resize(NUM_STAGES);
+	}
+	stats[stage].add(end - start);
+	if (m_events.size() < COMMAND_TRACER_MAX_EVENTS) {
+		traceEvent e;
+		e.stage = stage;
+		e.cmd = cmd;
+		e.token = token;
+		e.start = start;
+		e.end = end;
+		m_events.append(e);
+	}
+}
+
+void CommandTracer::recordIssued(int token)
+{
+	QMutexLocker locker(&m_lock);
+	//The emulator can answer before the call site gets here. The device
+	//stage of that first message is unknown then.
+	if (m_pending.contains(token)) {
+		return;
+	}
+	pendingCommand p;
+	p.last = now();
+	p.received = -1;
+	p.dispatched = -1;
+	p.cmd = -1;
+	m_pending.insert(token, p);
+}
+
+void CommandTracer::recordReceived(int token, int cmd)
+{
+	QMutexLocker locker(&m_lock);
+	qint64 t = now();
+	auto iter = m_pending.find(token);
+	if (iter == m_pending.end()) {
+		pendingCommand p;
+		p.last = -1;
+		iter = m_pending.insert(token, p);
+	}
+	iter->cmd = cmd;
+	iter->received = t;
+	iter->dispatched = -1;
+	if (iter->last >= 0) {
+		record(STAGE_DEVICE, cmd, token, iter->last, t);
+	}
+	iter->last = t;
+}
+
+void CommandTracer::recordDispatched(int token)
+{
+	QMutexLocker locker(&m_lock);
+	qint64 t = now();
+	auto iter = m_pending.find(token);
+	if (iter == m_pending.end() || iter->received < 0) {
+		return;
+	}
+	iter->dispatched = t;
+	record(STAGE_QUEUE, iter->cmd, token, iter->received, t);
+}
+
+void CommandTracer::recordHandled(int token, int messagesRemaining)
+{
+	QMutexLocker locker(&m_lock);
+	qint64 t = now();
+	auto iter = m_pending.find(token);
+	if (iter == m_pending.end()) {
+		return;
+	}
+	if (iter->dispatched >= 0) {
+		record(STAGE_HANDLER, iter->cmd, token, iter->dispatched, t);
+	}
+	if (!messagesRemaining) {
+		m_pending.erase(iter);
+	}
+}
+
+QJsonObject CommandTracer::histograms()
+{
+	QJsonObject o;
+	if (!g_singleton) {
+		return o;
+	}
+	QMutexLocker locker(&g_singleton->m_lock);
+	for (auto iter = g_singleton->m_stats.constBegin(); iter != g_singleton->m_stats.constEnd(); iter++) {
+		QJsonObject cmd;
+		for (int s = 0; s < NUM_STAGES; s++) {
+			const stageStats &stats = iter.value().at(s);
+			if (!stats.samples) {
+				continue;
+			}
+			QJsonObject stage;
+			stage["samples"] = stats.samples;
+			stage["mean_us"] = (double)stats.totalUs / stats.samples;
+			stage["max_us"] = (double)stats.maxUs;
+			//Bucket i holds samples below 2^i microseconds
+			QJsonArray buckets;
+			int seen = 0;
+			for (int b = 0; b < COMMAND_TRACER_BUCKETS; b++) {
+				int n = stats.buckets.at(b);
+				if (!n) {
+					continue;
+				}
+				int before = seen;
+				seen += n;
+				QJsonObject bucket;
+				bucket["below_us"] = (double)(Q_INT64_C(1) << b);
+				bucket["count"] = n;
+				buckets.append(bucket);
+				if (before * 2 < stats.samples && seen * 2 >= stats.samples) {
+					stage["p50_below_us"] = (double)(Q_INT64_C(1) << b);
+				}
+				if (before * 100 < stats.samples * 99 && seen * 100 >= stats.samples * 99) {
+					stage["p99_below_us"] = (double)(Q_INT64_C(1) << b);
+				}
+			}
+			stage["buckets"] = buckets;
+			cmd[s_stageNames[s]] = stage;
+		}
+		o[commandName(iter.key())] = cmd;
+	}
+	return o;
+}
+
+bool CommandTracer::writeTrace(const QString &fileName)
+{
+	if (!g_singleton) {
+		return false;
+	}
+	QJsonObject hist = histograms();
+	QFile f(fileName);
+	if (!f.open(QFile::WriteOnly | QFile::Truncate)) {
+		return false;
+	}
+	QMutexLocker locker(&g_singleton->m_lock);
+	QTextStream out(&f);
+	out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"signet client\"}},\n";
+	out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"GUI thread\"}}";
+	for (const traceEvent &e : g_singleton->m_events) {
+		QString name = commandName(e.cmd);
+		const char *stage = s_stageNames[e.stage];
+		if (e.stage == STAGE_HANDLER) {
+			//Handlers run one at a time on the GUI thread and nest properly
+			out << ",\n{\"name\":\"" << name << "\",\"cat\":\"" << stage <<
+			    "\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":" << e.start <<
+			    ",\"dur\":" << (e.end - e.start) <<
+			    ",\"args\":{\"token\":" << e.token << "}}";
+		} else {
+			//Several commands can be on the device or in the queue at
+			//once, so these are async spans matched by token
+			out << ",\n{\"name\":\"" << name << "\",\"cat\":\"" << stage <<
+			    "\",\"ph\":\"b\",\"pid\":1,\"tid\":1,\"id\":" << e.token <<
+			    ",\"ts\":" << e.start << "}";
+			out << ",\n{\"name\":\"" << name << "\",\"cat\":\"" << stage <<
+			    "\",\"ph\":\"e\",\"pid\":1,\"tid\":1,\"id\":" << e.token <<
+			    ",\"ts\":" << e.end << "}";
+		}
+	}
+	out << "\n],\n\"otherData\":";
+	out << QString::fromUtf8(QJsonDocument(hist).toJson(QJsonDocument::Compact));
+	out << "}\n";
+	out.flush();
+	return f.error() == QFile::NoError;
+}
@@ -0,0 +1,129 @@
+#ifndef COMMANDTRACER_H
+#define COMMANDTRACER_H
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QJsonObject>
+#include <QMap>
+#include <QMutex>
+#include <QString>
+#include <QVector>
+
+//Histogram buckets are powers of two microseconds, the last one holds
+//everything from about 33 seconds up
+#define COMMAND_TRACER_BUCKETS 26
+
+//Trace events past this many are only counted in the histograms
+#define COMMAND_TRACER_MAX_EVENTS 1000000
+
+//
+// Opt-in latency tracing for device commands. Every response message is
+// split in three stages:
+//
+// device:  command issued (or previous message received) to signetdev callback
+// queue:   signetdev callback to dispatch on the GUI thread
+// handler: the slots connected to the response signal
+//
+// Each stage feeds a latency histogram per SIGNETDEV_CMD_* and a trace event.
+// writeTrace() saves the events in Chrome's trace event format, for
+// chrome://tracing or Perfetto. All entry points are static and do nothing
+// until start() is called.
+//
+class CommandTracer
+{
+public:
+	enum stage {
+		STAGE_DEVICE,
+		STAGE_QUEUE,
+		STAGE_HANDLER,
+		NUM_STAGES
+	};
+private:
+	struct pendingCommand {
+		//Issue time, then the time the latest message was received. -1
+		//when the response beat issued() or the call site isn't traced
+		qint64 last;
+		qint64 received;
+		qint64 dispatched;
+		int cmd;
+	};
+	struct stageStats {
+		QVector<int> buckets;
+		int samples;
+		qint64 totalUs;
+		qint64 maxUs;
+		stageStats() :
+			buckets(COMMAND_TRACER_BUCKETS, 0),
+			samples(0),
+			totalUs(0),
+			maxUs(0)
+		{
+		}
+		void add(qint64 us);
+	};
+	struct traceEvent {
+		int stage;
+		int cmd;
+		int token;
+		qint64 start;
+		qint64 end;
+	};
+	static CommandTracer *g_singleton;
+	QMutex m_lock;
+	QElapsedTimer m_clock;
+	QHash<int, pendingCommand> m_pending;
+	QMap<int, QVector<stageStats> > m_stats;
+	QVector<traceEvent> m_events;
+	CommandTracer();
+	qint64 now()
+	{
+		return m_clock.nsecsElapsed() / 1000;
+	}
+	void record(int stage, int cmd, int token, qint64 start, qint64 end);
+	void recordIssued(int token);
+	void recordReceived(int token, int cmd);
+	void recordDispatched(int token);
+	void recordHandled(int token, int messagesRemaining);
+public:
+	static void start();
+	static void stop();
+	static bool isEnabled()
+	{
+		return g_singleton != nullptr;
+	}
+	static QString commandName(int cmd);
+
+	//Call right after a signetdev_* call returns its token
+	static void issued(int token)
+	{
+		if (g_singleton) {
+			g_singleton->recordIssued(token);
+		}
+	}
+	//From the signetdev callback thread
+	static void received(int token, int cmd)
+	{
+		if (g_singleton) {
+			g_singleton->recordReceived(token, cmd);
+		}
+	}
+	//From the GUI thread, around emitting the response signal
+	static void dispatched(int token)
+	{
+		if (g_singleton) {
+			g_singleton->recordDispatched(token);
+		}
+	}
+	static void handled(int token, int messagesRemaining)
+	{
+		if (g_singleton) {
+			g_singleton->recordHandled(token, messagesRemaining);
+		}
+	}
+
+	//Per command latency histograms, keyed by command name
+	static QJsonObject histograms();
+	static bool writeTrace(const QString &fileName);
+};
+
+#endif // COMMANDTRACER_H
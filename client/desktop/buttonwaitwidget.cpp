@@ -59,6 +59,7 @@ void ButtonWaitWidget::updateText()
 void ButtonWaitWidget::resetTimeout()
 {
 	m_timeLeft = sTimeoutPeriod;
+	m_timeoutOccured = false;
 	updateText();
 }
 
@@ -25,18 +25,10 @@ ChangeMasterPassword::ChangeMasterPassword(QWidget *parent) :
 	m_newPasswordEdit(nullptr),
 	m_newPasswordRepeatEdit(nullptr),
 	m_buttonDialog(nullptr),
-	m_generatingOldKey(false),
-	m_generatingNewKey(false),
+	m_oldKeyDerivation(nullptr),
+	m_newKeyDerivation(nullptr),
 	m_signetdevCmdToken(-1)
 {
-	m_keyGenerator = new KeyGeneratorThread();
-	QObject::connect(m_keyGenerator, SIGNAL(finished()), this, SLOT(keyGenerated()));
-
-	SignetApplication *app = SignetApplication::get();
-
-	connect(app, SIGNAL(signetdevCmdResp(signetdevCmdRespInfo)), this,
-		SLOT(signetdevCmdResp(signetdevCmdRespInfo)));
-
 	setWindowModality(Qt::WindowModal);
 
 	setWindowTitle("Change Master Password");
@@ -72,23 +64,23 @@ ChangeMasterPassword::ChangeMasterPassword(QWidget *parent) :
 	m_changePasswordBtn = new QPushButton("Change password");
 	m_changePasswordBtn->setAutoDefault(true);
 
-	m_authSecurityLevel = new QSpinBox();
-	m_authSecurityLevel->setRange(1, 8);
-	m_authSecurityLevel->setValue(4);
+	m_unlockTime = new QSpinBox();
+	m_unlockTime->setRange(1, 60);
+	m_unlockTime->setValue(DEFAULT_UNLOCK_TIME_SECONDS);
 
-	auto securityLevelEdit = new QHBoxLayout();
-	securityLevelEdit->addWidget(new genericText("New security level (1-8)"));
-	securityLevelEdit->addWidget(m_authSecurityLevel);
+	auto unlockTimeEdit = new QHBoxLayout();
+	unlockTimeEdit->addWidget(new genericText("New unlock time in seconds (1-60)"));
+	unlockTimeEdit->addWidget(m_unlockTime);
 
-	m_securityLevelComment = new noteText("Note: The security level controls how long it takes to unlock your device. A value of (4) will secure your data against for most threats and allow you to unlock your device in 1-2 seconds. A value of (8) could increase login times to over a minute.");
+	m_unlockTimeComment = new noteText("Note: The login key is made as strong as this computer can derive it within the unlock time. Longer times make your password harder to guess. Slower computers will take longer to unlock your device.");
 
 	layout->addLayout(old_password_layout);
 	layout->addWidget(m_oldPasswordWarningMessage);
 	layout->addLayout(new_password_layout);
 	layout->addLayout(new_password_repeat_layout);
 	layout->addWidget(m_newPasswordWarningMessage);
-	layout->addLayout(securityLevelEdit);
-	layout->addWidget(m_securityLevelComment);
+	layout->addLayout(unlockTimeEdit);
+	layout->addWidget(m_unlockTimeComment);
 	layout->addWidget(m_generatingKeys);
 	layout->addWidget(m_changePasswordBtn);
 	setLayout(layout);
@@ -101,16 +93,19 @@ ChangeMasterPassword::ChangeMasterPassword(QWidget *parent) :
 
 void ChangeMasterPassword::keyGenerated()
 {
-	if (m_generatingOldKey) {
-		m_generatingOldKey = false;
-		m_generatingNewKey = true;
-		m_oldKey = m_keyGenerator->getKey();
-		int keyLength = SignetApplication::get()->getKeyLength();
-		m_keyGenerator->setParams(this->m_newPasswordEdit->text(), m_newHashfn, m_newSalt, keyLength);
-		m_keyGenerator->start();
-	} else if (m_generatingNewKey) {
-		m_generatingNewKey = false;
-		m_newKey = m_keyGenerator->getKey();
+	if (sender() == m_oldKeyDerivation && m_oldKeyDerivation) {
+		m_oldKey = m_oldKeyDerivation->takeKey();
+		m_oldKeyDerivation->release();
+		m_oldKeyDerivation = nullptr;
+	} else if (sender() == m_newKeyDerivation && m_newKeyDerivation) {
+		m_newKey = m_newKeyDerivation->takeKey();
+		m_newHashfn = m_newKeyDerivation->getHashfn();
+		m_newKeyDerivation->release();
+		m_newKeyDerivation = nullptr;
+	} else {
+		return;
+	}
+	if (!m_oldKeyDerivation && !m_newKeyDerivation) {
 		m_generatingKeys->hide();
 		m_buttonDialog = new ButtonWaitDialog("Change Master Password", "change master password", this, true);
 		connect(m_buttonDialog, SIGNAL(finished(int)), this, SLOT(changePasswordFinished(int)));
@@ -120,16 +115,27 @@ void ChangeMasterPassword::keyGenerated()
                            (u8 *)m_newKey.data(), m_newKey.length(),
                            (u8 *)m_newHashfn.data(), m_newHashfn.length(),
                            (u8 *)m_newSalt.data(), m_newSalt.length());
+		SignetApplication::routeResponses(m_signetdevCmdToken, this);
 	}
 }
 
+void ChangeMasterPassword::releaseKeys()
+{
+	if (m_oldKeyDerivation) {
+		m_oldKeyDerivation->release();
+		m_oldKeyDerivation = nullptr;
+	}
+	if (m_newKeyDerivation) {
+		m_newKeyDerivation->release();
+		m_newKeyDerivation = nullptr;
+	}
+	SignetApplication::wipeKey(m_oldKey);
+	SignetApplication::wipeKey(m_newKey);
+}
+
 ChangeMasterPassword::~ChangeMasterPassword()
 {
-	m_generatingOldKey = false;
-	m_generatingNewKey = false;
-	m_keyGenerator->wait();
-	m_keyGenerator->deleteLater();
-	m_keyGenerator = nullptr;
+	releaseKeys();
 }
 
 void ChangeMasterPassword::newPasswordTextEdited(QString s)
@@ -156,33 +162,30 @@ void ChangeMasterPassword::changePasswordUi()
 		for (int i = 0; i < (SALT_SZ_V2/4); i++) {
 			*((uint32_t *)(m_newSalt.data() + (i*4))) = rd();
 		}
-		m_newHashfn.resize(HASH_FN_SZ);
-		m_newHashfn.data()[0] = 1;
-		m_newHashfn.data()[1] = 11 + m_authSecurityLevel->value();
-		m_newHashfn.data()[2] = 8;
-		m_newHashfn.data()[3] = 0;
-		m_newHashfn.data()[4] = 1;
-
 		m_newPasswordEdit->setEnabled(false);
 		m_oldPasswordEdit->setEnabled(false);
 		m_changePasswordBtn->setEnabled(false);
 		m_generatingKeys->show();
-		m_generatingOldKey = true;
-		m_generatingNewKey = false;
 		SignetApplication *app = SignetApplication::get();
 		QByteArray current_hashfn = app->getHashfn();
 		QByteArray current_salt = app->getSalt();
 		int keyLength = app->getKeyLength();
-		m_securityLevelComment->hide();
-		m_keyGenerator->setParams(this->m_oldPasswordEdit->text(), current_hashfn, current_salt, keyLength);
-		m_keyGenerator->start();
+		m_unlockTimeComment->hide();
+		releaseKeys();
+		//The new key is queued first so that its calibration runs alone;
+		//the old key is then derived alongside it
+		KeyDerivationService *service = KeyDerivationService::get();
+		m_newKeyDerivation = service->deriveCalibrated(this->m_newPasswordEdit->text(), m_unlockTime->value() * 1000, m_newSalt, keyLength);
+		m_oldKeyDerivation = service->derive(this->m_oldPasswordEdit->text(), current_hashfn, current_salt, keyLength);
+		connect(m_newKeyDerivation, SIGNAL(finished()), this, SLOT(keyGenerated()));
+		connect(m_oldKeyDerivation, SIGNAL(finished()), this, SLOT(keyGenerated()));
 	}
 }
 
 void ChangeMasterPassword::changePasswordFinished(int code)
 {
 	if (code != QMessageBox::Ok) {
-		m_securityLevelComment->show();
+		m_unlockTimeComment->show();
 		::signetdev_cancel_button_wait();
 		m_changePasswordBtn->setEnabled(true);
 	}
@@ -196,6 +199,8 @@ void ChangeMasterPassword::signetdevCmdResp(signetdevCmdRespInfo info)
 		return;
 	}
 	m_signetdevCmdToken = -1;
+	SignetApplication::wipeKey(m_oldKey);
+	SignetApplication::wipeKey(m_newKey);
 	if (m_buttonDialog) {
 		m_buttonDialog->done(QMessageBox::Ok);
 		m_buttonDialog->deleteLater();
@@ -208,7 +213,7 @@ void ChangeMasterPassword::signetdevCmdResp(signetdevCmdRespInfo info)
 		connect(box, SIGNAL(finished(int)), this, SLOT(close()));
 		SignetApplication::get()->setHashfn(m_newHashfn);
 		SignetApplication::get()->setSalt(m_newSalt);
-		m_securityLevelComment->show();
+		m_unlockTimeComment->show();
 	}
 	break;
 	case BAD_PASSWORD:
@@ -217,14 +222,14 @@ void ChangeMasterPassword::signetdevCmdResp(signetdevCmdRespInfo info)
 		m_newPasswordEdit->setEnabled(true);
 		m_oldPasswordEdit->setEnabled(true);
 		m_changePasswordBtn->setEnabled(true);
-		m_securityLevelComment->show();
+		m_unlockTimeComment->show();
 		break;
 	case BUTTON_PRESS_TIMEOUT:
 	case BUTTON_PRESS_CANCELED:
 		m_newPasswordEdit->setEnabled(true);
 		m_oldPasswordEdit->setEnabled(true);
 		m_changePasswordBtn->setEnabled(true);
-		m_securityLevelComment->show();
+		m_unlockTimeComment->show();
 		break;
 	case SIGNET_ERROR_DISCONNECT:
 	case SIGNET_ERROR_QUIT:
@@ -4,7 +4,7 @@
 #include <QDialog>
 #include <QString>
 
-#include "keygeneratorthread.h"
+#include "keyderivationservice.h"
 #include "signetapplication.h"
 
 class CommThread;
@@ -26,16 +26,16 @@ class ChangeMasterPassword : public QDialog
 	QLineEdit *m_newPasswordRepeatEdit;
 	ButtonWaitDialog *m_buttonDialog;
 	QPushButton *m_changePasswordBtn;
-	KeyGeneratorThread *m_keyGenerator;
-	bool m_generatingOldKey;
-	bool m_generatingNewKey;
+	KeyDerivation *m_oldKeyDerivation;
+	KeyDerivation *m_newKeyDerivation;
+	void releaseKeys();
 	QByteArray m_oldKey;
 	QByteArray m_newKey;
 	QByteArray m_newHashfn;
 	QByteArray m_newSalt;
 	int m_signetdevCmdToken;
-	QLabel *m_securityLevelComment;
-	QSpinBox *m_authSecurityLevel;
+	QLabel *m_unlockTimeComment;
+	QSpinBox *m_unlockTime;
 public:
 	ChangeMasterPassword(QWidget *parent = 0);
 	virtual ~ChangeMasterPassword();
@@ -10,6 +10,7 @@
 
 #include "passwordedit.h"
 #include "generictext.h"
+#include "signetapplication.h"
 
 cleartextPasswordEditor::cleartextPasswordEditor(int index, struct cleartext_pass *p, QWidget *parent) :
 	QDialog(parent),
@@ -19,9 +20,6 @@ cleartextPasswordEditor::cleartextPasswordEditor(int index, struct cleartext_pas
     m_buttonWaitDialog(nullptr),
 	m_changesMade(false)
 {
-	SignetApplication *app = SignetApplication::get();
-	connect(app, SIGNAL(signetdevCmdResp(signetdevCmdRespInfo)),
-		this, SLOT(signetdevCmdResp(signetdevCmdRespInfo)));
 	setWindowModality(Qt::WindowModal);
 	QVBoxLayout *l = new QVBoxLayout();
 	QLabel *heading = new genericText("Password slot #" + QString::number(index + 1));
@@ -105,6 +103,7 @@ void cleartextPasswordEditor::savePressed()
 	connect(m_buttonWaitDialog, SIGNAL(finished(int)), this, SLOT(buttonWaitFinished(int)));
 	m_buttonWaitDialog->show();
 	::signetdev_write_cleartext_password(nullptr, &m_signetdevCmdToken, m_index, &m_passNext);
+	SignetApplication::routeResponses(m_signetdevCmdToken, this);
 }
 
 void cleartextPasswordEditor::signetdevCmdResp(signetdevCmdRespInfo info)
@@ -22,11 +22,6 @@ cleartextPasswordSelector::cleartextPasswordSelector(QVector<int> formats, QStri
 	m_formats(formats),
 	m_buttonWaitDialog(NULL)
 {
-	SignetApplication *app = SignetApplication::get();
-	connect(app, SIGNAL(signetdevReadCleartextPassword(signetdevCmdRespInfo,cleartext_pass)),
-		this, SLOT(signetdevReadCleartextPassword(signetdevCmdRespInfo,cleartext_pass)));
-	connect(app, SIGNAL(signetdevCmdResp(signetdevCmdRespInfo)),
-		this, SLOT(signetdevCmdResp(signetdevCmdRespInfo)));
 	setWindowModality(Qt::WindowModal);
 	QVBoxLayout *l = new QVBoxLayout();
 	QHBoxLayout *buttons = new QHBoxLayout();
@@ -80,6 +75,7 @@ void cleartextPasswordSelector::deletePressed()
 			p.format = 0xff;
 			m_formats.replace(m_index, 0xff);
 			::signetdev_write_cleartext_password(NULL, &m_signetdevCmdToken, m_index, &p);
+			SignetApplication::routeResponses(m_signetdevCmdToken, this);
 			break;
 		}
 		i++;
@@ -173,6 +169,7 @@ void cleartextPasswordSelector::openPressed()
 			connect(m_buttonWaitDialog, SIGNAL(finished(int)), this, SLOT(buttonWaitFinished(int)));
 			m_buttonWaitDialog->show();
 			::signetdev_read_cleartext_password(NULL, &m_signetdevCmdToken, m_index);
+			SignetApplication::routeResponses(m_signetdevCmdToken, this);
 			break;
 		}
 		i++;
@@ -0,0 +1,352 @@
+#include "entrymigrationcontroller.h"
+#include "loggedinwidget.h"
+#include "buttonwaitwidget.h"
+#include "generictext.h"
+
+#include <QPushButton>
+#include <QFrame>
+#include <QLabel>
+#include <QProgressBar>
+#include <QBoxLayout>
+#include <QStackedWidget>
+
+extern "C" {
+#include "signetdev/host/signetdev.h"
+}
+
+EntryMigrationController::EntryMigrationController(LoggedInWidget *loggedInWidget, QObject *parent) :
+	QObject(parent),
+	m_loggedInWidget(loggedInWidget),
+	m_commands(nullptr),
+	m_progressStack(nullptr),
+	m_progressBar(nullptr),
+	m_progressLabel(nullptr),
+	m_completeLabel(nullptr),
+	m_buttonWaitWidget(nullptr),
+	m_state(MIGRATION_STATE_READING),
+	m_cancel(false),
+	m_staleCount(0),
+	m_readWatcher(nullptr),
+	m_writeIndex(0),
+	m_writeCompleteCount(0)
+{
+	m_commands = new SignetCommands(this);
+}
+
+EntryMigrationController::~EntryMigrationController()
+{
+	stop();
+}
+
+void EntryMigrationController::start()
+{
+	m_staleCount = m_loggedInWidget->staleEntries().size();
+
+	QFrame *frame = new QFrame();
+	frame->setFrameStyle(QFrame::StyledPanel);
+	frame->setLayout(new QVBoxLayout());
+	m_progressWidget = frame;
+	m_progressStack = new QStackedWidget();
+	m_progressWidget->layout()->addWidget(m_progressStack);
+
+	QWidget *progressWidget = new QWidget();
+	QVBoxLayout *vbox = new QVBoxLayout();
+	vbox->setAlignment(Qt::AlignTop);
+	vbox->setContentsMargins(0, 0, 0, 0);
+	m_progressLabel = new genericText("Reading entries...");
+	m_progressLabel->setSizePolicy(QSizePolicy::Preferred, QSizePolicy::Fixed);
+	m_progressBar = new QProgressBar();
+	m_progressBar->setMinimum(0);
+	m_progressBar->setMaximum(m_staleCount);
+	QPushButton *cancelButton = new QPushButton("Cancel");
+	connect(cancelButton, SIGNAL(pressed()), this, SLOT(migrationCancel()));
+	QHBoxLayout *hbox = new QHBoxLayout();
+	hbox->addWidget(m_progressBar);
+	hbox->addWidget(cancelButton);
+	vbox->addWidget(m_progressLabel);
+	vbox->addLayout(hbox);
+	progressWidget->setLayout(vbox);
+	m_progressStack->addWidget(progressWidget);
+
+	m_buttonWaitWidget = new ButtonWaitWidget("upgrade old entries", true);
+	m_progressStack->addWidget(m_buttonWaitWidget);
+	connect(m_buttonWaitWidget, SIGNAL(timeout()), this, SLOT(buttonTimeout()));
+	connect(m_buttonWaitWidget, SIGNAL(canceled()), this, SLOT(buttonCanceled()));
+
+	QWidget *completeWidget = new QWidget();
+	hbox = new QHBoxLayout();
+	hbox->setContentsMargins(0, 0, 0, 0);
+	m_completeLabel = new genericText("Upgrade complete");
+	hbox->addWidget(m_completeLabel);
+	QPushButton *ok = new QPushButton("Ok");
+	ok->setSizePolicy(QSizePolicy::Fixed, QSizePolicy::Fixed);
+	connect(ok, SIGNAL(pressed()), this, SLOT(dismiss()));
+	hbox->addWidget(ok);
+	completeWidget->setLayout(hbox);
+	m_progressStack->addWidget(completeWidget);
+
+	m_progressStack->setCurrentIndex(1);
+	m_loggedInWidget->showStatusWidget(m_progressWidget);
+	//An entry saved between being read and written back would be
+	//overwritten with its old contents, or brought back if deleted
+	m_loggedInWidget->blockEntryWrites("the entry upgrade");
+
+	//Masked reads leave out the secret fields so the entries must be read
+	//again in full before they can be rewritten
+	m_state = MIGRATION_STATE_READING;
+	m_readWatcher = new QFutureWatcher<signetdevReply>(this);
+	connect(m_readWatcher, SIGNAL(resultReadyAt(int)), this, SLOT(entryRead(int)));
+	connect(m_readWatcher, SIGNAL(finished()), this, SLOT(readFinished()));
+	m_readWatcher->setFuture(m_commands->readAllUIds(false));
+}
+
+void EntryMigrationController::stop()
+{
+	if (!m_loggedInWidget) {
+		return;
+	}
+	bool running = m_state == MIGRATION_STATE_READING || m_state == MIGRATION_STATE_WRITING;
+	if (running && m_progressWidget && m_progressStack->currentIndex() == 1) {
+		::signetdev_cancel_button_wait();
+	}
+	m_cancel = true;
+	for (QFutureWatcherBase *watcher : findChildren<QFutureWatcherBase *>()) {
+		watcher->disconnect(this);
+	}
+	if (m_progressWidget) {
+		m_progressWidget->deleteLater();
+	}
+	m_loggedInWidget->blockEntryWrites(QString());
+	m_loggedInWidget = nullptr;
+}
+
+void EntryMigrationController::updateProgress()
+{
+	if (!m_progressWidget) {
+		return;
+	}
+	switch (m_state) {
+	case MIGRATION_STATE_READING:
+		m_progressLabel->setText("Read " + QString::number(m_ids.size()) + " of " + QString::number(m_staleCount) + " old entries");
+		m_progressBar->setValue(m_ids.size());
+		break;
+	case MIGRATION_STATE_WRITING:
+		m_progressLabel->setText("Upgraded " + QString::number(m_writeCompleteCount) + " of " + QString::number(m_ids.size()) + " entries");
+		m_progressBar->setValue(m_writeCompleteCount);
+		break;
+	default:
+		break;
+	}
+}
+
+void EntryMigrationController::entryRead(int index)
+{
+	signetdevReply reply = m_readWatcher->resultAt(index);
+	if (m_cancel || reply.respCode != OKAY) {
+		return;
+	}
+	if (m_progressWidget && m_progressStack->currentIndex() == 1) {
+		m_progressStack->setCurrentIndex(0);
+	}
+	block stored;
+	stored.data = reply.data;
+	stored.mask = reply.mask;
+	block upgraded;
+	if (m_loggedInWidget->upgradeEntry(reply.uid, &stored, &upgraded)) {
+		m_ids.append(reply.uid);
+		m_blocks.append(upgraded);
+		updateProgress();
+	}
+}
+
+void EntryMigrationController::readFinished()
+{
+	QFuture<signetdevReply> read = m_readWatcher->future();
+	int code = read.resultCount() ? read.resultAt(read.resultCount() - 1).respCode : SIGNET_ERROR_QUIT;
+	m_readWatcher->deleteLater();
+	m_readWatcher = nullptr;
+
+	switch (code) {
+	case OKAY:
+	case ID_INVALID:
+		break;
+	case BUTTON_PRESS_CANCELED:
+	case BUTTON_PRESS_TIMEOUT:
+	case SIGNET_ERROR_DISCONNECT:
+	case SIGNET_ERROR_QUIT:
+		finish(MIGRATION_STATE_CANCELED);
+		return;
+	default:
+		finish(MIGRATION_STATE_CANCELED);
+		emit abort();
+		return;
+	}
+	if (m_cancel) {
+		finish(MIGRATION_STATE_CANCELED);
+	} else {
+		beginWriting();
+	}
+}
+
+void EntryMigrationController::beginWriting()
+{
+	//Entries edited while they were being read are already current
+	for (int i = 0; i < m_ids.size();) {
+		if (!m_loggedInWidget->staleEntries().contains(m_ids.at(i))) {
+			m_ids.removeAt(i);
+			m_blocks.removeAt(i);
+			continue;
+		}
+		i++;
+	}
+	if (m_ids.isEmpty()) {
+		finish(MIGRATION_STATE_COMPLETE);
+		return;
+	}
+	m_state = MIGRATION_STATE_WRITING;
+	m_writeIndex = 0;
+	m_writeCompleteCount = 0;
+	if (m_progressWidget) {
+		m_progressBar->setMaximum(m_ids.size());
+		//The first update may wait for a button press
+		m_buttonWaitWidget->resetTimeout();
+		m_progressStack->setCurrentIndex(1);
+	}
+	updateProgress();
+	issueWrites();
+}
+
+void EntryMigrationController::issueWrites()
+{
+	//The first update is sent alone since it may wait for a button press
+	int window = 1;
+	if (m_writeCompleteCount > 0) {
+		window = s_writeWindow;
+	}
+	while (!m_cancel && m_writeIndex < m_ids.size() && m_writes.size() < window) {
+		if (!m_loggedInWidget->staleEntries().contains(m_ids.at(m_writeIndex))) {
+			//Changed since it was read. Drop every such entry still to be
+			//sent so the remaining count stays exact.
+			for (int i = m_writeIndex; i < m_ids.size();) {
+				if (!m_loggedInWidget->staleEntries().contains(m_ids.at(i))) {
+					m_ids.removeAt(i);
+					m_blocks.removeAt(i);
+					continue;
+				}
+				i++;
+			}
+			if (m_progressWidget) {
+				m_progressBar->setMaximum(m_ids.size());
+			}
+			continue;
+		}
+		const block &blk = m_blocks.at(m_writeIndex);
+		QFuture<signetdevReply> write = m_commands->updateUIds(m_ids.at(m_writeIndex),
+				blk.data, blk.mask, m_ids.size() - m_writeIndex - 1);
+		m_writeIndex++;
+		QFutureWatcher<signetdevReply> *watcher = new QFutureWatcher<signetdevReply>(this);
+		connect(watcher, SIGNAL(finished()), this, SLOT(entryWritten()));
+		connect(watcher, SIGNAL(finished()), watcher, SLOT(deleteLater()));
+		watcher->setFuture(write);
+		m_writes.append(write);
+	}
+	if (!m_cancel && m_writes.isEmpty() && m_writeIndex == m_ids.size()) {
+		finish(MIGRATION_STATE_COMPLETE);
+	}
+}
+
+void EntryMigrationController::entryWritten()
+{
+	//Updates complete in the order they were issued
+	while (m_writes.size() && m_writes.first().isFinished()) {
+		int index = m_writeIndex - m_writes.size();
+		QFuture<signetdevReply> write = m_writes.takeFirst();
+		signetdevReply reply;
+		if (write.resultCount()) {
+			reply = write.result();
+		}
+		switch (reply.respCode) {
+		case OKAY:
+			m_loggedInWidget->entryUpgraded(m_ids.at(index), &m_blocks.at(index));
+			m_writeCompleteCount++;
+			break;
+		case BUTTON_PRESS_CANCELED:
+		case BUTTON_PRESS_TIMEOUT:
+		case SIGNET_ERROR_DISCONNECT:
+		case SIGNET_ERROR_QUIT:
+			m_cancel = true;
+			break;
+		default:
+			m_cancel = true;
+			emit abort();
+			if (!m_loggedInWidget) {
+				//Stopped by the abort
+				return;
+			}
+			break;
+		}
+	}
+	if (m_progressWidget && m_writeCompleteCount && m_progressStack->currentIndex() == 1) {
+		m_progressStack->setCurrentIndex(0);
+	}
+	updateProgress();
+	if (!m_writes.isEmpty()) {
+		issueWrites();
+	} else if (m_cancel) {
+		finish(MIGRATION_STATE_CANCELED);
+	} else if (m_writeIndex == m_ids.size()) {
+		finish(MIGRATION_STATE_COMPLETE);
+	} else {
+		issueWrites();
+	}
+}
+
+void EntryMigrationController::finish(enum migrationState state)
+{
+	m_state = state;
+	m_blocks.clear();
+	if (m_loggedInWidget) {
+		m_loggedInWidget->blockEntryWrites(QString());
+	}
+	if (!m_progressWidget) {
+		emit done();
+		return;
+	}
+	QString summary;
+	if (state == MIGRATION_STATE_COMPLETE) {
+		summary = "Upgrade complete, " + QString::number(m_writeCompleteCount) + " old entries upgraded";
+	} else {
+		summary = "Upgrade canceled, " + QString::number(m_writeCompleteCount) + " of " +
+			  QString::number(m_staleCount) + " old entries upgraded";
+	}
+	m_completeLabel->setText(summary);
+	m_progressStack->setCurrentIndex(2);
+}
+
+void EntryMigrationController::migrationCancel()
+{
+	m_cancel = true;
+	if (m_state == MIGRATION_STATE_WRITING && m_writes.isEmpty()) {
+		finish(MIGRATION_STATE_CANCELED);
+	}
+}
+
+void EntryMigrationController::dismiss()
+{
+	m_progressWidget->deleteLater();
+	m_progressWidget = nullptr;
+	emit done();
+}
+
+void EntryMigrationController::buttonCanceled()
+{
+	//The pending command fails with BUTTON_PRESS_CANCELED and the summary
+	//is shown from there
+	::signetdev_cancel_button_wait();
+	m_cancel = true;
+}
+
+void EntryMigrationController::buttonTimeout()
+{
+	m_cancel = true;
+}
@@ -0,0 +1,88 @@
+#ifndef ENTRYMIGRATIONCONTROLLER_H
+#define ENTRYMIGRATIONCONTROLLER_H
+
+#include <QObject>
+#include <QList>
+#include <QPointer>
+#include <QFuture>
+#include <QFutureWatcher>
+
+#include "esdb.h"
+#include "signetcommands.h"
+
+class LoggedInWidget;
+class ButtonWaitWidget;
+class QLabel;
+class QProgressBar;
+class QStackedWidget;
+
+//
+// Rewrites entries stored in an older revision in the current one so they
+// no longer go through the upgrade chain on every unlock. The entries are
+// read unmasked with a single read_all_uids, re-serialized and written back
+// with batched update_uids. Each step needs one button press. Entries can't
+// be edited or deleted while the migration runs. Any that change anyway are
+// skipped, since they are already written in the current revision.
+//
+// Progress is shown in a strip at the top of the entry list rather than a
+// dialog, so the client stays usable while it runs.
+//
+class EntryMigrationController : public QObject
+{
+	Q_OBJECT
+	LoggedInWidget *m_loggedInWidget;
+	SignetCommands *m_commands;
+
+	QPointer<QWidget> m_progressWidget;
+	QStackedWidget *m_progressStack;
+	QProgressBar *m_progressBar;
+	QLabel *m_progressLabel;
+	QLabel *m_completeLabel;
+	ButtonWaitWidget *m_buttonWaitWidget;
+
+	enum migrationState {
+		MIGRATION_STATE_READING,
+		MIGRATION_STATE_WRITING,
+		MIGRATION_STATE_COMPLETE,
+		MIGRATION_STATE_CANCELED
+	};
+	enum migrationState m_state;
+	bool m_cancel;
+	int m_staleCount;
+
+	QFutureWatcher<signetdevReply> *m_readWatcher;
+	QList<int> m_ids;
+	QList<block> m_blocks;
+
+	//Up to s_writeWindow updates are kept outstanding with the device
+	static const int s_writeWindow = 4;
+	QList<QFuture<signetdevReply> > m_writes;
+	int m_writeIndex;
+	int m_writeCompleteCount;
+	void beginWriting();
+	void issueWrites();
+	void updateProgress();
+	void finish(enum migrationState state);
+public:
+	//Parent to an object that outlives loggedInWidget, which is gone after
+	//a logout or disconnect. Call stop() before that happens.
+	EntryMigrationController(LoggedInWidget *loggedInWidget, QObject *parent);
+	~EntryMigrationController();
+	void start();
+	//Detach from the logged in widget. Commands in flight complete unseen
+	//and no signals are emitted afterwards.
+	void stop();
+signals:
+	void done();
+	void abort();
+private slots:
+	void entryRead(int index);
+	void readFinished();
+	void entryWritten();
+	void migrationCancel();
+	void dismiss();
+	void buttonTimeout();
+	void buttonCanceled();
+};
+
+#endif // ENTRYMIGRATIONCONTROLLER_H
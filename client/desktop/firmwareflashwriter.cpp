@@ -0,0 +1,135 @@
+#include "firmwareflashwriter.h"
+#include "signetapplication.h"
+
+FirmwareFlashWriter::FirmwareFlashWriter(QObject *parent) :
+	QObject(parent),
+	m_nextChunk(0),
+	m_resendFrom(-1),
+	m_totalSize(0),
+	m_written(0)
+{
+}
+
+void FirmwareFlashWriter::clear()
+{
+	m_inFlight.clear();
+	m_chunks.clear();
+	m_padding.clear();
+	m_nextChunk = 0;
+	m_resendFrom = -1;
+	m_totalSize = 0;
+	m_written = 0;
+}
+
+void FirmwareFlashWriter::addRegion(unsigned int addr, const void *data, unsigned int size, unsigned int chunkSize, bool padLastChunk)
+{
+	const u8 *bytes = (const u8 *)data;
+	for (unsigned int offset = 0; offset < size; offset += chunkSize) {
+		flashChunk c;
+		c.addr = addr + offset;
+		c.data = bytes + offset;
+		c.size = qMin(chunkSize, size - offset);
+		c.retries = 0;
+		if (padLastChunk && c.size < chunkSize) {
+			QByteArray padded((const char *)c.data, c.size);
+			padded.append(QByteArray(chunkSize - c.size, (char)0xff));
+			m_padding.append(padded);
+			c.data = (const u8 *)m_padding.last().constData();
+			c.size = chunkSize;
+		}
+		m_chunks.append(c);
+		m_totalSize += c.size;
+	}
+}
+
+void FirmwareFlashWriter::start()
+{
+	m_inFlight.clear();
+	m_nextChunk = 0;
+	m_resendFrom = -1;
+	m_written = 0;
+	for (auto &c : m_chunks) {
+		c.retries = 0;
+	}
+	emit progress(m_written, m_totalSize);
+	if (m_chunks.isEmpty()) {
+		emit finished();
+		return;
+	}
+	fill();
+}
+
+void FirmwareFlashWriter::cancel()
+{
+	m_inFlight.clear();
+	m_nextChunk = m_chunks.size();
+	m_resendFrom = -1;
+}
+
+void FirmwareFlashWriter::send(int chunk)
+{
+	const flashChunk &c = m_chunks.at(chunk);
+	int token = -1;
+	::signetdev_write_flash(nullptr, &token, c.addr, c.data, c.size);
+	SignetApplication::routeResponses(token, this);
+	m_inFlight.insert(token, chunk);
+}
+
+void FirmwareFlashWriter::fill()
+{
+	if (m_resendFrom >= 0) {
+		if (m_inFlight.size()) {
+			return;
+		}
+		m_nextChunk = m_resendFrom;
+		m_resendFrom = -1;
+	}
+	while (m_inFlight.size() < FIRMWARE_WRITE_WINDOW && m_nextChunk < m_chunks.size()) {
+		send(m_nextChunk++);
+	}
+}
+
+void FirmwareFlashWriter::signetdevCmdResp(signetdevCmdRespInfo info)
+{
+	auto iter = m_inFlight.find(info.token);
+	if (iter == m_inFlight.end()) {
+		return;
+	}
+	int chunk = iter.value();
+	m_inFlight.erase(iter);
+
+	//Chunks queued behind a rejected one are sent again once the queue
+	//drains, so their results don't count
+	bool resent = m_resendFrom >= 0 && chunk > m_resendFrom;
+
+	switch (info.resp_code) {
+	case OKAY:
+		if (!resent) {
+			m_written += m_chunks.at(chunk).size;
+			emit progress(m_written, m_totalSize);
+		}
+		break;
+	case SIGNET_ERROR_DISCONNECT:
+	case SIGNET_ERROR_QUIT:
+		cancel();
+		emit error(info.resp_code);
+		return;
+	default:
+		if (resent) {
+			break;
+		}
+		if (m_chunks[chunk].retries < FIRMWARE_WRITE_RETRIES) {
+			m_chunks[chunk].retries++;
+			m_resendFrom = chunk;
+			break;
+		}
+		cancel();
+		emit error(info.resp_code);
+		return;
+	}
+
+	fill();
+	if (!isWriting()) {
+		emit finished();
+	}
+}
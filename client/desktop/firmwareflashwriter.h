@@ -0,0 +1,75 @@
+#ifndef FIRMWAREFLASHWRITER_H
+#define FIRMWAREFLASHWRITER_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QList>
+#include <QMap>
+
+#include "signetapplication.h"
+
+//Write commands queued with the device at once. The device services them one
+//at a time, so this only needs to be deep enough to hide the host round trip.
+#define FIRMWARE_WRITE_WINDOW 4
+
+//Times a chunk is resent after the device rejects it
+#define FIRMWARE_WRITE_RETRIES 2
+
+//
+// Writes a list of flash regions to the device in fixed size chunks, keeping
+// up to FIRMWARE_WRITE_WINDOW writes queued instead of waiting for each
+// response before sending the next chunk. Region data must stay valid until
+// finished() or error() is emitted.
+//
+// Chunks reach the device in address order. When a chunk is rejected no new
+// chunks are sent until the queued ones drain, then writing resumes from the
+// rejected chunk.
+//
+class FirmwareFlashWriter : public QObject
+{
+	Q_OBJECT
+	struct flashChunk {
+		unsigned int addr;
+		const u8 *data;
+		unsigned int size;
+		int retries;
+	};
+	QList<flashChunk> m_chunks;
+	QList<QByteArray> m_padding;
+	QMap<int, int> m_inFlight;
+	int m_nextChunk;
+	int m_resendFrom;
+	unsigned int m_totalSize;
+	unsigned int m_written;
+	void send(int chunk);
+	void fill();
+public:
+	explicit FirmwareFlashWriter(QObject *parent = nullptr);
+	void clear();
+	//With padLastChunk set a short final chunk is filled out to chunkSize
+	//with 0xff, for devices that only accept whole chunks
+	void addRegion(unsigned int addr, const void *data, unsigned int size, unsigned int chunkSize, bool padLastChunk = false);
+	void start();
+	//Stop issuing writes. Responses to writes already queued are ignored.
+	void cancel();
+	bool isWriting() const
+	{
+		return m_inFlight.size() || m_nextChunk < m_chunks.size();
+	}
+	unsigned int totalSize() const
+	{
+		return m_totalSize;
+	}
+	unsigned int written() const
+	{
+		return m_written;
+	}
+signals:
+	void progress(unsigned int written, unsigned int total);
+	void finished();
+	void error(int respCode);
+private slots:
+	void signetdevCmdResp(signetdevCmdRespInfo info);
+};
+
+#endif // FIRMWAREFLASHWRITER_H
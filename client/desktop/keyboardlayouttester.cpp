@@ -215,10 +215,6 @@ KeyboardLayoutTester::KeyboardLayoutTester(const QVector<struct signetdev_key> &
 	setFocusPolicy(Qt::StrongFocus);
 	setWindowTitle("Keyboard layout configuration");
 	setAttribute(Qt::WA_InputMethodEnabled, true);
-	connect(SignetApplication::get(),
-		SIGNAL(signetdevCmdResp(signetdevCmdRespInfo)),
-		this,
-		SLOT(signetdevCmdResp(signetdevCmdRespInfo)));
 	connect(&m_keyTimer,
 		SIGNAL(timeout()),
 		this,
@@ -366,6 +362,7 @@ void KeyboardLayoutTester::typeKey()
 	m_keyTimer.start(100);
 	m_keysEmitted.append(key);
 	::signetdev_type_raw(NULL, &m_signetdevToken, codes, 2);
+	SignetApplication::routeResponses(m_signetdevToken, this);
 }
 
 void KeyboardLayoutTester::startTest()
@@ -440,6 +437,7 @@ void KeyboardLayoutTester::stopTest()
 		0,0
 	};
 	::signetdev_type_raw(NULL, &m_signetdevToken, codes, 1);
+	SignetApplication::routeResponses(m_signetdevToken, this);
 	m_keyTimer.stop();
 }
 
@@ -598,6 +596,7 @@ void KeyboardLayoutTester::pressTimeout()
 		m_keyTimer.start(100);
 		m_keysEmitted.append(key);
 		::signetdev_type_raw(NULL, &m_signetdevToken, codes, 2);
+		SignetApplication::routeResponses(m_signetdevToken, this);
 	} else {
 		typeNextKey();
 	}
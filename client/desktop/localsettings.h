@@ -27,6 +27,8 @@ struct localSettings {
 	QString activeKeyboardLayout;
 	QByteArray windowGeometry;
 	bool minimizeToTray;
+	bool speculativeUnlock;
+	bool backgroundUpgrade;
 };
 
 #endif // LOCALSETTINGS_H
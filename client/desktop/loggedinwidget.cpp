@@ -95,7 +95,7 @@ LoggedInWidget::typeData::typeData(esdbTypeModule *_module) :
 	model(nullptr),
 	expanded(false)
 {
-	entries = new QMap<int, esdbEntry *>();
+	entries = new esdbEntryTable();
 	filteredList = new QList<esdbEntry *>();
 	model = new EsdbModel(module, filteredList);
 }
@@ -109,6 +109,62 @@ LoggedInWidget::typeData::~typeData()
 	actionBar->deleteLater();
 }
 
+void LoggedInWidget::typeData::indexEntry(esdbEntry *entry)
+{
+	QString fullTitle = entry->getFullTitle();
+	titleIndex.insert(fullTitle, entry);
+	indexedTitles.insert(entry->id, fullTitle);
+}
+
+void LoggedInWidget::typeData::unindexEntry(int id)
+{
+	auto titleIter = indexedTitles.find(id);
+	if (titleIter == indexedTitles.end()) {
+		return;
+	}
+	auto iter = titleIndex.find(titleIter.value());
+	while (iter != titleIndex.end() && iter.key() == titleIter.value()) {
+		if (iter.value()->id == id) {
+			iter = titleIndex.erase(iter);
+		} else {
+			iter++;
+		}
+	}
+	indexedTitles.erase(titleIter);
+}
+
+void LoggedInWidget::typeData::insertEntry(esdbEntry *entry)
+{
+	unindexEntry(entry->id);
+	entries->insert(entry->id, entry);
+	indexEntry(entry);
+}
+
+void LoggedInWidget::typeData::removeEntry(int id)
+{
+	unindexEntry(id);
+	entries->remove(id);
+}
+
+void LoggedInWidget::typeData::reindexEntry(esdbEntry *entry)
+{
+	unindexEntry(entry->id);
+	indexEntry(entry);
+}
+
+esdbEntry *LoggedInWidget::typeData::findEntry(const QString &fullTitle) const
+{
+	esdbEntry *match = nullptr;
+	auto iter = titleIndex.find(fullTitle);
+	while (iter != titleIndex.end() && iter.key() == fullTitle) {
+		if (!match || iter.value()->id < match->id) {
+			match = iter.value();
+		}
+		iter++;
+	}
+	return match;
+}
+
 void LoggedInWidget::getCurrentGroups(QString typeName, QStringList &groups)
 {
 	auto entryMap = typeNameToEntryMap(typeName);
@@ -259,15 +315,6 @@ LoggedInWidget::LoggedInWidget(QProgressBar *loading_progress, MainWindow *mw, Q
 	connect(app, SIGNAL(websocketMessage(int, QString)), this, SLOT(websocketMessage(int, QString)));
 #endif
 
-	connect(app, SIGNAL(signetdevCmdResp(signetdevCmdRespInfo)), this,
-		SLOT(signetdevCmdResp(signetdevCmdRespInfo)));
-
-	connect(app, SIGNAL(signetdevReadUIdResp(signetdevCmdRespInfo, QByteArray, QByteArray)), this,
-		SLOT(signetdevReadUIdResp(signetdevCmdRespInfo, QByteArray, QByteArray)));
-
-	connect(app, SIGNAL(signetdevReadAllUIdsResp(signetdevCmdRespInfo, int, QByteArray, QByteArray)), this,
-		SLOT(signetdevReadAllUIdsResp(signetdevCmdRespInfo, int, QByteArray, QByteArray)));
-
 	m_filterEdit = new SearchFilterEdit();
 	QObject::connect(m_filterEdit, SIGNAL(textEdited(QString)),
 			 this, SLOT(filterTextEdited(QString)));
@@ -357,6 +404,7 @@ LoggedInWidget::LoggedInWidget(QProgressBar *loading_progress, MainWindow *mw, Q
 	m_loadingProgress->setMaximum(1);
 
 	::signetdev_read_all_uids(nullptr, &m_signetdevCmdToken, 1);
+	SignetApplication::routeResponses(m_signetdevCmdToken, this);
 }
 
 ButtonWaitWidget *LoggedInWidget::beginButtonWait(QString action, bool longPress)
@@ -426,7 +474,7 @@ void LoggedInWidget::signetdevReadAllUIdsResp(signetdevCmdRespInfo info, int uid
 		for (auto entry : m_entries) {
 			int index = entryToIndex(entry);
 			if (index >= 0) {
-				m_typeData.at(index)->entries->insert(entry->id, entry);
+				m_typeData.at(index)->insertEntry(entry);
 			} else {
 				//TODO
 			}
@@ -478,8 +526,22 @@ void LoggedInWidget::currentTypeIndexChanged(int idx)
 
 LoggedInWidget::~LoggedInWidget()
 {
+	//Children such as an import controller, the action bars and the entry
+	//list still point at entries, so they go before the entries do. One
+	//child may delete another so take them one at a time. Deleting them
+	//moves focus, so stop listening to the application first.
+	SignetApplication::get()->disconnect(this);
+	while (!children().isEmpty()) {
+		QObject *child = children().first();
+		child->disconnect(this);
+		delete child;
+	}
 	if (m_accounts)
 		delete m_accounts;
+	//Release every decoded entry and the strings they shared at logout
+	qDeleteAll(m_entries);
+	m_entries.clear();
+	esdbStringPool::clear();
 }
 
 void LoggedInWidget::open()
@@ -717,6 +779,9 @@ void LoggedInWidget::idTaskComplete(bool error, int id, esdbEntry *entry, enum I
 
 bool LoggedInWidget::beginIDTask(int id, enum ID_TASK task, int intent, EsdbActionBar *bar)
 {
+	if (task == ID_TASK_DELETE && !checkEntryWrites()) {
+		return false;
+	}
 	if (m_idTask == ID_TASK_NONE) {
 		m_id = id;
 		m_idTask = task;
@@ -725,9 +790,11 @@ bool LoggedInWidget::beginIDTask(int id, enum ID_TASK task, int intent, EsdbActi
 		switch (m_idTask) {
 		case ID_TASK_DELETE:
 			::signetdev_update_uid(nullptr, &m_signetdevCmdToken, m_id, 0, nullptr, nullptr);
+			SignetApplication::routeResponses(m_signetdevCmdToken, this);
 			return true;
 		case ID_TASK_READ:
 			::signetdev_read_uid(nullptr, &m_signetdevCmdToken, m_id, 0);
+			SignetApplication::routeResponses(m_signetdevCmdToken, this);
 			return true;
 		default:
 			break;
@@ -766,11 +833,15 @@ esdbTypeModule *LoggedInWidget::esdbEntryToModule(esdbEntry *entry)
 
 void LoggedInWidget::entryChanged(int id)
 {
-	esdbEntry *entry = m_entries[id];
+	m_entryDigests.remove(id);
+	//Changed entries are written in the current revision
+	m_staleEntries.remove(id);
+	esdbEntry *entry = m_entries.value(id);
 	if (entry) {
 		entryIconCheck(entry);
 		int typeIdx = entryToIndex(entry);
 		typeData *td = m_typeData.at(typeIdx);
+		td->reindexEntry(entry);
 		if (entry->type == ESDB_TYPE_GENERIC_TYPE_DESC) {
 			m_dataTypesModel->moduleChanged(td->module);
 		}
@@ -809,13 +880,14 @@ void LoggedInWidget::signetdevCmdResp(signetdevCmdRespInfo info)
 			m_idTask = ID_TASK_NONE;
 			bar->idTaskComplete(false, m_id, nullptr, task, m_taskIntent);
 			if (code == OKAY) {
-				auto iter = m_entries.find(m_id);
 				if (m_activeType->module == m_genericTypeModule) {
-					genericTypeDesc *e = static_cast<genericTypeDesc *>(*iter);
+					genericTypeDesc *e = static_cast<genericTypeDesc *>(m_entries.value(m_id));
 					for (auto typeIter = m_typeData.begin(); typeIter != m_typeData.end(); typeIter++) {
 						struct typeData *d = (*typeIter);
 						if (d->module->name() == e->name) {
-							m_miscTypeData->entries->unite(*(d->entries));
+							for (auto typeEntry : *(d->entries)) {
+								m_miscTypeData->insertEntry(typeEntry);
+							}
 							m_dataTypesModel->removeModule(d->module);
 							m_genericModules[e->typeId] = nullptr;
 							delete d;
@@ -824,8 +896,10 @@ void LoggedInWidget::signetdevCmdResp(signetdevCmdRespInfo info)
 						}
 					}
 				}
-				m_entries.erase(iter);
-				m_activeType->entries->erase(m_activeType->entries->find(m_id));
+				m_entries.remove(m_id);
+				m_entryDigests.remove(m_id);
+				m_staleEntries.remove(m_id);
+				m_activeType->removeEntry(m_id);
 				populateEntryList(m_activeType, m_filterEdit->text());
 			}
 		}
@@ -950,22 +1024,28 @@ int LoggedInWidget::entryToIndex(esdbEntry *entry)
 	return -1;
 }
 
-const QMap<int, esdbEntry *> *LoggedInWidget::entryToEntryMap(esdbEntry *entry)
+const esdbEntryTable *LoggedInWidget::entryToEntryMap(esdbEntry *entry)
 {
 	int index = entryToIndex(entry);
 	return m_typeData[index]->entries;
 }
 
-const QMap<int, esdbEntry *> *LoggedInWidget::typeNameToEntryMap(QString name)
+LoggedInWidget::typeData *LoggedInWidget::typeNameToTypeData(const QString &name) const
 {
 	for (auto td : m_typeData) {
 		if (td->module->name() == name) {
-			return td->entries;
+			return td;
 		}
 	}
 	return nullptr;
 }
 
+const esdbEntryTable *LoggedInWidget::typeNameToEntryMap(QString name)
+{
+	typeData *td = typeNameToTypeData(name);
+	return td ? td->entries : nullptr;
+}
+
 EsdbActionBar *LoggedInWidget::getActionBarByEntry(esdbEntry *entry)
 {
 	EsdbActionBar *bar = nullptr;
@@ -1023,17 +1103,8 @@ void LoggedInWidget::showEvent(QShowEvent *event)
 
 esdbEntry *LoggedInWidget::findEntry(QString type, QString name) const
 {
-	for (auto t : m_typeData) {
-		if (t->module->name() == type) {
-			QMap<int, esdbEntry *>::const_iterator iter;
-			for (iter = t->entries->cbegin(); iter != t->entries->cend(); iter++) {
-				if (iter.value()->getFullTitle() == name) {
-					return iter.value();
-				}
-			}
-		}
-	}
-	return nullptr;
+	typeData *t = typeNameToTypeData(type);
+	return t ? t->findEntry(name) : nullptr;
 }
 
 QList<esdbTypeModule *> LoggedInWidget::getTypeModules()
@@ -1045,18 +1116,71 @@ QList<esdbTypeModule *> LoggedInWidget::getTypeModules()
 	return modules;
 }
 
+void LoggedInWidget::setEntryDigest(int id, const block *blk)
+{
+	m_entryDigests.insert(id, blk->contentHash());
+}
+
+void LoggedInWidget::setEntryDigest(int id, const QByteArray &digest)
+{
+	m_entryDigests.insert(id, digest);
+}
+
+bool LoggedInWidget::upgradeEntry(int id, block *stored, block *upgraded)
+{
+	if (!m_staleEntries.contains(id)) {
+		return false;
+	}
+	esdbEntry_1 tmp(id);
+	tmp.fromBlock(stored);
+	esdbTypeModule *module = getTypeModule(static_cast<enum esdbTypes>(tmp.type));
+	if (!module) {
+		return false;
+	}
+	esdbEntry *entry = module->decodeEntry(id, tmp.revision, nullptr, stored);
+	if (!entry) {
+		return false;
+	}
+	bool stale = tmp.revision < entry->revision;
+	if (stale) {
+		entry->toBlock(upgraded);
+	}
+	delete entry;
+	return stale;
+}
+
+void LoggedInWidget::showStatusWidget(QWidget *w)
+{
+	static_cast<QBoxLayout *>(layout())->insertWidget(0, w);
+}
+
+void LoggedInWidget::entryUpgraded(int id, const block *blk)
+{
+	m_staleEntries.remove(id);
+	setEntryDigest(id, blk);
+}
+
+bool LoggedInWidget::entryUnchanged(int id, const QByteArray &digest) const
+{
+	auto iter = m_entryDigests.find(id);
+	if (iter == m_entryDigests.end()) {
+		return false;
+	}
+	return iter.value() == digest;
+}
+
 void LoggedInWidget::getEntryDone(int id, int code, block *blk, bool task)
 {
 	esdbEntry *entry = nullptr;
 	enum ID_TASK idTask  = m_idTask;
 	m_idTask = ID_TASK_NONE;
 
-	int exists = m_entries.count(id);
+	bool exists = m_entries.contains(id);
 
 	EsdbActionBar *bar = nullptr;
 
 	if (exists && task) {
-		entry = m_entries[id];
+		entry = m_entries.value(id);
 		bar = m_taskActionBar;
 	}
 
@@ -1076,6 +1200,11 @@ void LoggedInWidget::getEntryDone(int id, int code, block *blk, bool task)
 		if (module) {
 			entry = module->decodeEntry(id, tmp.revision, entry, blk);
 			if (entry) {
+				if (tmp.revision < entry->revision) {
+					m_staleEntries.insert(id);
+				} else {
+					m_staleEntries.remove(id);
+				}
 				if (bar) {
 					bar->idTaskComplete(false, id, entry, idTask, m_taskIntent);
 				} else {
@@ -1096,13 +1225,16 @@ void LoggedInWidget::getEntryDone(int id, int code, block *blk, bool task)
 	}
 
 	if (entry) {
+		if (task || !blk->hasMaskedBytes()) {
+			setEntryDigest(id, blk);
+		}
 		if (!exists) {
 			entryIconCheck(entry);
-			m_entries[id] = entry;
+			m_entries.insert(id, entry);
 			if (!m_populating) {
 				int index = entryToIndex(entry);
 				if (index >= 0) {
-					m_typeData.at(index)->entries->insert(id, entry);
+					m_typeData.at(index)->insertEntry(entry);
 					populateEntryList(m_activeType, m_searchListbox->filterText());
 				}
 			}
@@ -1176,13 +1308,12 @@ int LoggedInWidget::getUnusedTypeId()
 
 int LoggedInWidget::getUnusedTypeId(const QSet<int> &reserved)
 {
-	int match[MAX_UID+1];
-	for (int i = 0; i <= MAX_UID; i++) {
-		match[i] = 0;
-	}
-	match[0] = 1;
+	//Type ids aren't keyed by UID so gather them in a table first. Only
+	//the live bitmap matters here.
+	esdbEntryTable used;
+	used.insert(0, nullptr);
 	for (auto r : reserved) {
-		match[r] = 1;
+		used.insert(r, nullptr);
 	}
 	for (esdbEntry *entry : m_entries) {
 		int typeIdx = -1;
@@ -1194,14 +1325,11 @@ int LoggedInWidget::getUnusedTypeId(const QSet<int> &reserved)
 			typeIdx = gt->typeId;
 		}
 		if (typeIdx >= 0) {
-			match[typeIdx] = 1;
+			used.insert(typeIdx, nullptr);
 		}
 	}
-	for (int i = 0; i < (MAX_UID+1); i++) {
-		if (!match[i])
-			return i;
-	}
-	return generic::invalidTypeId;
+	int typeId = used.firstUnused(0, MAX_UID);
+	return typeId >= 0 ? typeId : generic::invalidTypeId;
 }
 
 int LoggedInWidget::getUnusedId()
@@ -1212,31 +1340,34 @@ int LoggedInWidget::getUnusedId()
 
 int LoggedInWidget::getUnusedId(const QSet<int> &reserved)
 {
-	int entriesValid[MAX_UID+1];
-	//TODO: optimize this
-	for (int i = MIN_UID; i <= MAX_UID; i++) {
-		entriesValid[i] = 0;
+	int id = m_entries.firstUnused(MIN_UID, MAX_UID);
+	while (id >= 0 && reserved.contains(id)) {
+		id = m_entries.firstUnused(id + 1, MAX_UID);
 	}
-	for (auto r : reserved) {
-		entriesValid[r] = 1;
-	}
-	for (auto entry : m_entries) {
-		entriesValid[entry->id] = 1;
-	}
-	int id = -1;
-	for (id = MIN_UID; id <= MAX_UID; id++) {
-		if (!entriesValid[id])
-			break;
-	}
-	if (id > MAX_UID) {
-		return -1;
-	} else {
-		return id;
+	return id;
+}
+
+void LoggedInWidget::blockEntryWrites(const QString &reason)
+{
+	m_entryWritesBlocked = reason;
+}
+
+bool LoggedInWidget::checkEntryWrites()
+{
+	if (m_entryWritesBlocked.isEmpty()) {
+		return true;
 	}
+	SignetApplication::messageBoxWarn("Entries locked",
+					  "Entries can't be changed while " + m_entryWritesBlocked + " is in progress",
+					  this);
+	return false;
 }
 
 void LoggedInWidget::newEntryUI()
 {
+	if (!checkEntryWrites()) {
+		return;
+	}
 	int id = getUnusedId();
 	if (id < 0) {
 		SignetApplication::messageBoxError(QMessageBox::Warning,
@@ -1303,10 +1434,10 @@ void LoggedInWidget::entryCreated(QString typeName, esdbEntry *entry)
 	if (entry) {
 		m_searchListbox->setFilterText(QString());
 		entryIconCheck(entry);
-		m_entries[entry->id] = entry;
+		m_entries.insert(entry->id, entry);
 		for (auto t : m_typeData) {
 			if (t->module->name() == typeName) {
-				t->entries->insert(entry->id, entry);
+				t->insertEntry(entry);
 				populateEntryList(t, m_filterEdit->text());
 			}
 		}
@@ -1352,16 +1483,13 @@ bool LoggedInWidget::selectFirstVisible()
 	return true;
 }
 
-void LoggedInWidget::populateEntryList(typeData *t, QString filter)
+bool LoggedInWidget::filterEntries(const esdbEntryTable &entries, const QString &filter, QList<esdbEntry *> &filtered)
 {
-	QList<esdbEntry *> *filteredList = t->filteredList;
-	QMap<int, esdbEntry *> *data = t->entries;
-	EsdbModel *model = t->model;
-	filteredList->clear();
+	filtered.clear();
 
 	bool hasGroups = false;
 	QVector<QList<esdbEntry *> > qualityGroups;
-	for (auto x : *data) {
+	for (auto x : entries) {
 		esdbEntry *entry = x;
 		if (entry->getPath().size()) {
 			hasGroups = true;
@@ -1378,8 +1506,16 @@ void LoggedInWidget::populateEntryList(typeData *t, QString filter)
 	int i;
 
 	for (i = (qualityGroups.size() - 1); i >= 0; i--) {
-		filteredList->append(qualityGroups[i]);
+		filtered.append(qualityGroups[i]);
 	}
+	return hasGroups;
+}
+
+void LoggedInWidget::populateEntryList(typeData *t, QString filter)
+{
+	QList<esdbEntry *> *filteredList = t->filteredList;
+	EsdbModel *model = t->model;
+	bool hasGroups = filterEntries(*t->entries, filter, *filteredList);
 	model->changed(hasGroups);
 	m_searchListbox->setRootIsDecorated(hasGroups);
 
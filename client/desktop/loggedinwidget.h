@@ -8,6 +8,8 @@
 #include <QDialog>
 #include <QUrl>
 #include <QMap>
+#include <QHash>
+#include <QSet>
 #include <QVector>
 #include <QIcon>
 
@@ -26,7 +28,6 @@ class QRadioButton;
 class QProgressBar;
 class QComboBox;
 class QStackedWidget;
-template <typename T> class QSet;
 #include <map>
 
 struct account;
@@ -44,6 +45,7 @@ class esdbGenericTypeModule;
 class QUrl;
 #include "signetapplication.h"
 #include "esdbtypemodule.h"
+#include "esdbentrytable.h"
 #include "esdbaccountmodule.h"
 #include "esdbbookmarkmodule.h"
 #include "../desktop/mainwindow.h"
@@ -98,18 +100,37 @@ class LoggedInWidget : public QWidget
 	bool m_fileMode;
 
 	QList<iconAccount> m_icon_accounts;
-	QMap<int, esdbEntry *> m_entries;
+	esdbEntryTable m_entries;
+	//Hashes of entry contents as stored on the device. Only kept when the
+	//whole entry is known, i.e. it has no masked bytes or was read or
+	//written in full.
+	QHash<int, QByteArray> m_entryDigests;
+	//Entries stored in an older revision than their type's current one
+	QSet<int> m_staleEntries;
+	//Why entries can't be edited or deleted right now, empty if they can
+	QString m_entryWritesBlocked;
 
 	struct typeData {
 		esdbTypeModule *module;
-		QMap<int, esdbEntry *> *entries;
+		esdbEntryTable *entries;
 		EsdbActionBar *actionBar;
 		QList<esdbEntry *> *filteredList;
 		EsdbModel *model;
 		bool expanded;
+		//Full title (path and title) index of entries
+		QMultiHash<QString, esdbEntry *> titleIndex;
+		QHash<int, QString> indexedTitles;
 		typeData(esdbTypeModule *_module);
 		~typeData();
+		void insertEntry(esdbEntry *entry);
+		void removeEntry(int id);
+		void reindexEntry(esdbEntry *entry);
+		esdbEntry *findEntry(const QString &fullTitle) const;
+	private:
+		void indexEntry(esdbEntry *entry);
+		void unindexEntry(int id);
 	};
+	typeData *typeNameToTypeData(const QString &name) const;
 
 	DataTypeListModel *m_dataTypesModel;
 
@@ -193,11 +214,38 @@ public:
 	int getUnusedId();
 	int getUnusedTypeId(const QSet<int> &reserved);
 	int getUnusedTypeId();
+	//Fill filtered with the entries matching filter, best matches first.
+	//Returns true if any entry belongs to a group.
+	static bool filterEntries(const esdbEntryTable &entries, const QString &filter, QList<esdbEntry *> &filtered);
 	esdbEntry *findEntry(QString type, QString name) const;
-	const QMap<int, esdbEntry *> *entryToEntryMap(esdbEntry *entry);
+	void setEntryDigest(int id, const block *blk);
+	void setEntryDigest(int id, const QByteArray &digest);
+	//True if digest, a block::contentHash(), matches the stored entry
+	bool entryUnchanged(int id, const QByteArray &digest) const;
+	const QSet<int> &staleEntries() const
+	{
+		return m_staleEntries;
+	}
+	//Re-serialize an entry read unmasked from the device in the current
+	//revision. Returns false if it is not a stale entry.
+	bool upgradeEntry(int id, block *stored, block *upgraded);
+	void entryUpgraded(int id, const block *blk);
+	//Refuse edits and deletes while another task writes entries. reason
+	//is shown to the user, an empty reason lifts the block.
+	void blockEntryWrites(const QString &reason);
+	bool entryWritesBlocked() const
+	{
+		return !m_entryWritesBlocked.isEmpty();
+	}
+	//Returns true if entries can be changed, otherwise tells the user why not
+	bool checkEntryWrites();
+	//Show w above the entry list until it is deleted. The widget takes
+	//ownership of w.
+	void showStatusWidget(QWidget *w);
+	const esdbEntryTable *entryToEntryMap(esdbEntry *entry);
 
 	QList<esdbTypeModule *> getTypeModules();
-	const QMap<int, esdbEntry *> *typeNameToEntryMap(QString name);
+	const esdbEntryTable *typeNameToEntryMap(QString name);
 	void getCurrentGroups(QString typeName, QStringList &groups);
         ButtonWaitWidget *getButtonWaitWidget() const {
             return m_buttonWaitWidget;
@@ -6,10 +6,11 @@
 #include <QMessageBox>
 #include <QLineEdit>
 #include <QThread>
+#include <QTimer>
 
 #include "buttonwaitdialog.h"
 #include "signetapplication.h"
-#include "keygeneratorthread.h"
+#include "keyderivationservice.h"
 
 extern "C" {
 #include "signetdev/host/signetdev.h"
@@ -24,17 +25,17 @@ extern "C" {
 
 LoginWindow::LoginWindow(QWidget *parent) : QWidget(parent),
 	m_parent(static_cast<MainWindow *>(parent)),
+	m_keyDerivation(nullptr),
 	m_loggingIn(false),
 	m_preparingLogin(false),
-	m_signetdevCmdToken(-1)
+	m_signetdevCmdToken(-1),
+	m_speculativeKeyDerivation(nullptr),
+	m_speculativeKeyReady(false)
 {
-	m_keyGenerator = new KeyGeneratorThread();
-
-	SignetApplication *app = SignetApplication::get();
-
-	QObject::connect(m_keyGenerator, SIGNAL(finished()), this, SLOT(keyGenerated()));
-	QObject::connect(app, SIGNAL(signetdevCmdResp(signetdevCmdRespInfo)),
-			 this, SLOT(signetdevCmdResp(signetdevCmdRespInfo)));
+	m_speculateTimer = new QTimer(this);
+	m_speculateTimer->setSingleShot(true);
+	m_speculateTimer->setInterval(s_speculateDelayMs);
+	connect(m_speculateTimer, SIGNAL(timeout()), this, SLOT(speculate()));
 
 	QLayout *top_layout = new QBoxLayout(QBoxLayout::TopToBottom);
 	QLayout *layout = new QBoxLayout(QBoxLayout::LeftToRight);
@@ -78,32 +79,94 @@ LoginWindow::~LoginWindow()
 {
 	m_preparingLogin = false;
 	m_loggingIn = false;
-	m_keyGenerator->wait();
-	m_keyGenerator->deleteLater();
-	m_keyGenerator = NULL;
+	discardSpeculation();
+	releaseKeyDerivation();
+}
+
+void LoginWindow::releaseKeyDerivation()
+{
+	if (m_keyDerivation) {
+		m_keyDerivation->release();
+		m_keyDerivation = nullptr;
+	}
+}
+
+void LoginWindow::sendLogin(const QByteArray &key)
+{
+	m_preparingLogin = false;
+	updateWidgetState();
+	ButtonWaitWidget *w = m_parent->beginButtonWait("unlock device", false);
+	connect(w, SIGNAL(timeout()), this, SLOT(buttonWaitFinished()));
+	connect(w, SIGNAL(canceled()), this, SLOT(buttonWaitFinished()));
+	::signetdev_login(NULL, &m_signetdevCmdToken,
+			  (u8 *)key.data(),
+			  key.length(), 0);
+	SignetApplication::routeResponses(m_signetdevCmdToken, this);
 }
 
 void LoginWindow::keyGenerated()
 {
+	if (sender() != m_keyDerivation) {
+		return;
+	}
 	if (m_loggingIn) {
 		if (m_preparingLogin) {
-			m_preparingLogin = false;
-			updateWidgetState();
-			ButtonWaitWidget *w = m_parent->beginButtonWait("unlock device", false);
-			connect(w, SIGNAL(timeout()), this, SLOT(buttonWaitFinished()));
-			connect(w, SIGNAL(canceled()), this, SLOT(buttonWaitFinished()));
-			::signetdev_login(NULL, &m_signetdevCmdToken,
-					  (u8 *)m_keyGenerator->getKey().data(),
-					  m_keyGenerator->getKey().length(), 0);
+			sendLogin(m_keyDerivation->getKey());
 		}
 	}
 }
 
+void LoginWindow::discardSpeculation()
+{
+	m_speculateTimer->stop();
+	if (m_speculativeKeyDerivation) {
+		m_speculativeKeyDerivation->release();
+		m_speculativeKeyDerivation = nullptr;
+	}
+	m_speculativePassword.clear();
+	SignetApplication::wipeKey(m_speculativeKey);
+	m_speculativeKeyReady = false;
+}
+
+void LoginWindow::speculate()
+{
+	QString password = m_passwordInput->text();
+	if (m_loggingIn || !password.size() || !m_parent->getSettings()->speculativeUnlock) {
+		return;
+	}
+	discardSpeculation();
+	m_speculativePassword = password;
+	SignetApplication *app = SignetApplication::get();
+	m_speculativeKeyDerivation = KeyDerivationService::get()->derive(password, app->getHashfn(), app->getSalt(), app->getKeyLength());
+	connect(m_speculativeKeyDerivation, SIGNAL(finished()), this, SLOT(speculativeKeyGenerated()));
+}
+
+void LoginWindow::speculativeKeyGenerated()
+{
+	KeyDerivation *d = m_speculativeKeyDerivation;
+	if (!d || sender() != d) {
+		return;
+	}
+	m_speculativeKeyDerivation = nullptr;
+	m_speculativeKey = d->takeKey();
+	d->release();
+	if (!m_speculativeKey.size()) {
+		m_speculativePassword.clear();
+		return;
+	}
+	m_speculativeKeyReady = true;
+	if (m_loggingIn && m_preparingLogin) {
+		sendLogin(m_speculativeKey);
+	}
+}
+
 void LoginWindow::buttonWaitFinished()
 {
 	m_loggingIn = false;
 	m_preparingLogin = false;
 	m_passwordInput->setText("");
+	discardSpeculation();
+	releaseKeyDerivation();
 	updateWidgetState();
 }
 
@@ -128,18 +191,35 @@ void LoginWindow::showEvent(QShowEvent *event)
 void LoginWindow::passwordTextEdited(QString)
 {
 	m_incorrectPassword->hide();
+	discardSpeculation();
+	if (m_parent->getSettings()->speculativeUnlock) {
+		m_speculateTimer->start();
+	}
 }
 
 void LoginWindow::doLogin()
 {
+	m_speculateTimer->stop();
 	m_loggingIn = true;
 	m_preparingLogin = true;
 	updateWidgetState();
+
+	//The submitted password was already being derived while typing paused
+	if ((m_speculativeKeyReady || m_speculativeKeyDerivation) &&
+	    m_speculativePassword == m_passwordInput->text()) {
+		if (m_speculativeKeyReady) {
+			sendLogin(m_speculativeKey);
+		}
+		return;
+	}
+	discardSpeculation();
+	releaseKeyDerivation();
+
 	const QByteArray &current_hashfn = SignetApplication::get()->getHashfn();
 	const QByteArray &current_salt = SignetApplication::get()->getSalt();
 	int keyLength = SignetApplication::get()->getKeyLength();
-	m_keyGenerator->setParams(m_passwordInput->text(), current_hashfn, current_salt, keyLength);
-	m_keyGenerator->start();
+	m_keyDerivation = KeyDerivationService::get()->derive(m_passwordInput->text(), current_hashfn, current_salt, keyLength);
+	connect(m_keyDerivation, SIGNAL(finished()), this, SLOT(keyGenerated()));
 }
 
 void LoginWindow::signetdevCmdResp(signetdevCmdRespInfo info)
@@ -155,6 +235,8 @@ void LoginWindow::signetdevCmdResp(signetdevCmdRespInfo info)
 
 	m_loggingIn = false;
 	m_preparingLogin = false;
+	discardSpeculation();
+	releaseKeyDerivation();
 	updateWidgetState();
 
 	switch (resp_code) {
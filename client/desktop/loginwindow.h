@@ -9,8 +9,9 @@ class QLabel;
 class QLineEdit;
 class CommThread;
 class QPushButton;
-class KeyGeneratorThread;
+class KeyDerivation;
 class MainWindow;
+class QTimer;
 
 struct signetdevCmdRespInfo;
 
@@ -21,13 +22,27 @@ class LoginWindow : public QWidget
 	QLineEdit *m_passwordInput;
 	QLabel *m_incorrectPassword;
 	QPushButton *m_loginButton;
-	KeyGeneratorThread *m_keyGenerator;
+	KeyDerivation *m_keyDerivation;
 	QLabel *m_preparingLabel;
 	bool m_loggingIn;
 	bool m_preparingLogin;
 	void showEvent(QShowEvent *event);
 	void updateWidgetState();
 	int m_signetdevCmdToken;
+
+	void releaseKeyDerivation();
+
+	//When enabled in the settings, a pause in typing starts deriving the
+	//key for the password typed so far. A canceled derivation winds down in
+	//the background while the next one starts.
+	static const int s_speculateDelayMs = 500;
+	QTimer *m_speculateTimer;
+	KeyDerivation *m_speculativeKeyDerivation;
+	QString m_speculativePassword;
+	QByteArray m_speculativeKey;
+	bool m_speculativeKeyReady;
+	void discardSpeculation();
+	void sendLogin(const QByteArray &key);
 public:
 	explicit LoginWindow(QWidget *parent = 0);
 	~LoginWindow();
@@ -38,6 +53,8 @@ signals:
 public slots:
 	void signetdevCmdResp(signetdevCmdRespInfo info);
 	void keyGenerated();
+	void speculativeKeyGenerated();
+	void speculate();
 	void doLogin(void);
         void passwordTextEdited(QString);
 private slots:
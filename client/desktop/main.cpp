@@ -1,4 +1,5 @@
 #include "signetapplication.h"
+#include "commandtracer.h"
 
 #include "crypto/Crypto.h"
 
@@ -61,6 +62,8 @@ int main(int argc, char **argv)
 	QCommandLineParser parser;
 	QCommandLineOption file("file", "Read database from specified file", "file-name");
 	parser.addOption(file);
+	QCommandLineOption trace("trace", "Trace device command latency and write a Chrome trace event file on exit", "file-name");
+	parser.addOption(trace);
 	parser.addHelpOption();
 #ifdef Q_OS_UNIX
 	QCommandLineOption startInTrayOption("start-in-systray", "Start application minimized in the system tray");
@@ -77,6 +80,10 @@ int main(int argc, char **argv)
 		dbFile = parser.value(file);
 	}
 
+	if (parser.isSet(trace)) {
+		CommandTracer::start();
+	}
+
 	app->setQuitOnLastWindowClosed(false);
 
 	app->init(startInTray, dbFile);
@@ -84,6 +91,13 @@ int main(int argc, char **argv)
 
 	signetdev_deinitialize_api();
 
+	if (parser.isSet(trace)) {
+		if (!CommandTracer::writeTrace(parser.value(trace))) {
+			qWarning("Failed to write trace file");
+		}
+		CommandTracer::stop();
+	}
+
 	delete app;
 
 	return 0;
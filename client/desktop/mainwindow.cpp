@@ -30,6 +30,7 @@
 #include <QString>
 #include <QDesktopWidget>
 #include <QTextStream>
+#include <QFutureWatcher>
 #include <zlib.h>
 
 #include "cleartextpasswordeditor.h"
@@ -52,13 +53,16 @@
 #include "editaccount.h"
 #include "buttonwaitdialog.h"
 #include "buttonwaitwidget.h"
+#include "firmwareflashwriter.h"
 #include "loginwindow.h"
 #include "keyboardlayouttester.h"
 
 #include "signetapplication.h"
+#include "keyderivationservice.h"
 #include "settingsdialog.h"
 #include "import/keepassunlockdialog.h"
 #include "import/databaseimportcontroller.h"
+#include "entrymigrationcontroller.h"
 #include "import/keepassimporter.h"
 
 #ifdef Q_OS_UNIX
@@ -84,6 +88,9 @@ extern "C" {
 #define SIGNET_FIRMWARE_SUFFIX "sfw"
 #define SIGNET_HC_FIRMWARE_SUFFIX "sfwhc"
 
+//Block reads kept queued with the device while backing up
+#define BACKUP_READ_WINDOW 4
+
 bool MainWindow::uninitializedFirmwareUpdateSupported()
 {
 	int major, minor, step;
@@ -116,6 +123,11 @@ MainWindow::MainWindow(QString dbFilename, QWidget *parent) :
 	m_deviceState(SignetApplication::STATE_INVALID),
 	m_backupWidget(nullptr),
 	m_backupProgress(nullptr),
+	m_dbImportController(nullptr),
+	m_entryMigrationController(nullptr),
+	m_backgroundUpgradeOffered(false),
+	m_backupBlock(0),
+	m_backupNextRead(0),
 	m_backupFile(nullptr),
 	m_backupPrevState(SignetApplication::STATE_INVALID),
 	m_restoreWidget(nullptr),
@@ -124,6 +136,7 @@ MainWindow::MainWindow(QString dbFilename, QWidget *parent) :
 	m_uninitPrompt(nullptr),
 	m_backupAction(nullptr),
 	m_restoreAction(nullptr),
+	m_upgradeEntriesAction(nullptr),
 	m_logoutAction(nullptr),
 	m_wipeDeviceAction(nullptr),
 	m_eraseDeviceAction(nullptr),
@@ -133,6 +146,8 @@ MainWindow::MainWindow(QString dbFilename, QWidget *parent) :
 	m_NewFirmwareHeader(nullptr),
 	m_NewFirmwareBody(nullptr),
 	m_fwUpgradeState(0),
+	m_flashWriter(nullptr),
+	m_commands(nullptr),
 	m_deviceType(SIGNETDEV_DEVICE_NONE),
 	m_autoBackupCheckPerformed(false)
 {
@@ -154,24 +169,23 @@ MainWindow::MainWindow(QString dbFilename, QWidget *parent) :
 
 	connect(app, SIGNAL(deviceOpened(enum signetdev_device_type)), this, SLOT(deviceOpened(enum signetdev_device_type)));
 	connect(app, SIGNAL(deviceClosed()), this, SLOT(deviceClosed()));
-	connect(app, SIGNAL(signetdevCmdResp(signetdevCmdRespInfo)),
-		this, SLOT(signetdevCmdResp(signetdevCmdRespInfo)));
-	connect(app, SIGNAL(signetdevGetProgressResp(signetdevCmdRespInfo, signetdev_get_progress_resp_data)),
-		this, SLOT(signetdevGetProgressResp(signetdevCmdRespInfo, signetdev_get_progress_resp_data)));
-	connect(app, SIGNAL(signetdevStartupResp(signetdevCmdRespInfo, signetdev_startup_resp_data)),
-		this, SLOT(signetdevStartupResp(signetdevCmdRespInfo, signetdev_startup_resp_data)));
-	connect(app, SIGNAL(signetdevReadBlockResp(signetdevCmdRespInfo, QByteArray)),
-		this, SLOT(signetdevReadBlockResp(signetdevCmdRespInfo, QByteArray)));
-	connect(app, SIGNAL(signetdevReadAllUIdsResp(signetdevCmdRespInfo, int, QByteArray, QByteArray)),
-		this, SLOT(signetdevReadAllUIdsResp(signetdevCmdRespInfo, int, QByteArray, QByteArray)));
-	connect(app, SIGNAL(signetdevReadCleartextPasswordNames(signetdevCmdRespInfo, QVector<int>, QStringList)),
-		this, SLOT(signetdevReadCleartextPasswordNames(signetdevCmdRespInfo, QVector<int>, QStringList)));
 	connect(app, SIGNAL(connectionError()),
 		this, SLOT(connectionError()));
 
+	m_commands = new SignetCommands(this);
+	m_flashWriter = new FirmwareFlashWriter(this);
+	connect(m_flashWriter, SIGNAL(progress(unsigned int, unsigned int)),
+		this, SLOT(firmwareWriteProgress(unsigned int, unsigned int)));
+	connect(m_flashWriter, SIGNAL(finished()), this, SLOT(firmwareWriteFinished()));
+	connect(m_flashWriter, SIGNAL(error(int)), this, SLOT(firmwareWriteError(int)));
+
 	QObject::connect(&m_resetTimer, SIGNAL(timeout()), this, SLOT(resetTimer()));
 
 	QObject::connect(&m_connectingTimer, SIGNAL(timeout()), this, SLOT(connectingTimer()));
+	m_upgradeIdleTimer.setSingleShot(true);
+	m_upgradeIdleTimer.setInterval(s_upgradeIdleMs);
+	QObject::connect(&m_upgradeIdleTimer, SIGNAL(timeout()), this, SLOT(upgradeIdleTimeout()));
+	qApp->installEventFilter(this);
 	QMenuBar *bar = new QMenuBar();
 	setMenuBar(bar);
 	m_fileMenu = bar->addMenu("&File");
@@ -253,6 +267,10 @@ MainWindow::MainWindow(QString dbFilename, QWidget *parent) :
 	QObject::connect(m_changePasswordAction, SIGNAL(triggered(bool)),
 			 this, SLOT(changePasswordUi()));
 
+	m_upgradeEntriesAction = m_deviceMenu->addAction("Upgrade old entries");
+	QObject::connect(m_upgradeEntriesAction, SIGNAL(triggered(bool)),
+			 this, SLOT(upgradeEntriesUi()));
+
 	m_eraseDeviceAction = m_deviceMenu->addAction("Reset");
 	QObject::connect(m_eraseDeviceAction, SIGNAL(triggered(bool)),
 			 this, SLOT(eraseDeviceUi()));
@@ -281,10 +299,12 @@ MainWindow::MainWindow(QString dbFilename, QWidget *parent) :
 	m_backupAction->setVisible(false);
 	m_restoreAction->setVisible(false);
 	m_passwordSlots->setVisible(false);
+	m_upgradeEntriesAction->setVisible(false);
 	if (m_dbFilename.size()) {
 		enterDeviceState(SignetApplication::STATE_NEVER_SHOWN);
 		enterDeviceState(SignetApplication::STATE_CONNECTING);
 		::signetdev_startup(nullptr, &m_signetdevCmdToken);
+		SignetApplication::routeResponses(m_signetdevCmdToken, this);
 	} else {
 		enterDeviceState(SignetApplication::STATE_NEVER_SHOWN);
 #ifdef Q_OS_UNIX
@@ -293,6 +313,7 @@ MainWindow::MainWindow(QString dbFilename, QWidget *parent) :
 		SignetApplication::get()->setDeviceType(m_deviceType);
 		if (m_deviceType != SIGNETDEV_DEVICE_NONE) {
 			::signetdev_startup(nullptr, &m_signetdevCmdToken);
+			SignetApplication::routeResponses(m_signetdevCmdToken, this);
 			enterDeviceState(SignetApplication::STATE_STARTING_DEVICE);
 		}
 #endif
@@ -354,6 +375,7 @@ void MainWindow::connectionError()
 		SignetApplication::get()->setDeviceType(m_deviceType);
 		if (m_deviceType != SIGNETDEV_DEVICE_NONE) {
 			::signetdev_startup(nullptr, &m_signetdevCmdToken);
+			SignetApplication::routeResponses(m_signetdevCmdToken, this);
 			enterDeviceState(SignetApplication::STATE_STARTING_DEVICE);
 		}
 	}
@@ -376,11 +398,13 @@ void MainWindow::deviceOpened(enum signetdev_device_type dev_type)
 	m_deviceType = dev_type;
 	SignetApplication::get()->setDeviceType(m_deviceType);
 	::signetdev_startup(nullptr, &m_signetdevCmdToken);
+	SignetApplication::routeResponses(m_signetdevCmdToken, this);
 	enterDeviceState(SignetApplication::STATE_STARTING_DEVICE);
 }
 
 void MainWindow::deviceClosed()
 {
+	SignetApplication::releaseScryptArena();
 	m_deviceType = SIGNETDEV_DEVICE_NONE;
 	SignetApplication::get()->setDeviceType(m_deviceType);
 	emit connectionError();
@@ -401,6 +425,7 @@ void MainWindow::signetdevGetProgressResp(signetdevCmdRespInfo info, signetdev_g
 			m_wipeProgress->setValue(data.total_progress);
 			m_wipeProgress->update();
 			::signetdev_get_progress(nullptr, &m_signetdevCmdToken, data.total_progress, DS_WIPING);
+			SignetApplication::routeResponses(m_signetdevCmdToken, this);
 			break;
 		case INVALID_STATE:
 			enterDeviceState(SignetApplication::STATE_UNINITIALIZED);
@@ -419,10 +444,11 @@ void MainWindow::signetdevGetProgressResp(signetdevCmdRespInfo info, signetdev_g
 			m_firmwareUpdateProgress->setValue(data.total_progress);
 			m_firmwareUpdateProgress->update();
 			::signetdev_get_progress(nullptr, &m_signetdevCmdToken, data.total_progress, DS_ERASING_PAGES);
+			SignetApplication::routeResponses(m_signetdevCmdToken, this);
 			break;
 		case INVALID_STATE: {
-			m_totalWritten = 0;
 			QString updatingString;
+			m_flashWriter->clear();
 
 			if (m_deviceType == SIGNETDEV_DEVICE_HC) {
 				SignetApplication *app = SignetApplication::get();
@@ -439,26 +465,15 @@ void MainWindow::signetdevGetProgressResp(signetdevCmdRespInfo info, signetdev_g
 					abort();
 					break;
 				}
-				m_writingAddr = 0;
-				int firmwareSize = firmwareSizeHC();
-				m_firmwareUpdateProgress->setRange(0, firmwareSize);
-				m_firmwareUpdateProgress->setValue(0);
-				sendFirmwareWriteCmdHC();
+				m_flashWriter->addRegion(0, firmwareImageHC(), firmwareSizeHC(), 512, true);
 			} else {
-				int total_bytes = 0;
-
 				for (auto a = m_fwSections.begin(); a != m_fwSections.end(); a++) {
-					total_bytes += a->size;
+					m_flashWriter->addRegion(a->lma, a->contents.data(), a->size, 1024);
 				}
-				m_firmwareUpdateProgress->setRange(0, total_bytes);
-				m_firmwareUpdateProgress->setValue(0);
-
-				m_writingSectionIter = m_fwSections.begin();
-				m_writingAddr = m_writingSectionIter->lma;
-				sendFirmwareWriteCmd();
 				updatingString = "Writing firmware...";
 			}
 			m_firmwareUpdateStage->setText(updatingString);
+			m_flashWriter->start();
 		}
 		break;
 		case SIGNET_ERROR_DISCONNECT:
@@ -471,56 +486,77 @@ void MainWindow::signetdevGetProgressResp(signetdevCmdRespInfo info, signetdev_g
 	}
 }
 
-void MainWindow::signetdevReadBlockResp(signetdevCmdRespInfo info, QByteArray block)
+void MainWindow::queueBackupReads()
 {
-	if (info.token != m_signetdevCmdToken) {
-		return;
+	int numBlocks = ::signetdev_device_num_storage_blocks();
+	while (m_backupReads.size() < BACKUP_READ_WINDOW && m_backupNextRead < numBlocks) {
+		QFuture<signetdevReply> read = m_commands->readBlock(m_backupNextRead);
+		m_backupNextRead++;
+		QFutureWatcher<signetdevReply> *watcher = new QFutureWatcher<signetdevReply>(this);
+		connect(watcher, SIGNAL(finished()), this, SLOT(backupBlockRead()));
+		connect(watcher, SIGNAL(finished()), watcher, SLOT(deleteLater()));
+		watcher->setFuture(read);
+		m_backupReads.append(read);
 	}
-	m_signetdevCmdToken = -1;
+}
 
-	int code = info.resp_code;
-	switch (code) {
-	case OKAY: {
-		int rc;
-		rc = m_backupFile->write(block);
-		if (rc == -1) {
-			QMessageBox * box = SignetApplication::messageBoxError(QMessageBox::Critical, "Backup database to file", "Failed to write to backup file", this);
-			connect(box, SIGNAL(finished(int)), this, SLOT(backupError()));
-			m_backupFile->close();
-			m_backupFile->remove();
-			delete m_backupFile;
-			m_backupFile = nullptr;
-			::signetdev_end_device_backup(nullptr, &m_signetdevCmdToken);
-			return;
+void MainWindow::backupFailed()
+{
+	m_backupFile->close();
+	m_backupFile->remove();
+	delete m_backupFile;
+	m_backupFile = nullptr;
+}
+
+void MainWindow::backupBlockRead()
+{
+	//Reads can finish in any order but blocks are written in order. Reads
+	//still in flight after a failure are drained and dropped.
+	while (m_backupReads.size() && m_backupReads.first().isFinished()) {
+		QFuture<signetdevReply> read = m_backupReads.takeFirst();
+		if (!m_backupFile) {
+			continue;
 		}
-		m_backupBlock++;
-		m_backupProgress->setMinimum(0);
-		m_backupProgress->setMaximum(::signetdev_device_num_storage_blocks()-1);
-		m_backupProgress->setValue(m_backupBlock);
-		if (m_backupBlock > (::signetdev_device_num_storage_blocks()-1)) {
-			::signetdev_end_device_backup(nullptr, &m_signetdevCmdToken);
-		} else {
-			::signetdev_read_block(nullptr, &m_signetdevCmdToken, m_backupBlock);
+		signetdevReply reply;
+		if (read.resultCount()) {
+			reply = read.result();
+		}
+		switch (reply.respCode) {
+		case OKAY:
+			if (m_backupFile->write(reply.data) == -1) {
+				QMessageBox * box = SignetApplication::messageBoxError(QMessageBox::Critical, "Backup database to file", "Failed to write to backup file", this);
+				connect(box, SIGNAL(finished(int)), this, SLOT(backupError()));
+				backupFailed();
+				::signetdev_end_device_backup(nullptr, &m_signetdevCmdToken);
+				SignetApplication::routeResponses(m_signetdevCmdToken, this);
+				continue;
+			}
+			m_backupBlock++;
+			break;
+		case BUTTON_PRESS_CANCELED:
+		case BUTTON_PRESS_TIMEOUT:
+		case SIGNET_ERROR_DISCONNECT:
+		case SIGNET_ERROR_QUIT:
+			backupFailed();
+			continue;
+		default:
+			backupFailed();
+			abort();
+			return;
 		}
 	}
-	break;
-	case BUTTON_PRESS_CANCELED:
-	case BUTTON_PRESS_TIMEOUT:
-	case SIGNET_ERROR_DISCONNECT:
-	case SIGNET_ERROR_QUIT:
-		m_backupFile->close();
-		m_backupFile->remove();
-		delete m_backupFile;
-		m_backupFile = nullptr;
-		break;
-	default:
-		m_backupFile->close();
-		m_backupFile->remove();
-		delete m_backupFile;
-		m_backupFile = nullptr;
-		abort();
+	if (!m_backupFile) {
 		return;
 	}
+	m_backupProgress->setMinimum(0);
+	m_backupProgress->setMaximum(::signetdev_device_num_storage_blocks()-1);
+	m_backupProgress->setValue(m_backupBlock);
+	if (m_backupBlock > (::signetdev_device_num_storage_blocks()-1)) {
+		::signetdev_end_device_backup(nullptr, &m_signetdevCmdToken);
+		SignetApplication::routeResponses(m_signetdevCmdToken, this);
+	} else {
+		queueBackupReads();
+	}
 }
 
 void MainWindow::signetdevCmdResp(signetdevCmdRespInfo info)
@@ -554,48 +590,7 @@ void MainWindow::signetdevCmdResp(signetdevCmdRespInfo info)
 	case SIGNETDEV_CMD_ERASE_PAGES:
 		if (code == OKAY) {
 			::signetdev_get_progress(nullptr, &m_signetdevCmdToken, 0, DS_ERASING_PAGES);
-		}
-		break;
-	case SIGNETDEV_CMD_WRITE_FLASH:
-		if (code == OKAY) {
-			m_totalWritten += m_writingSize;
-			m_firmwareUpdateProgress->setValue(m_totalWritten);
-			m_firmwareUpdateProgress->update();
-			if (m_deviceType == SIGNETDEV_DEVICE_HC) {
-				if (m_totalWritten >= firmwareSizeHC()) {
-					SignetApplication *app = SignetApplication::get();
-					auto bootMode = app->getBootMode();
-					bool needReset = false;
-					switch (bootMode) {
-					case HC_BOOT_BOOTLOADER_MODE:
-						m_fwUpgradeState &= ~HC_UPGRADING_APPLICATION_MASK;
-						m_fwUpgradeState |= HC_UPGRADED_APPLICATION_MASK;
-						needReset = true;
-						break;
-					case HC_BOOT_APPLICATION_MODE:
-						m_fwUpgradeState &= ~HC_UPGRADING_BOOTLOADER_MASK;
-						m_fwUpgradeState |= HC_UPGRADED_BOOTLOADER_MASK;
-						needReset = (m_fwUpgradeState & HC_UPGRADED_APPLICATION_MASK) == 0;
-						break;
-					default:
-						//TODO
-						break;
-					}
-					if (needReset) {
-						::signetdev_switch_boot_mode(nullptr, &m_signetdevCmdToken);
-					}
-				} else {
-					sendFirmwareWriteCmdHC();
-				}
-			} else {
-				if (m_writingSectionIter == m_fwSections.end()) {
-					::signetdev_reset_device(nullptr, &m_signetdevCmdToken);
-				} else {
-					sendFirmwareWriteCmd();
-				}
-			}
-		} else {
-			m_totalWritten++;
+			SignetApplication::routeResponses(m_signetdevCmdToken, this);
 		}
 		break;
 	case SIGNETDEV_CMD_WRITE_BLOCK:
@@ -610,12 +605,14 @@ void MainWindow::signetdevCmdResp(signetdevCmdRespInfo info)
 				int sz = m_restoreFile->read(block.data(), block.length());
 				if (sz == ::signetdev_device_block_size()) {
 					::signetdev_write_block(nullptr, &m_signetdevCmdToken, m_restoreBlock, block.data());
+					SignetApplication::routeResponses(m_signetdevCmdToken, this);
 				} else {
 					QMessageBox *box = SignetApplication::messageBoxError(QMessageBox::Critical, "Restore device", "Failed to read from source file", this);
 					connect(box, SIGNAL(finished(int)), this, SLOT(restoreError()));
 				}
 			} else {
 				::signetdev_end_device_restore(nullptr, &m_signetdevCmdToken);
+				SignetApplication::routeResponses(m_signetdevCmdToken, this);
 			}
 		}
 		break;
@@ -625,7 +622,9 @@ void MainWindow::signetdevCmdResp(signetdevCmdRespInfo info)
 			m_backupPrevState = m_deviceState;
 			enterDeviceState(SignetApplication::STATE_BACKING_UP);
 			m_backupBlock = 0;
-			::signetdev_read_block(nullptr, &m_signetdevCmdToken, m_backupBlock);
+			m_backupNextRead = 0;
+			m_backupReads.clear();
+			queueBackupReads();
 		} else {
 			do_abort = do_abort && (code != BUTTON_PRESS_CANCELED && code != BUTTON_PRESS_TIMEOUT);
 			if (m_backupFile) {
@@ -658,6 +657,7 @@ void MainWindow::signetdevCmdResp(signetdevCmdRespInfo info)
 			qint64 sz = m_restoreFile->read(block.data(), block.length());
 			if (sz == ::signetdev_device_block_size()) {
 				::signetdev_write_block(nullptr, &m_signetdevCmdToken, m_restoreBlock, block.data());
+				SignetApplication::routeResponses(m_signetdevCmdToken, this);
 			} else {
 				QMessageBox *box = SignetApplication::messageBoxError(QMessageBox::Critical, "Restore device", "Failed to read from source file", this);
 				connect(box, SIGNAL(finished(int)), this, SLOT(restoreError()));
@@ -669,6 +669,7 @@ void MainWindow::signetdevCmdResp(signetdevCmdRespInfo info)
 	case SIGNETDEV_CMD_END_DEVICE_RESTORE:
 		if (code == OKAY) {
 			::signetdev_startup(nullptr, &m_signetdevCmdToken);
+			SignetApplication::routeResponses(m_signetdevCmdToken, this);
 		}
 		break;
 	case SIGNETDEV_CMD_LOGOUT:
@@ -728,11 +729,13 @@ void MainWindow::signetdevCmdResp(signetdevCmdRespInfo info)
 void MainWindow::restoreError()
 {
 	::signetdev_end_device_restore(nullptr, &m_signetdevCmdToken);
+	SignetApplication::routeResponses(m_signetdevCmdToken, this);
 }
 
 void MainWindow::backupError()
 {
 	::signetdev_end_device_backup(nullptr, &m_signetdevCmdToken);
+	SignetApplication::routeResponses(m_signetdevCmdToken, this);
 }
 
 #include "genericfields.h"
@@ -1028,6 +1031,7 @@ void MainWindow::closeEvent(QCloseEvent *event)
 		default:
 			event->ignore();
 			::signetdev_disconnect(nullptr, &m_signetdevCmdToken);
+			SignetApplication::routeResponses(m_signetdevCmdToken, this);
 			return;
 		}
 		m_settings.windowGeometry = saveGeometry();
@@ -1054,6 +1058,7 @@ void MainWindow::logoutUi()
 {
 	if (m_deviceState == SignetApplication::STATE_LOGGED_IN) {
 		::signetdev_logout(nullptr, &m_signetdevCmdToken);
+		SignetApplication::routeResponses(m_signetdevCmdToken, this);
 	}
 }
 
@@ -1125,6 +1130,8 @@ void MainWindow::saveSettings()
 #ifndef Q_OS_MACOS
 	obj.insert("minimizeToTray", QJsonValue(m_settings.minimizeToTray));
 #endif
+	obj.insert("speculativeUnlock", QJsonValue(m_settings.speculativeUnlock));
+	obj.insert("backgroundUpgrade", QJsonValue(m_settings.backgroundUpgrade));
 	obj.insert("windowGeometry", QJsonValue(QLatin1String(m_settings.windowGeometry.toBase64())));
 
 	QJsonObject keyboardLayouts;
@@ -1319,6 +1326,7 @@ void MainWindow::settingsChanged()
 	} else {
 		SignetApplication::get()->stopWebsocketServer();
 	}
+	armBackgroundUpgrade();
 }
 
 void MainWindow::loadSettings()
@@ -1422,6 +1430,20 @@ void MainWindow::loadSettings()
 	}
 #endif
 
+	QJsonValue speculativeUnlock = obj.value("speculativeUnlock");
+	if (speculativeUnlock.isBool()) {
+		m_settings.speculativeUnlock = speculativeUnlock.toBool();
+	} else {
+		m_settings.speculativeUnlock = false;
+	}
+
+	QJsonValue backgroundUpgrade = obj.value("backgroundUpgrade");
+	if (backgroundUpgrade.isBool()) {
+		m_settings.backgroundUpgrade = backgroundUpgrade.toBool();
+	} else {
+		m_settings.backgroundUpgrade = false;
+	}
+
 	QJsonValue activeKeyboardLayout = obj.value("activeKeyboardLayout");
 	if (activeKeyboardLayout.isString()) {
 		m_settings.activeKeyboardLayout = activeKeyboardLayout.toString();
@@ -1650,6 +1672,7 @@ void MainWindow::enterDeviceState(int state)
 		m_eraseDeviceAction->setVisible(false);
 		m_wipeDeviceAction->setVisible(false);
 		m_passwordSlots->setVisible(false);
+		m_upgradeEntriesAction->setVisible(false);
 		m_importMenu->setDisabled(true);
 		m_deviceMenu->setTitle("&Database");
 	} else {
@@ -1660,6 +1683,7 @@ void MainWindow::enterDeviceState(int state)
 		return;
 	switch (m_deviceState) {
 	case SignetApplication::STATE_LOGGED_IN:
+		stopEntryMigration();
 		break;
 	case SignetApplication::STATE_BACKING_UP:
 	case SignetApplication::STATE_EXPORTING:
@@ -1759,9 +1783,12 @@ void MainWindow::enterDeviceState(int state)
 		m_fileMenu->setDisabled(true);
 		setCentralStack(m_wipingWidget);
 		::signetdev_get_progress(nullptr, &m_signetdevCmdToken, 0, DS_WIPING);
+		SignetApplication::routeResponses(m_signetdevCmdToken, this);
 	}
 	break;
 	case SignetApplication::STATE_LOGGED_IN_LOADING_ACCOUNTS: {
+		//The login key is derived, its scratch memory can go
+		KeyDerivationService::get()->releaseScratchMemory();
 		m_loggedIn = true;
 		m_deviceMenu->setDisabled(true);
 		m_fileMenu->setDisabled(true);
@@ -1856,6 +1883,7 @@ void MainWindow::enterDeviceState(int state)
 		m_fileMenu->setDisabled(true);
 		if (m_deviceType == SIGNETDEV_DEVICE_HC) {
 			::signetdev_erase_pages_hc(nullptr, &m_signetdevCmdToken);
+			SignetApplication::routeResponses(m_signetdevCmdToken, this);
 		} else {
 			QByteArray erase_pages_;
 			QByteArray page_mask(512, 0);
@@ -1883,6 +1911,7 @@ void MainWindow::enterDeviceState(int state)
 			::signetdev_erase_pages(nullptr, &m_signetdevCmdToken,
 						erase_pages_.size(),
 						(u8 *)erase_pages_.data());
+			SignetApplication::routeResponses(m_signetdevCmdToken, this);
 		}
 		setCentralStack(m_firmwareUpdateWidget);
 	}
@@ -1940,6 +1969,7 @@ void MainWindow::enterDeviceState(int state)
 		}
 		m_changePasswordAction->setVisible(false);
 		m_passwordSlots->setVisible(false);
+		m_upgradeEntriesAction->setVisible(false);
 
 		m_uninitPrompt = new QWidget();
 		QVBoxLayout *layout = new QVBoxLayout();
@@ -1979,6 +2009,7 @@ void MainWindow::enterDeviceState(int state)
 			m_eraseDeviceAction->setText("Reinitialize");
 		}
 		m_passwordSlots->setVisible(false);
+		m_upgradeEntriesAction->setVisible(false);
 		m_backupAction->setVisible(false);
 		m_logoutAction->setDisabled(true);
 		m_updateFirmwareAction->setVisible(false);
@@ -2008,6 +2039,7 @@ void MainWindow::enterDeviceState(int state)
 			}
 			m_changePasswordAction->setVisible(true);
 			m_updateFirmwareAction->setVisible(true);
+			m_upgradeEntriesAction->setVisible(updateUidsSupported());
 			SignetApplication *app = SignetApplication::get();
 			int major;
 			int minor;
@@ -2016,6 +2048,7 @@ void MainWindow::enterDeviceState(int state)
 			if (m_deviceType == SIGNETDEV_DEVICE_ORIGINAL && major == 1 && ((minor > 3) || (minor == 3 && step >= 2))) {
 				m_passwordSlots->setVisible(true);
 			}
+			armBackgroundUpgrade();
 		}
 	}
 	break;
@@ -2025,6 +2058,7 @@ void MainWindow::enterDeviceState(int state)
 
 	if (!m_loggedIn) {
 		m_autoBackupCheckPerformed = false;
+		m_backgroundUpgradeOffered = false;
 	}
 
 	bool fileActionsEnabled = (m_deviceState == SignetApplication::STATE_LOGGED_IN);
@@ -2083,6 +2117,7 @@ void MainWindow::openFileDialogFinished(int rc)
 			enterDeviceState(SignetApplication::STATE_NEVER_SHOWN);
 			enterDeviceState(SignetApplication::STATE_CONNECTING);
 			::signetdev_startup(nullptr, &m_signetdevCmdToken);
+			SignetApplication::routeResponses(m_signetdevCmdToken, this);
 		}
 	} else {
 		SignetApplication::messageBoxError(QMessageBox::Warning, "Open", "Database file not valid", this);
@@ -2100,6 +2135,7 @@ void MainWindow::closeUi()
 		SignetApplication::get()->setDeviceType(m_deviceType);
 		if (m_deviceType != SIGNETDEV_DEVICE_NONE) {
 			::signetdev_startup(nullptr, &m_signetdevCmdToken);
+			SignetApplication::routeResponses(m_signetdevCmdToken, this);
 		}
 	}
 }
@@ -2151,6 +2187,7 @@ void MainWindow::resetTimer()
 	SignetApplication::get()->setDeviceType(m_deviceType);
 	if (m_deviceType != SIGNETDEV_DEVICE_NONE) {
 		::signetdev_startup(nullptr, &m_signetdevCmdToken);
+		SignetApplication::routeResponses(m_signetdevCmdToken, this);
 	}
 }
 
@@ -2171,49 +2208,67 @@ int MainWindow::firmwareSizeHC()
 	return bootImageSz;
 }
 
-void MainWindow::sendFirmwareWriteCmdHC()
+const u8 *MainWindow::firmwareImageHC()
 {
 	auto app = SignetApplication::get();
-	unsigned int write_size = 512;
-	const u8 *data = nullptr;
 	switch (app->getBootMode()) {
 	case HC_BOOT_BOOTLOADER_MODE:
-		data = m_NewFirmwareBody->firmware_B + m_writingAddr;
-		break;
+		return m_NewFirmwareBody->firmware_B;
 	case HC_BOOT_APPLICATION_MODE:
-		data = m_NewFirmwareBody->firmware_A + m_writingAddr;
-		break;
+		return m_NewFirmwareBody->firmware_A;
 	default:
-		return;
+		return nullptr;
 	}
-	::signetdev_write_flash(nullptr, &m_signetdevCmdToken, m_writingAddr, data, write_size);
-	m_writingAddr += write_size;
-	m_writingSize = write_size;
 }
 
-void MainWindow::sendFirmwareWriteCmd()
+void MainWindow::firmwareWriteProgress(unsigned int written, unsigned int total)
 {
-	bool advance = false;
-	unsigned int section_lma = m_writingSectionIter->lma;
-	int section_size = m_writingSectionIter->size;
-	unsigned int section_end = section_lma + section_size;
-	unsigned int write_size = 1024;
-	if ((m_writingAddr + write_size) >= section_end) {
-		write_size = section_end - m_writingAddr;
-		advance = true;
-	}
-	void *data = m_writingSectionIter->contents.data() + (m_writingAddr - section_lma);
+	m_firmwareUpdateProgress->setRange(0, total);
+	m_firmwareUpdateProgress->setValue(written);
+	m_firmwareUpdateProgress->update();
+}
 
-	::signetdev_write_flash(nullptr, &m_signetdevCmdToken, m_writingAddr, data, write_size);
-	if (advance) {
-		m_writingSectionIter++;
-		if (m_writingSectionIter != m_fwSections.end()) {
-			m_writingAddr = m_writingSectionIter->lma;
+void MainWindow::firmwareWriteFinished()
+{
+	if (m_deviceType == SIGNETDEV_DEVICE_HC) {
+		SignetApplication *app = SignetApplication::get();
+		auto bootMode = app->getBootMode();
+		bool needReset = false;
+		switch (bootMode) {
+		case HC_BOOT_BOOTLOADER_MODE:
+			m_fwUpgradeState &= ~HC_UPGRADING_APPLICATION_MASK;
+			m_fwUpgradeState |= HC_UPGRADED_APPLICATION_MASK;
+			needReset = true;
+			break;
+		case HC_BOOT_APPLICATION_MODE:
+			m_fwUpgradeState &= ~HC_UPGRADING_BOOTLOADER_MASK;
+			m_fwUpgradeState |= HC_UPGRADED_BOOTLOADER_MASK;
+			needReset = (m_fwUpgradeState & HC_UPGRADED_APPLICATION_MASK) == 0;
+			break;
+		default:
+			//TODO
+			break;
+		}
+		if (needReset) {
+			::signetdev_switch_boot_mode(nullptr, &m_signetdevCmdToken);
+			SignetApplication::routeResponses(m_signetdevCmdToken, this);
 		}
 	} else {
-		m_writingAddr += write_size;
+		::signetdev_reset_device(nullptr, &m_signetdevCmdToken);
+		SignetApplication::routeResponses(m_signetdevCmdToken, this);
+	}
+}
+
+void MainWindow::firmwareWriteError(int respCode)
+{
+	switch (respCode) {
+	case SIGNET_ERROR_DISCONNECT:
+	case SIGNET_ERROR_QUIT:
+		break;
+	default:
+		abort();
+		break;
 	}
-	m_writingSize = write_size;
 }
 
 void MainWindow::firmwareFileInvalidMsg()
@@ -2292,6 +2347,7 @@ void MainWindow::updateFirmwareHCIter(bool buttonWait)
 		beginButtonWait("Update firmware", true);
 	}
 	::signetdev_begin_update_firmware_hc(nullptr, &m_signetdevCmdToken, &info);
+	SignetApplication::routeResponses(m_signetdevCmdToken, this);
 }
 
 void MainWindow::updateFirmware(QByteArray &datum)
@@ -2350,6 +2406,7 @@ void MainWindow::updateFirmware(QByteArray &datum)
 	if (valid_fw) {
 		beginButtonWait("Update firmware", true);
 		::signetdev_begin_update_firmware(nullptr, &m_signetdevCmdToken);
+		SignetApplication::routeResponses(m_signetdevCmdToken, this);
 	} else {
 		firmwareFileInvalidMsg();
 	}
@@ -2457,6 +2514,7 @@ void MainWindow::wipeDeviceDialogFinished(int result)
 	}
 	beginButtonWait("wipe device", true);
 	::signetdev_wipe(nullptr, &m_signetdevCmdToken);
+	SignetApplication::routeResponses(m_signetdevCmdToken, this);
 }
 
 void MainWindow::backupDevice(QString fileName)
@@ -2470,6 +2528,7 @@ void MainWindow::backupDevice(QString fileName)
 	QFileInfo fi(m_backupFile->fileName());
 	beginButtonWait("start backing up device to " + fi.fileName(), true);
 	::signetdev_begin_device_backup(nullptr, &m_signetdevCmdToken);
+	SignetApplication::routeResponses(m_signetdevCmdToken, this);
 }
 
 void MainWindow::aboutUi()
@@ -2546,22 +2605,24 @@ void MainWindow::exportCSVUi()
 	beginButtonWait("export to CSV archive", true);
 	m_startedExport = true;
 	::signetdev_read_all_uids(nullptr, &m_signetdevCmdToken, 0);
+	SignetApplication::routeResponses(m_signetdevCmdToken, this);
 }
 
 void MainWindow::importDone(bool success)
 {
+	m_loggedInWidget->blockEntryWrites(QString());
 	m_dbImportController->deleteLater();
 	m_dbImportController = nullptr;
 }
 
-void MainWindow::startImport(DatabaseImporter *importer)
+bool MainWindow::updateUidsSupported()
 {
 	SignetApplication *app = SignetApplication::get();
 	int majorVer;
 	int minorVer;
 	int stepVer;
 	app->getConnectedFirmwareVersion(majorVer, minorVer, stepVer);
-	bool useUpdateUids =
+	return
 		(
 			(m_deviceType == SIGNETDEV_DEVICE_ORIGINAL) &&
 			(majorVer == 1) &&
@@ -2576,13 +2637,153 @@ void MainWindow::startImport(DatabaseImporter *importer)
 		(
 			m_deviceType == SIGNETDEV_DEVICE_HC
 		);
-	m_dbImportController = new DatabaseImportController(importer, m_loggedInWidget, useUpdateUids);
+}
+
+bool MainWindow::importAllowed()
+{
+	if (m_dbImportController) {
+		return false;
+	}
+	if (m_entryMigrationController) {
+		SignetApplication::messageBoxError(QMessageBox::Information, "Import",
+						   "Old entries are being upgraded. Wait for the upgrade to finish before importing", this);
+		return false;
+	}
+	return true;
+}
+
+void MainWindow::startImport(DatabaseImporter *importer)
+{
+	if (!importAllowed()) {
+		importer->deleteLater();
+		return;
+	}
+	m_loggedInWidget->blockEntryWrites("the import");
+	m_dbImportController = new DatabaseImportController(importer, m_loggedInWidget, updateUidsSupported());
 	connect(m_dbImportController, SIGNAL(done(bool)), this, SLOT(importDone(bool)));
 	m_dbImportController->start();
 }
 
+void MainWindow::upgradeEntriesUi()
+{
+	if (m_entryMigrationController) {
+		return;
+	}
+	if (m_dbImportController) {
+		SignetApplication::messageBoxError(QMessageBox::Information, "Upgrade old entries",
+						   "An import is in progress. Wait for it to finish before upgrading old entries", this);
+		return;
+	}
+	if (m_loggedInWidget->staleEntries().isEmpty()) {
+		SignetApplication::messageBoxError(QMessageBox::Information, "Upgrade old entries", "All entries are already stored in the current format", this);
+		return;
+	}
+	startEntryMigration();
+}
+
+void MainWindow::startEntryMigration()
+{
+	m_upgradeIdleTimer.stop();
+	m_backgroundUpgradeOffered = true;
+	m_entryMigrationController = new EntryMigrationController(m_loggedInWidget, this);
+	connect(m_entryMigrationController, SIGNAL(done()), this, SLOT(upgradeEntriesDone()));
+	connect(m_entryMigrationController, SIGNAL(abort()), this, SLOT(abort()));
+	m_entryMigrationController->start();
+}
+
+void MainWindow::stopEntryMigration()
+{
+	m_upgradeIdleTimer.stop();
+	if (m_upgradePrompt) {
+		m_upgradePrompt->disconnect(this);
+		m_upgradePrompt->deleteLater();
+		m_upgradePrompt = nullptr;
+	}
+	if (m_entryMigrationController) {
+		m_entryMigrationController->stop();
+		m_entryMigrationController->deleteLater();
+		m_entryMigrationController = nullptr;
+	}
+}
+
+void MainWindow::upgradeEntriesDone()
+{
+	m_entryMigrationController->deleteLater();
+	m_entryMigrationController = nullptr;
+}
+
+void MainWindow::armBackgroundUpgrade()
+{
+	//Offered once per login. The upgrade needs a button press, so it is
+	//not offered again after being declined, canceled or timing out.
+	if (!m_settings.backgroundUpgrade || m_backgroundUpgradeOffered ||
+	    m_deviceState != SignetApplication::STATE_LOGGED_IN ||
+	    m_dbFilename.size() || !updateUidsSupported() ||
+	    m_entryMigrationController || m_loggedInWidget->staleEntries().isEmpty()) {
+		m_upgradeIdleTimer.stop();
+		return;
+	}
+	m_upgradeIdleTimer.start();
+}
+
+void MainWindow::upgradeIdleTimeout()
+{
+	//Wait for the device to be free as well: no import running, no other
+	//operation waiting on a button press and no entry open for editing
+	if (m_dbImportController || m_loggedInStack->currentIndex() != 0 || m_buttonWaitWidget ||
+	    QApplication::activeModalWidget()) {
+		m_upgradeIdleTimer.start();
+		return;
+	}
+	//The upgrade reads every entry in full and waits on a button press so
+	//it is never started without asking
+	m_upgradeIdleTimer.stop();
+	m_backgroundUpgradeOffered = true;
+	m_upgradePrompt = new QMessageBox(QMessageBox::Question,
+					  "Upgrade old entries",
+					  QString::number(m_loggedInWidget->staleEntries().size()) +
+					  " entries are stored in an old format. Upgrade them now?"
+					  " You will be asked to press the device button.",
+					  QMessageBox::Yes | QMessageBox::No,
+					  this);
+	connect(m_upgradePrompt, SIGNAL(finished(int)), this, SLOT(upgradePromptFinished(int)));
+	m_upgradePrompt->setWindowModality(Qt::WindowModal);
+	m_upgradePrompt->setAttribute(Qt::WA_DeleteOnClose);
+	m_upgradePrompt->show();
+}
+
+void MainWindow::upgradePromptFinished(int rc)
+{
+	m_upgradePrompt = nullptr;
+	if (rc != QMessageBox::Yes || m_entryMigrationController || m_dbImportController ||
+	    m_loggedInWidget->staleEntries().isEmpty()) {
+		return;
+	}
+	startEntryMigration();
+}
+
+bool MainWindow::eventFilter(QObject *obj, QEvent *event)
+{
+	//Any input restarts the wait for the client to go idle
+	if (m_upgradeIdleTimer.isActive()) {
+		switch (event->type()) {
+		case QEvent::KeyPress:
+		case QEvent::MouseButtonPress:
+		case QEvent::Wheel:
+			m_upgradeIdleTimer.start();
+			break;
+		default:
+			break;
+		}
+	}
+	return QMainWindow::eventFilter(obj, event);
+}
+
 void MainWindow::importKeePassUI()
 {
+	if (!importAllowed()) {
+		return;
+	}
 	DatabaseImporter *importer = new KeePassImporter(this);
 	startImport(importer);
 }
@@ -2592,6 +2793,7 @@ void MainWindow::importKeePassUI()
 void MainWindow::passwordSlotsUi()
 {
 	::signetdev_read_cleartext_password_names(nullptr, &m_signetdevCmdToken);
+	SignetApplication::routeResponses(m_signetdevCmdToken, this);
 }
 
 void MainWindow::signetdevReadCleartextPasswordNames(signetdevCmdRespInfo info, QVector<int> formats, QStringList names)
@@ -2609,6 +2811,9 @@ void MainWindow::signetdevReadCleartextPasswordNames(signetdevCmdRespInfo info,
 #ifdef Q_OS_UNIX
 void MainWindow::importPassUI()
 {
+	if (!importAllowed()) {
+		return;
+	}
 	DatabaseImporter *importer = new PassImporter(this);
 	startImport(importer);
 }
@@ -2616,6 +2821,9 @@ void MainWindow::importPassUI()
 
 void MainWindow::importCSVUI()
 {
+	if (!importAllowed()) {
+		return;
+	}
 	QList<esdbTypeModule *> typeModules = m_loggedInWidget->getTypeModules();
 
 	DatabaseImporter *importer = new CSVImporter(typeModules, this);
@@ -2657,4 +2865,5 @@ void MainWindow::restoreDeviceUi()
 
 	beginButtonWait("start restoring device", true);
 	::signetdev_begin_device_restore(nullptr, &m_signetdevCmdToken);
+	SignetApplication::routeResponses(m_signetdevCmdToken, this);
 }
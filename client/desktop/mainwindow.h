@@ -15,6 +15,7 @@
 #include "signetapplication.h"
 #include "localsettings.h"
 #include "esdbgenericmodule.h"
+#include "signetcommands.h"
 
 #include <QVector>
 
@@ -31,6 +32,7 @@ class MainWindow;
 #include <QCloseEvent>
 #include <QAction>
 #include <QTimer>
+#include <QPointer>
 #include <QDateTime>
 #include <QString>
 
@@ -47,9 +49,11 @@ class KeyboardLayoutTester;
 class Database;
 class keePassImportController;
 class DatabaseImportController;
+class EntryMigrationController;
 class DatabaseImporter;
 class LoggedInWidget;
 class QFileDialog;
+class FirmwareFlashWriter;
 struct fwSection {
 	QString name;
 	unsigned int lma;
@@ -76,6 +80,7 @@ class MainWindow : public QMainWindow
 	LoggedInWidget *m_loggedInWidget;
 
 	bool uninitializedFirmwareUpdateSupported();
+	bool updateUidsSupported();
 public:
 	explicit MainWindow(QString dbFilename, QWidget *parent = 0);
 	void closeEvent(QCloseEvent *event);
@@ -125,8 +130,22 @@ private:
 
 	QWidget *m_backupWidget;
 	QProgressBar *m_backupProgress;
-	DatabaseImportController *m_dbImportController;
+	QPointer<DatabaseImportController> m_dbImportController;
+	//Stopped when leaving STATE_LOGGED_IN since m_loggedInWidget doesn't
+	//outlive the login
+	QPointer<EntryMigrationController> m_entryMigrationController;
+	//With the backgroundUpgrade setting, the user is asked to upgrade old
+	//entries once the client has had no input for s_upgradeIdleMs
+	static const int s_upgradeIdleMs = 60000;
+	QTimer m_upgradeIdleTimer;
+	bool m_backgroundUpgradeOffered;
+	QPointer<QMessageBox> m_upgradePrompt;
+	void armBackgroundUpgrade();
+	void startEntryMigration();
+	void stopEntryMigration();
 	int m_backupBlock;
+	int m_backupNextRead;
+	QList<QFuture<signetdevReply> > m_backupReads;
 	QFile *m_backupFile;
 	zipFile m_backupZipFile;
 	enum SignetApplication::device_state m_backupPrevState;
@@ -138,10 +157,8 @@ private:
 
 	QWidget *m_firmwareUpdateWidget;
 	QProgressBar *m_firmwareUpdateProgress;
-	QList<fwSection>::iterator m_writingSectionIter;
-	unsigned int m_writingAddr;
-	unsigned int m_writingSize;
-	unsigned int m_totalWritten;
+	FirmwareFlashWriter *m_flashWriter;
+	SignetCommands *m_commands;
 	QList<fwSection> m_fwSections;
 	QLabel *m_firmwareUpdateStage;
 	QTimer m_resetTimer;
@@ -160,6 +177,7 @@ private:
 	QAction *m_backupAction;
 	QAction *m_restoreAction;
 	QAction *m_passwordSlots;
+	QAction *m_upgradeEntriesAction;
 	QAction *m_logoutAction;
 	QAction *m_wipeDeviceAction;
 	QAction *m_eraseDeviceAction;
@@ -186,7 +204,6 @@ private:
 	bool m_passDatabaseFound;
 #endif
 
-	void sendFirmwareWriteCmd();
 	void loadSettings();
 	void saveSettings();
 	void settingsChanged();
@@ -197,7 +214,10 @@ private:
 #ifdef _WIN32
 	bool nativeEvent(const QByteArray &eventType, void *message, long *result);
 #endif
+	//Imports and the entry upgrade both rewrite entries so only one may run
+	bool importAllowed();
 	void startImport(DatabaseImporter *importer);
+	bool eventFilter(QObject *obj, QEvent *event);
 public:
 	bool connected() const
 	{
@@ -210,10 +230,16 @@ private slots:
 	void restoreError();
 	void backupError();
 	void importDone(bool success);
+	void upgradeEntriesDone();
+	void upgradePromptFinished(int rc);
 	void closeUi();
 	void keyboardLayoutNotConfiguredDialogFinished(int rc);
 	void backupDatabasePromptDialogFinished(int rc);
 	void openFileDialogFinished(int rc);
+	void firmwareWriteProgress(unsigned int written, unsigned int total);
+	void firmwareWriteFinished();
+	void firmwareWriteError(int respCode);
+	void backupBlockRead();
 public slots:
 	void signetDevEvent(int);
 	void deviceOpened(enum signetdev_device_type dev_type);
@@ -221,7 +247,6 @@ public slots:
 	void signetdevCmdResp(signetdevCmdRespInfo info);
 	void signetdevGetProgressResp(signetdevCmdRespInfo info, signetdev_get_progress_resp_data data);
 	void signetdevStartupResp(signetdevCmdRespInfo info, signetdev_startup_resp_data resp);
-	void signetdevReadBlockResp(signetdevCmdRespInfo info, QByteArray block);
 	void signetdevReadAllUIdsResp(signetdevCmdRespInfo info, int id, QByteArray data, QByteArray mask);
 	void signetdevReadCleartextPasswordNames(signetdevCmdRespInfo info, QVector<int> formats, QStringList names);
 
@@ -237,7 +262,7 @@ private:
 	void updateFirmwareHC(QByteArray &datum);
 	void updateFirmware(QByteArray &datum);
 	void firmwareFileInvalidMsg();
-	void sendFirmwareWriteCmdHC();
+	const u8 *firmwareImageHC();
 	int firmwareSizeHC();
 	void createFirmwareUpdateWidget();
 	void updateFirmwareHCIter(bool buttonWait);
@@ -247,6 +272,8 @@ private:
 	QString firmwareFilter();
 	QString firmwareSuffix();
 	bool uninitializedWipeSupported();
+	void queueBackupReads();
+	void backupFailed();
 public slots:
 	void abort();
 	void quit();
@@ -265,6 +292,8 @@ public slots:
 	void openSettingsUi();
 	void importKeePassUI();
 	void passwordSlotsUi();
+	void upgradeEntriesUi();
+	void upgradeIdleTimeout();
 #ifdef Q_OS_UNIX
 	void importPassUI();
 #endif
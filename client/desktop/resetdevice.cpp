@@ -19,7 +19,7 @@
 #include "mainwindow.h"
 
 #include "signetapplication.h"
-#include "keygeneratorthread.h"
+#include "keyderivationservice.h"
 
 extern "C" {
 #include "signetdev/host/signetdev.h"
@@ -41,24 +41,14 @@ ResetDevice::ResetDevice(bool destructive, QWidget *parent) :
 	m_randomDataProgressLabel(nullptr),
 	m_randomDataProgressBar(nullptr),
 	m_resetButton(nullptr),
+	m_keyDerivation(nullptr),
 	m_signetdevCmdToken(-1),
 	m_destructive(destructive)
 {
-	m_keyGenerator = new KeyGeneratorThread();
-	QObject::connect(m_keyGenerator, SIGNAL(finished()), this, SLOT(keyGenerated()));
-
 	setWindowModality(Qt::WindowModal);
 
 	setWindowTitle("Initialize device");
 
-	SignetApplication *app = SignetApplication::get();
-	connect(app, SIGNAL(signetdevCmdResp(signetdevCmdRespInfo)),
-		this, SLOT(signetdevCmdResp(signetdevCmdRespInfo)));
-
-	connect(app, SIGNAL(signetdevGetProgressResp(signetdevCmdRespInfo, signetdev_get_progress_resp_data)),
-		this, SLOT(signetdevGetProgressResp(signetdevCmdRespInfo, signetdev_get_progress_resp_data)));
-
-
 	QBoxLayout *layout = new QBoxLayout(QBoxLayout::TopToBottom);
 	layout->setAlignment(Qt::AlignTop);
 	m_passwordEdit_1Label = new genericText("Master password");
@@ -103,23 +93,23 @@ ResetDevice::ResetDevice(bool destructive, QWidget *parent) :
 		layout->addWidget(m_warningMessage);
 	}
 
-	m_authSecurityLevel = new QSpinBox();
-	m_authSecurityLevel->setRange(1, 8);
-	m_authSecurityLevel->setValue(4);
+	m_unlockTime = new QSpinBox();
+	m_unlockTime->setRange(1, 60);
+	m_unlockTime->setValue(DEFAULT_UNLOCK_TIME_SECONDS);
 
-	m_securityLevelComment = new noteText("Note: The security level controls how long it takes to unlock your device. A value of (4) will secure your data against for most threats and allow you to unlock your device in 1-2 seconds. A value of (8) could increase login times to over a minute.");
+	m_unlockTimeComment = new noteText("Note: The login key is made as strong as this computer can derive it within the unlock time. Longer times make your password harder to guess. Slower computers will take longer to unlock your device.");
 
-	auto securityLevelEdit = new QHBoxLayout();
-	securityLevelEdit->addWidget(new genericText("Security level (1-8)"));
-	securityLevelEdit->addWidget(m_authSecurityLevel);
+	auto unlockTimeEdit = new QHBoxLayout();
+	unlockTimeEdit->addWidget(new genericText("Unlock time in seconds (1-60)"));
+	unlockTimeEdit->addWidget(m_unlockTime);
 
 	layout->addWidget(m_passwordEdit_1Label);
 	layout->addWidget(m_passwordEdit_1);
 	layout->addWidget(m_passwordEdit_2Label);
 	layout->addWidget(m_passwordEdit_2);
 	layout->addWidget(m_passwordWarningMessage);
-	layout->addLayout(securityLevelEdit);
-	layout->addWidget(m_securityLevelComment);
+	layout->addLayout(unlockTimeEdit);
+	layout->addWidget(m_unlockTimeComment);
 	layout->addWidget(m_writeProgressLabel);
 	layout->addWidget(m_writeProgressBar);
 	layout->addWidget(m_randomDataProgressLabel);
@@ -131,6 +121,14 @@ ResetDevice::ResetDevice(bool destructive, QWidget *parent) :
 	setLayout(layout);
 }
 
+ResetDevice::~ResetDevice()
+{
+	if (m_keyDerivation) {
+		m_keyDerivation->release();
+		m_keyDerivation = nullptr;
+	}
+}
+
 void ResetDevice::passwordTextChanged(QString)
 {
 	m_passwordWarningMessage->hide();
@@ -138,6 +136,9 @@ void ResetDevice::passwordTextChanged(QString)
 
 void ResetDevice::keyGenerated()
 {
+	if (!m_keyDerivation || sender() != m_keyDerivation) {
+		return;
+	}
 	std::random_device rd;
 	m_generatingKeyLabel->hide();
 	m_buttonPrompt = new ButtonWaitDialog(m_destructive ? "Reset device" : "Initialize device", m_destructive ? "reset device" : "initialize device", this, true);
@@ -151,11 +152,16 @@ void ResetDevice::keyGenerated()
 		memcpy(rand_data + i, &x,
 		       std::min((int)sizeof(unsigned int), sz - i));
 	}
+	m_hashfn = m_keyDerivation->getHashfn();
+	m_salt = m_keyDerivation->getSalt();
 	::signetdev_begin_initialize_device(nullptr, &m_signetdevCmdToken,
-                        (const u8 *)m_keyGenerator->getKey().data(), m_keyGenerator->getKey().length(),
-                        (const u8 *)m_keyGenerator->getHashfn().data(), m_keyGenerator->getHashfn().length(),
-                        (const u8 *)m_keyGenerator->getSalt().data(), m_keyGenerator->getSalt().length(),
+                        (const u8 *)m_keyDerivation->getKey().data(), m_keyDerivation->getKey().length(),
+                        (const u8 *)m_hashfn.data(), m_hashfn.length(),
+                        (const u8 *)m_salt.data(), m_salt.length(),
                         rand_data, sizeof(rand_data));
+	SignetApplication::routeResponses(m_signetdevCmdToken, this);
+	m_keyDerivation->release();
+	m_keyDerivation = nullptr;
 }
 
 void ResetDevice::reset()
@@ -174,23 +180,15 @@ void ResetDevice::reset()
 	m_generatingKeyLabel->show();
 	std::random_device rd;
 
-	QByteArray hashfn;
 	QByteArray salt;
 
-	hashfn.resize(HASH_FN_SZ);
-	hashfn.data()[0] = 1;
-	hashfn.data()[1] = 11 + m_authSecurityLevel->value();
-	hashfn.data()[2] = 8;
-	hashfn.data()[3] = 0;
-	hashfn.data()[4] = 1;
-
 	salt.resize(SALT_SZ_V2);
 	for (int i = 0; i < (SALT_SZ_V2/4); i++) {
 		*((uint32_t *)(salt.data() + (i*4))) = rd();
 	}
-	m_securityLevelComment->hide();
-	m_keyGenerator->setParams(m_passwd, hashfn, salt, AES_256_KEY_SIZE);
-	m_keyGenerator->start();
+	m_unlockTimeComment->hide();
+	m_keyDerivation = KeyDerivationService::get()->deriveCalibrated(m_passwd, m_unlockTime->value() * 1000, salt, AES_256_KEY_SIZE);
+	connect(m_keyDerivation, SIGNAL(finished()), this, SLOT(keyGenerated()));
 }
 
 void ResetDevice::signetdevCmdResp(signetdevCmdRespInfo info)
@@ -215,6 +213,7 @@ void ResetDevice::signetdevCmdResp(signetdevCmdRespInfo info)
 			m_warningMessage->hide();
 		}
 		::signetdev_get_progress(NULL, &m_signetdevCmdToken, 0, DS_INITIALIZING);
+		SignetApplication::routeResponses(m_signetdevCmdToken, this);
 		break;
 	case BUTTON_PRESS_TIMEOUT:
 	case BUTTON_PRESS_CANCELED:
@@ -255,11 +254,12 @@ void ResetDevice::signetdevGetProgressResp(signetdevCmdRespInfo info, signetdev_
 			m_randomDataProgressBar->update();
 		}
 		::signetdev_get_progress(nullptr, &m_signetdevCmdToken, data.total_progress, DS_INITIALIZING);
+		SignetApplication::routeResponses(m_signetdevCmdToken, this);
 		break;
 	case INVALID_STATE: {
 		SignetApplication *app = SignetApplication::get();
-		app->setSalt(m_keyGenerator->getSalt());
-		app->setHashfn(m_keyGenerator->getHashfn());
+		app->setSalt(m_salt);
+		app->setHashfn(m_hashfn);
 		QMessageBox * box = new QMessageBox(QMessageBox::Information,
 						    m_destructive ? "Reset device" : "Initialize device", m_destructive ? "Device reset successfully" : "Device initialized successfully",
 						    QMessageBox::Ok,
@@ -282,7 +282,7 @@ void ResetDevice::signetdevGetProgressResp(signetdevCmdRespInfo info, signetdev_
 void ResetDevice::resetButtonPromptFinished(int code)
 {
 	if (code != QMessageBox::Ok) {
-		m_securityLevelComment->show();
+		m_unlockTimeComment->show();
 		m_passwordEdit_1->setDisabled(false);
 		m_passwordEdit_2->setDisabled(false);
 		m_resetButton->setDisabled(false);
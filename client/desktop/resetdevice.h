@@ -10,7 +10,7 @@
 
 class QLabel;
 class CommThread;
-class KeyGeneratorThread;
+class KeyDerivation;
 class QSpinBox;
 
 struct signetdevCmdRespInfo;
@@ -20,6 +20,7 @@ class ResetDevice : public QDialog
 	Q_OBJECT
 public:
 	explicit ResetDevice(bool destructive, QWidget *parent = nullptr);
+	~ResetDevice();
 private:
 	QDialog *m_buttonPrompt;
 	QLabel *m_warningMessage;
@@ -35,9 +36,11 @@ private:
 	QProgressBar *m_randomDataProgressBar;
 	QString m_passwd;
 	QPushButton *m_resetButton;
-	KeyGeneratorThread *m_keyGenerator;
-	QLabel *m_securityLevelComment;
-	QSpinBox *m_authSecurityLevel;
+	KeyDerivation *m_keyDerivation;
+	QByteArray m_hashfn;
+	QByteArray m_salt;
+	QLabel *m_unlockTimeComment;
+	QSpinBox *m_unlockTime;
 
 	int m_signetdevCmdToken;
 	bool m_destructive;
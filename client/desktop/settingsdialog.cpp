@@ -114,6 +114,12 @@ SettingsDialog::SettingsDialog(MainWindow *mainWindow, bool initial) :
     m_browserPluginSupport = new QCheckBox("Enable browser plugin support");
     m_browserPluginSupport->setChecked(m_settings->browserPluginSupport);
 
+	m_speculativeUnlock = new QCheckBox("Start unlocking while the master password is typed");
+	m_speculativeUnlock->setChecked(m_settings->speculativeUnlock);
+
+	m_backgroundUpgrade = new QCheckBox("Offer to upgrade entries stored in an old format when idle");
+	m_backgroundUpgrade->setChecked(m_settings->backgroundUpgrade);
+
 	QVBoxLayout *topLayout = new QVBoxLayout();
 	topLayout->setAlignment(Qt::AlignTop);
 	topLayout->addWidget(m_localBackups);
@@ -129,6 +135,8 @@ SettingsDialog::SettingsDialog(MainWindow *mainWindow, bool initial) :
 	topLayout->addWidget(m_minimizeToTray);
 #endif
     topLayout->addWidget(m_browserPluginSupport);
+	topLayout->addWidget(m_speculativeUnlock);
+	topLayout->addWidget(m_backgroundUpgrade);
 	topLayout->addLayout(buttonLayout);
 	setLayout(topLayout);
 	setEnableDisable();
@@ -189,6 +197,8 @@ void SettingsDialog::setEnableDisable()
 void SettingsDialog::okayPressed()
 {
 	m_settings->browserPluginSupport = m_browserPluginSupport->isChecked();
+	m_settings->speculativeUnlock = m_speculativeUnlock->isChecked();
+	m_settings->backgroundUpgrade = m_backgroundUpgrade->isChecked();
 	m_settings->localBackups = m_localBackups->isChecked();
 	m_settings->localBackupPath = m_localBackupPath->text();
 	m_settings->localBackupInterval = m_localBackupInterval->value();
@@ -32,6 +32,8 @@ class SettingsDialog : public QDialog
 	QString m_activeKeyboardLayout;
 	QLabel *m_keyboardLayoutUnconfiguredWarning;
 	QCheckBox *m_minimizeToTray;
+	QCheckBox *m_speculativeUnlock;
+	QCheckBox *m_backgroundUpgrade;
 public:
 	SettingsDialog(MainWindow *mainWindow, bool initial);
 public slots:
@@ -3,6 +3,7 @@
 #include "esdb.h"
 #include "editaccount.h"
 #include "buttonwaitwidget.h"
+#include "signetapplication.h"
 
 #include <QHBoxLayout>
 #include <QPushButton>
@@ -292,6 +293,7 @@ bool AccountActionBar::typeAccountData(account *acct)
 	} else {
 		::signetdev_type_w(nullptr, &m_signetdevCmdToken,
                    (u16 *)uKeys.data(), uKeys.length());
+		SignetApplication::routeResponses(m_signetdevCmdToken, nullptr);
         return true;
 	}
 }
@@ -56,11 +56,6 @@ DatabaseField::DatabaseField(const QString &name, QWidget *parent) : QWidget(par
 
 void DatabaseField::init(int width, QList<QWidget *> &widgets, bool stretch)
 {
-	SignetApplication *app = SignetApplication::get();
-
-	QObject::connect(app, SIGNAL(signetdevCmdResp(signetdevCmdRespInfo)),
-			 this, SLOT(signetdevCmdResp(signetdevCmdRespInfo)));
-
 	QPushButton *type_button = new QPushButton(QIcon(":/images/keyboard.png"),"");
 	type_button->setToolTip("Type");
 	type_button->setFocusPolicy(Qt::NoFocus);
@@ -128,6 +123,7 @@ void DatabaseField::retryTypeData()
 		m_buttonWait->resetTimeout();
 	}
 	::signetdev_button_wait(NULL, &m_signetdevCmdToken);
+	SignetApplication::routeResponses(m_signetdevCmdToken, this);
 }
 
 void DatabaseField::signetdevCmdResp(signetdevCmdRespInfo info)
@@ -157,6 +153,7 @@ void DatabaseField::signetdevCmdResp(signetdevCmdRespInfo info)
 			}
 			::signetdev_type_w(nullptr, &m_signetdevCmdToken,
                        (u16 *)m_keysToType.data(), m_keysToType.length());
+			SignetApplication::routeResponses(m_signetdevCmdToken, this);
 		}
 		break;
 		case SIGNETDEV_CMD_TYPE:
@@ -205,6 +202,7 @@ void DatabaseField::typeFieldUi()
 	connect(m_buttonWait, SIGNAL(finished(int)), this, SLOT(typeFieldFinished(int)));
 	m_buttonWait->show();
 	::signetdev_button_wait(NULL, &m_signetdevCmdToken);
+	SignetApplication::routeResponses(m_signetdevCmdToken, this);
 }
 
 void DatabaseField::typeFieldFinished(int rc)
@@ -58,9 +58,6 @@ EditEntryDialog::EditEntryDialog(QString typeName, esdbEntry *ent, QWidget *pare
 void EditEntryDialog::setupBase()
 {
 	setWindowModality(Qt::WindowModal);
-	SignetApplication *app = SignetApplication::get();
-	connect(app, SIGNAL(signetdevCmdResp(signetdevCmdRespInfo)),
-		this, SLOT(signetdevCmdResp(signetdevCmdRespInfo)));
 
 	m_submitButton = new QPushButton(m_isNew ? "&Create" : "&Save");
 	connect(m_submitButton, SIGNAL(pressed()), this, SLOT(submitButtonPressed()));
@@ -151,6 +148,7 @@ void EditEntryDialog::submitButtonPressed()
                    blk.data.size(),
                    (const u8 *)blk.data.data(),
 			       (const u8 *)blk.mask.data());
+	SignetApplication::routeResponses(m_signetdevCmdToken, this);
 }
 
 void EditEntryDialog::undoButtonPressed()
@@ -46,7 +46,7 @@ QPushButton *EsdbActionBar::addButton(QPushButton *button, bool writeOp, bool ty
 void EsdbActionBar::deleteEntry()
 {
 	esdbEntry *entry = selectedEntry();
-	if (entry) {
+	if (entry && m_parent->checkEntryWrites()) {
 		m_parent->selectEntry(nullptr);
 		int id = entry->id;
         QString action = QString("delete " + m_typeName + " \"") + entry->getTitle() + QString("\"");
@@ -61,7 +61,7 @@ void EsdbActionBar::deleteEntry()
 
 void EsdbActionBar::openEntry(esdbEntry *entry)
 {
-	if (entry) {
+	if (entry && m_parent->checkEntryWrites()) {
 		int id = entry->id;
         QString action = "open " + m_typeName.toLower() +  " \"" + entry->getTitle() + "\"";
 		ButtonWaitWidget *buttonWaitWidget = m_parent->beginButtonWait(action, false);
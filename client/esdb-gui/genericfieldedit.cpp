@@ -24,9 +24,6 @@ genericFieldEdit::genericFieldEdit(const QString &name, bool secretField, QWidge
 	m_enableHideCheckbox(true),
 	m_secretField(secretField)
 {
-	SignetApplication *app = SignetApplication::get();
-	QObject::connect(app, SIGNAL(signetdevCmdResp(signetdevCmdRespInfo)),
-			 this, SLOT(signetdevCmdResp(signetdevCmdRespInfo)));
 }
 
 bool genericFieldEdit::isSecretField() const
@@ -141,6 +138,7 @@ void genericFieldEdit::typePressed()
 	connect(m_buttonWait, SIGNAL(finished(int)), this, SLOT(typeFieldFinished(int)));
 	m_buttonWait->show();
 	::signetdev_button_wait(nullptr, &m_signetdevCmdToken);
+	SignetApplication::routeResponses(m_signetdevCmdToken, this);
 }
 
 void genericFieldEdit::typeFieldFinished(int rc)
@@ -179,6 +177,7 @@ void genericFieldEdit::signetdevCmdResp(signetdevCmdRespInfo info)
 				m_buttonWait->done(QMessageBox::Ok);
 			}
 			::signetdev_type_w(NULL, &m_signetdevCmdToken, (u16 *)m_keysToType.data(), m_keysToType.length());
+			SignetApplication::routeResponses(m_signetdevCmdToken, this);
 		}
 		break;
 		case SIGNETDEV_CMD_TYPE:
@@ -206,6 +205,7 @@ void genericFieldEdit::retryTypeData()
 		m_buttonWait->resetTimeout();
 	}
 	::signetdev_button_wait(NULL, &m_signetdevCmdToken);
+	SignetApplication::routeResponses(m_signetdevCmdToken, this);
 }
 
 void genericFieldEdit::secretCheckStateChanged(int state)
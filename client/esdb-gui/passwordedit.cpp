@@ -11,6 +11,7 @@
 #include <random>
 
 #include "style.h"
+#include "signetapplication.h"
 
 PasswordEdit::PasswordEdit(QWidget *parent) :
 	QWidget(parent),
@@ -60,11 +61,6 @@ PasswordEdit::PasswordEdit(QWidget *parent) :
 	layout()->addWidget(m_passwordField);
 	layout()->addWidget(m_generateOptions);
 
-	SignetApplication *app = SignetApplication::get();
-
-	connect(app, SIGNAL(signetdevGetRandBits(signetdevCmdRespInfo,QByteArray)),
-		this, SLOT(signetdevGetRandBits(signetdevCmdRespInfo,QByteArray)));
-
 	connect(m_numGenChars, SIGNAL(valueChanged(int)), this, SLOT(generatePassword()));
 	connect(m_genSymbols, SIGNAL(stateChanged(int)), this, SLOT(generatePassword()));
 	connect(m_genSymbolSet, SIGNAL(textChanged(QString)), this, SLOT(generatePassword()));
@@ -92,6 +88,7 @@ void PasswordEdit::generatePassword()
 	m_generatingDialog->layout()->addWidget(new processingText("Collecting random data from Signet..."));
 	m_generatingDialog->show();
 	::signetdev_get_rand_bits(NULL, &m_signetdevCmdToken, m_numGenChars->value());
+	SignetApplication::routeResponses(m_signetdevCmdToken, this);
 }
 
 void PasswordEdit::signetdevGetRandBits(signetdevCmdRespInfo info, QByteArray block)
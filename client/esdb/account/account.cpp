@@ -10,6 +10,14 @@ void account_0::fromBlock(block *blk)
 	blk->readString(this->password);
 }
 
+void account_0::toBlock(block *blk) const
+{
+	esdbEntry_1::toBlock(blk);
+	blk->writeString(this->acct_name, false);
+	blk->writeString(this->user_name, false);
+	blk->writeString(this->password, true);
+}
+
 void account_1::fromBlock(block *blk)
 {
 	esdbEntry_1::fromBlock(blk);
@@ -19,6 +27,15 @@ void account_1::fromBlock(block *blk)
 	blk->readString(this->url);
 }
 
+void account_1::toBlock(block *blk) const
+{
+	esdbEntry_1::toBlock(blk);
+	blk->writeString(this->acct_name, false);
+	blk->writeString(this->user_name, false);
+	blk->writeString(this->password, true);
+	blk->writeString(this->url, false);
+}
+
 void account_2::fromBlock(block *blk)
 {
 	esdbEntry_1::fromBlock(blk);
@@ -29,6 +46,16 @@ void account_2::fromBlock(block *blk)
 	blk->readString(this->email);
 }
 
+void account_2::toBlock(block *blk) const
+{
+	esdbEntry_1::toBlock(blk);
+	blk->writeString(this->acct_name, false);
+	blk->writeString(this->user_name, false);
+	blk->writeString(this->password, true);
+	blk->writeString(this->url, false);
+	blk->writeString(this->email, false);
+}
+
 void account_3::fromBlock(block *blk)
 {
 	esdbEntry::fromBlock(blk);
@@ -39,6 +66,16 @@ void account_3::fromBlock(block *blk)
 	blk->readString(this->email);
 }
 
+void account_3::toBlock(block *blk) const
+{
+	esdbEntry::toBlock(blk);
+	blk->writeString(this->acctName, false);
+	blk->writeString(this->userName, false);
+	blk->writeString(this->password, true);
+	blk->writeString(this->url, false);
+	blk->writeString(this->email, false);
+}
+
 void account_4::fromBlock(block *blk)
 {
 	esdbEntry::fromBlock(blk);
@@ -50,6 +87,17 @@ void account_4::fromBlock(block *blk)
 	fields.fromBlock(blk);
 }
 
+void account_4::toBlock(block *blk) const
+{
+	esdbEntry::toBlock(blk);
+	blk->writeString(this->acctName, false);
+	blk->writeString(this->userName, false);
+	blk->writeString(this->password, true);
+	blk->writeString(this->url, false);
+	blk->writeString(this->email, false);
+	fields.toBlock(blk);
+}
+
 void account_5::fromBlock(block *blk)
 {
 	esdbEntry::fromBlock(blk);
@@ -61,10 +109,21 @@ void account_5::fromBlock(block *blk)
 	fields.fromBlock(blk);
 }
 
+void account_5::toBlock(block *blk) const
+{
+	esdbEntry::toBlock(blk);
+	blk->writeString(this->acctName, false);
+	blk->writeString(this->userName, false);
+	blk->writeString(this->password, true);
+	blk->writeString(this->url, false);
+	blk->writeString(this->email, false);
+	fields.toBlock(blk);
+}
+
 void account_6::fromBlock(block *blk)
 {
 	esdbEntry::fromBlock(blk);
-	blk->readString(this->path);
+	blk->readInternedString(this->path);
 	blk->readString(this->acctName);
 	blk->readString(this->userName);
 	blk->readString(this->password);
@@ -73,10 +132,22 @@ void account_6::fromBlock(block *blk)
 	fields.fromBlock(blk);
 }
 
+void account_6::toBlock(block *blk) const
+{
+	esdbEntry::toBlock(blk);
+	blk->writeString(this->path, false);
+	blk->writeString(this->acctName, false);
+	blk->writeString(this->userName, false);
+	blk->writeString(this->password, true);
+	blk->writeString(this->url, false);
+	blk->writeString(this->email, false);
+	fields.toBlock(blk);
+}
+
 void account::fromBlock(block *blk)
 {
 	esdbEntry::fromBlock(blk);
-	blk->readString(this->path);
+	blk->readInternedString(this->path);
 	blk->readString(this->acctName);
 	blk->readString(this->userName);
 	blk->readString(this->password);
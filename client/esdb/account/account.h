@@ -13,6 +13,8 @@ struct account_0 : public esdbEntry_1 {
 	QString user_name;
 	QString password;
 	void fromBlock(block *blk);
+	//Only used to produce legacy entries for testing upgrades
+	void toBlock(block *blk) const;
 	account_0(int id_) : esdbEntry_1(id_, ESDB_TYPE_ACCOUNT, 0) {}
 	~account_0() {}
 };
@@ -23,6 +25,8 @@ struct account_1 : public esdbEntry_1 {
 	QString password;
 	QString url;
 	void fromBlock(block *blk);
+	//Only used to produce legacy entries for testing upgrades
+	void toBlock(block *blk) const;
 	account_1(int id_) : esdbEntry_1(id_, ESDB_TYPE_ACCOUNT, 1) {}
 	~account_1() {}
 	void upgrade(account_0 &prev)
@@ -44,6 +48,8 @@ struct account_2 : public esdbEntry_1 {
 	QIcon icon;
 	bool hasIcon;
 	void fromBlock(block *blk);
+	//Only used to produce legacy entries for testing upgrades
+	void toBlock(block *blk) const;
 	account_2(int id_) : esdbEntry_1(id_, ESDB_TYPE_ACCOUNT, 2),
 		hasIcon(false) {}
 	~account_2() {}
@@ -66,6 +72,8 @@ struct account_3 : public esdbEntry {
 	QString url;
 	QString email;
 	void fromBlock(block *blk);
+	//Only used to produce legacy entries for testing upgrades
+	void toBlock(block *blk) const;
 	account_3(int id_) : esdbEntry(id_, ESDB_TYPE_ACCOUNT, 3, id_, 1) {}
 	~account_3() {}
 	void upgrade(account_2 &prev)
@@ -87,6 +95,8 @@ struct account_4 : public esdbEntry {
 	QString email;
 	genericFields_1 fields;
 	void fromBlock(block *blk);
+	//Only used to produce legacy entries for testing upgrades
+	void toBlock(block *blk) const;
 	account_4(int id_) : esdbEntry(id_, ESDB_TYPE_ACCOUNT, 4, id_, 1) {}
 	~account_4() {}
 	void upgrade(account_3 &prev)
@@ -108,6 +118,8 @@ struct account_5 : public esdbEntry {
 	QString email;
 	genericFields_2 fields;
 	void fromBlock(block *blk);
+	//Only used to produce legacy entries for testing upgrades
+	void toBlock(block *blk) const;
 	account_5(int id_) : esdbEntry(id_, ESDB_TYPE_ACCOUNT, 5, id_, 1) {}
 	~account_5() {}
 	void upgrade(account_4 &prev)
@@ -131,6 +143,8 @@ struct account_6 : public esdbEntry {
 	QString path;
 	genericFields_2 fields;
 	void fromBlock(block *blk);
+	//Only used to produce legacy entries for testing upgrades
+	void toBlock(block *blk) const;
 	account_6(int id_) : esdbEntry(id_, ESDB_TYPE_ACCOUNT, 6, id_, 1) {}
 	~account_6() {}
 	void upgrade(account_5 &prev)
@@ -75,9 +75,8 @@ esdbEntry *esdbAccountModule::decodeEntry(int id, int revision, esdbEntry *prev,
 	return entry;
 }
 
-esdbEntry *esdbAccountModule::decodeEntry(const QVector<genericField> &fields, bool doAliasMatch) const
+QVector<QStringList> esdbAccountModule::aliasedFields(bool doAliasMatch) const
 {
-	account *acct = new account(-1);
 	QVector<QStringList> aliasedFields;
 
 	QStringList acctNameAliases;
@@ -121,23 +120,21 @@ esdbEntry *esdbAccountModule::decodeEntry(const QVector<genericField> &fields, b
 	aliasedFields.push_back(usernameAliases);
 	aliasedFields.push_back(passwordAliases);
 	aliasedFields.push_back(urlAliases);
+	return aliasedFields;
+}
 
-	QStringList fieldNames;
-	for (auto f : fields) {
-		fieldNames.append(f.name);
-	}
-
-	QVector<QStringList::const_iterator> aliasMatched = aliasMatch(aliasedFields, fieldNames);
-	QVector<QString> fieldValues = aliasMatchValues(aliasedFields, aliasMatched, fields, &acct->fields);
-
-	acct->acctName = fieldValues[0];
-	if (!acct->acctName.size()) {
-		delete acct;
+esdbEntry *esdbAccountModule::decodeEntry(const importColumnPlan &plan, const QStringList &row) const
+{
+	QString acctName = plan.value(row, 0);
+	if (!acctName.size()) {
 		return nullptr;
 	}
-	acct->path = fieldValues[1];
-	acct->userName = fieldValues[2];
-	acct->password = fieldValues[3];
-	acct->url = fieldValues[4];
+	account *acct = new account(-1);
+	acct->acctName = acctName;
+	acct->path = plan.value(row, 1);
+	acct->userName = plan.value(row, 2);
+	acct->password = plan.value(row, 3);
+	acct->url = plan.value(row, 4);
+	addGenericFields(plan, row, &acct->fields);
 	return acct;
 }
@@ -14,9 +14,11 @@ class QPushButton;
 class ButtonWaitDialog;
 
 struct esdbAccountModule : public esdbTypeModule {
+protected:
+	QVector<QStringList> aliasedFields(bool doAliasMatch) const override;
 public:
 	esdbEntry *decodeEntry(int id, int revision, esdbEntry *prev, struct block *blk) const;
-	esdbEntry *decodeEntry(const QVector<genericField> &fields, bool aliasMatch = true) const;
+	esdbEntry *decodeEntry(const importColumnPlan &plan, const QStringList &row) const override;
 	esdbAccountModule() :
 		esdbTypeModule("Accounts")
 	{ }
@@ -32,9 +32,8 @@ esdbEntry *esdbBookmarkModule::decodeEntry(int id, int revision, esdbEntry *prev
 	return bm;
 }
 
-esdbEntry *esdbBookmarkModule::decodeEntry(const QVector<genericField> &fields, bool doAliasMatch) const
+QVector<QStringList> esdbBookmarkModule::aliasedFields(bool doAliasMatch) const
 {
-	bookmark *b = new bookmark(-1);
 	QVector<QStringList> aliasedFields;
 
 	QStringList nameAliases;
@@ -54,15 +53,13 @@ esdbEntry *esdbBookmarkModule::decodeEntry(const QVector<genericField> &fields,
 
 	aliasedFields.push_back(nameAliases);
 	aliasedFields.push_back(urlAliases);
+	return aliasedFields;
+}
 
-	QStringList fieldNames;
-	for (auto f : fields) {
-		fieldNames.append(f.name);
-	}
-
-	QVector<QStringList::const_iterator> aliasMatched = aliasMatch(aliasedFields, fieldNames);
-	QVector<QString> fieldValues = aliasMatchValues(aliasedFields, aliasMatched, fields, NULL);
-	b->name = fieldValues[0];
-	b->url = fieldValues[1];
+esdbEntry *esdbBookmarkModule::decodeEntry(const importColumnPlan &plan, const QStringList &row) const
+{
+	bookmark *b = new bookmark(-1);
+	b->name = plan.value(row, 0);
+	b->url = plan.value(row, 1);
 	return b;
 }
@@ -11,7 +11,8 @@ class esdbBookmarkModule : public esdbTypeModule
 {
 private:
 	esdbEntry *decodeEntry(int id, int revision, esdbEntry *prev, struct block *blk) const;
-	esdbEntry *decodeEntry(const QVector<genericField> &fields, bool aliasMatch = true) const;
+	esdbEntry *decodeEntry(const importColumnPlan &plan, const QStringList &row) const override;
+	QVector<QStringList> aliasedFields(bool doAliasMatch) const override;
 public:
 	esdbBookmarkModule() :
 		esdbTypeModule("Bookmarks")
@@ -1,6 +1,37 @@
 #include "esdb.h"
 
 #include <QString>
+#include <QCryptographicHash>
+
+QSet<QString> esdbStringPool::s_strings;
+QMutex esdbStringPool::s_lock;
+
+void esdbStringPool::intern(QString &str)
+{
+	if (str.isEmpty()) {
+		return;
+	}
+	QMutexLocker locker(&s_lock);
+	auto iter = s_strings.constFind(str);
+	if (iter == s_strings.constEnd()) {
+		s_strings.insert(str);
+	} else {
+		str = *iter;
+	}
+}
+
+void esdbStringPool::clear()
+{
+	QMutexLocker locker(&s_lock);
+	s_strings.clear();
+	s_strings.squeeze();
+}
+
+int esdbStringPool::size()
+{
+	QMutexLocker locker(&s_lock);
+	return s_strings.size();
+}
 
 void block::beginRead()
 {
@@ -47,6 +78,29 @@ void block::setMask(int index, int len, bool val)
 	}
 }
 
+bool block::hasMaskedBytes() const
+{
+	int n = (data.size() + 7) / 8;
+	for (int i = 0; i < n && i < mask.size(); i++) {
+		if (mask.at(i)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+//
+// Digest of the serialized entry and its mask. Two blocks with equal
+// hashes would be stored identically by the device.
+//
+QByteArray block::contentHash() const
+{
+	QCryptographicHash h(QCryptographicHash::Sha256);
+	h.addData(data);
+	h.addData(mask.left((data.size() + 7) / 8));
+	return h.result();
+}
+
 void block::readString(QString &str)
 {
 	int sz = readU8();
@@ -55,6 +109,12 @@ void block::readString(QString &str)
 	str = QString::fromUtf8(x);
 }
 
+void block::readInternedString(QString &str)
+{
+	readString(str);
+	esdbStringPool::intern(str);
+}
+
 void block::readLongString(QString &str)
 {
 	int sz = readU16();
@@ -131,6 +191,13 @@ void esdbEntry_1::fromBlock(block *blk)
 	revision = blk->readU16();
 }
 
+void esdbEntry_1::toBlock(block *blk) const
+{
+	blk->beginWrite();
+	blk->writeU16(type);
+	blk->writeU16(revision);
+}
+
 esdbEntry::~esdbEntry()
 {
 
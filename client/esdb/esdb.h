@@ -6,6 +6,8 @@
 #include <QString>
 #include <QIcon>
 #include <QVector>
+#include <QSet>
+#include <QMutex>
 
 extern "C" {
 #include "signetdev/common/signetdev_common.h"
@@ -24,6 +26,22 @@ struct genericField {
 	genericField() {}
 };
 
+//
+// Intern table for the short strings that repeat across entries: field
+// names and types, and group paths. Entries decoded through it share a
+// single copy of each string. clear() only drops the table's references,
+// strings still held by entries stay valid.
+//
+class esdbStringPool
+{
+	static QSet<QString> s_strings;
+	static QMutex s_lock;
+public:
+	static void intern(QString &str);
+	static void clear();
+	static int size();
+};
+
 struct block {
 	int index;
 	void setMask(int index, int len, bool val);
@@ -35,6 +53,8 @@ struct block {
 	void writeU8(u8 v);
 	void writeU16(u16 v);
 	void readString(QString &str);
+	//Like readString() but returns the interned copy of the string
+	void readInternedString(QString &str);
 	void writeString(const QString &str, bool masked);
 	void readLongString(QString &str);
 	void writeLongString(const QString &str, bool masked);
@@ -45,6 +65,8 @@ struct block {
 		index = 0;
 	}
 	size_t dataRemaining() const;
+	bool hasMaskedBytes() const;
+	QByteArray contentHash() const;
 };
 
 struct esdbEntry_1 {
@@ -52,6 +74,8 @@ struct esdbEntry_1 {
 	u16 type;
 	u16 revision;
 	virtual void fromBlock(block *blk);
+	//Only used to produce legacy entries for testing upgrades
+	void toBlock(block *blk) const;
 	virtual ~esdbEntry_1();
 	esdbEntry_1(int id_, int type_, int revision_);
 	esdbEntry_1(int id_) : id(id_) {}
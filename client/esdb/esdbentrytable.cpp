@@ -0,0 +1,76 @@
+#include "esdbentrytable.h"
+
+#include <QtAlgorithms>
+
+esdbEntryTable::esdbEntryTable() :
+	m_size(0)
+{
+}
+
+int esdbEntryTable::nextLive(int id) const
+{
+	int word = id / 64;
+	if (word >= m_live.size()) {
+		return -1;
+	}
+	quint64 bits = m_live.at(word) & (~Q_UINT64_C(0) << (id % 64));
+	while (!bits) {
+		word++;
+		if (word >= m_live.size()) {
+			return -1;
+		}
+		bits = m_live.at(word);
+	}
+	return word * 64 + qCountTrailingZeroBits(bits);
+}
+
+void esdbEntryTable::insert(int id, esdbEntry *entry)
+{
+	if (id >= m_slots.size()) {
+		//Grow a whole bitmap word at a time
+		int slots = (id / 64 + 1) * 64;
+		m_slots.resize(slots);
+		m_live.resize(slots / 64);
+	}
+	quint64 bit = Q_UINT64_C(1) << (id % 64);
+	if (!(m_live.at(id / 64) & bit)) {
+		m_live[id / 64] |= bit;
+		m_size++;
+	}
+	m_slots[id] = entry;
+}
+
+void esdbEntryTable::remove(int id)
+{
+	if (!contains(id)) {
+		return;
+	}
+	m_live[id / 64] &= ~(Q_UINT64_C(1) << (id % 64));
+	m_slots[id] = nullptr;
+	m_size--;
+}
+
+void esdbEntryTable::clear()
+{
+	m_slots.clear();
+	m_live.clear();
+	m_size = 0;
+}
+
+int esdbEntryTable::firstUnused(int first, int last) const
+{
+	int id = first;
+	while (id <= last) {
+		int word = id / 64;
+		if (word >= m_live.size()) {
+			return id;
+		}
+		quint64 free = ~m_live.at(word) & (~Q_UINT64_C(0) << (id % 64));
+		if (free) {
+			id = word * 64 + qCountTrailingZeroBits(free);
+			return id <= last ? id : -1;
+		}
+		id = (word + 1) * 64;
+	}
+	return -1;
+}
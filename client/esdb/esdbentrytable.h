@@ -0,0 +1,91 @@
+#ifndef ESDBENTRYTABLE_H
+#define ESDBENTRYTABLE_H
+
+#include <QVector>
+
+struct esdbEntry;
+
+//
+// Entries indexed directly by UID. A dense array of entry pointers plus a
+// bitmap of the live slots, so lookups are a single index and iteration
+// walks the bitmap a word at a time in UID order instead of chasing tree
+// nodes. UIDs are small (MIN_UID to MAX_UID) so the array stays compact.
+// The table does not own its entries.
+//
+class esdbEntryTable
+{
+	QVector<esdbEntry *> m_slots;
+	QVector<quint64> m_live;
+	int m_size;
+	int nextLive(int id) const;
+public:
+	esdbEntryTable();
+
+	class const_iterator
+	{
+		const esdbEntryTable *m_table;
+		int m_id;
+	public:
+		const_iterator(const esdbEntryTable *table, int id) :
+			m_table(table),
+			m_id(id)
+		{
+		}
+		esdbEntry *operator*() const
+		{
+			return m_table->m_slots.at(m_id);
+		}
+		int id() const
+		{
+			return m_id;
+		}
+		const_iterator &operator++()
+		{
+			m_id = m_table->nextLive(m_id + 1);
+			return *this;
+		}
+		bool operator==(const const_iterator &other) const
+		{
+			return m_id == other.m_id;
+		}
+		bool operator!=(const const_iterator &other) const
+		{
+			return m_id != other.m_id;
+		}
+	};
+
+	const_iterator begin() const
+	{
+		return const_iterator(this, nextLive(0));
+	}
+	const_iterator end() const
+	{
+		return const_iterator(this, -1);
+	}
+
+	int size() const
+	{
+		return m_size;
+	}
+	bool isEmpty() const
+	{
+		return !m_size;
+	}
+	bool contains(int id) const
+	{
+		return id >= 0 && id < m_slots.size() &&
+			(m_live.at(id / 64) & (Q_UINT64_C(1) << (id % 64)));
+	}
+	esdbEntry *value(int id) const
+	{
+		return contains(id) ? m_slots.at(id) : nullptr;
+	}
+	void insert(int id, esdbEntry *entry);
+	void remove(int id);
+	void clear();
+
+	//First UID in [first, last] with no entry, or -1 if they are all used
+	int firstUnused(int first, int last) const;
+};
+
+#endif // ESDBENTRYTABLE_H
@@ -44,28 +44,49 @@ QVector<QStringList::const_iterator> esdbTypeModule::aliasMatch(const QVector<QS
 }
 
 
-QVector<QString> esdbTypeModule::aliasMatchValues(const QVector<QStringList> &aliasedFields, const QVector<QStringList::const_iterator> &aliasMatched, const QVector<genericField> &fields, genericFields *genFields) const
+importColumnPlan esdbTypeModule::columnPlan(const QStringList &header, bool doAliasMatch) const
 {
-	QVector<QString> fieldValues;
-	fieldValues.resize(aliasMatched.size());
-	for (genericField f : fields) {
+	importColumnPlan plan;
+	QVector<QStringList> aliases = aliasedFields(doAliasMatch);
+	QVector<QStringList::const_iterator> aliasMatched = aliasMatch(aliases, header);
+
+	plan.header = header;
+	plan.targetColumns.fill(-1, aliases.size());
+	for (int j = 0; j < header.size(); j++) {
 		bool matched = false;
-		int i = 0;
-		for (QStringList::const_iterator iter : aliasMatched) {
-			if (iter == aliasedFields.at(i).cend()) {
-				i++;
+		for (int i = 0; i < aliases.size(); i++) {
+			QStringList::const_iterator iter = aliasMatched.at(i);
+			if (iter == aliases.at(i).cend()) {
 				continue;
 			}
-			const QString &aliasName = *iter;
-			if (!f.name.compare(aliasName, Qt::CaseInsensitive)) {
-				fieldValues[i] = f.value;
+			if (!header.at(j).compare(*iter, Qt::CaseInsensitive)) {
+				plan.targetColumns[i] = j;
 				matched = true;
 			}
-			i++;
 		}
-		if (!matched && genFields) {
-			genFields->addField(f);
+		if (!matched) {
+			plan.genericColumns.append(j);
+		}
+	}
+	return plan;
+}
+
+void esdbTypeModule::addGenericFields(const importColumnPlan &plan, const QStringList &row, genericFields *genFields) const
+{
+	for (int j : plan.genericColumns) {
+		if (j < row.size()) {
+			genFields->addField(genericField(plan.header.at(j), "", row.at(j)));
 		}
 	}
-	return fieldValues;
+}
+
+esdbEntry *esdbTypeModule::decodeEntry(const QVector<genericField> &fields, bool doAliasMatch) const
+{
+	QStringList header;
+	QStringList row;
+	for (const genericField &f : fields) {
+		header.append(f.name);
+		row.append(f.value);
+	}
+	return decodeEntry(columnPlan(header, doAliasMatch), row);
 }
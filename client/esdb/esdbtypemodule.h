@@ -5,6 +5,7 @@
 #include <QObject>
 #include <QString>
 #include <QList>
+#include <QStringList>
 #include <map>
 #include <QVector>
 
@@ -17,21 +18,49 @@ struct block;
 
 #include "genericfields.h"
 
+//
+// Mapping from the columns of a tabular import to entry fields. Built once
+// per header by esdbTypeModule::columnPlan() so rows decode by index.
+//
+struct importColumnPlan {
+	QStringList header;
+	QVector<int> targetColumns;
+	QVector<int> genericColumns;
+
+	QString value(const QStringList &row, int target) const
+	{
+		int col = targetColumns.at(target);
+		if (col >= 0 && col < row.size()) {
+			return row.at(col);
+		}
+		return QString();
+	}
+};
+
 struct esdbTypeModule {
 	QString m_name;
 protected:
 	QVector<QStringList::const_iterator> aliasMatch(const QVector<QStringList> &aliasedFields, const QStringList &fields) const;
-	QVector<QString> aliasMatchValues(const QVector<QStringList> &aliasedFields, const QVector<QStringList::const_iterator> &aliasMatched, const QVector<genericField> &fields, genericFields *genFields) const;
+	void addGenericFields(const importColumnPlan &plan, const QStringList &row, genericFields *genFields) const;
+	virtual QVector<QStringList> aliasedFields(bool doAliasMatch) const
+	{
+		Q_UNUSED(doAliasMatch);
+		return QVector<QStringList>();
+	}
 public:
 	virtual esdbEntry *decodeEntry(int id, int revision, esdbEntry *prev, struct block *blk) const = 0;
 
-	virtual esdbEntry *decodeEntry(const QVector<genericField> &fields, bool aliasMatch = true) const
+	virtual esdbEntry *decodeEntry(const importColumnPlan &plan, const QStringList &row) const
 	{
-		Q_UNUSED(fields);
-		Q_UNUSED(aliasMatch);
+		Q_UNUSED(plan);
+		Q_UNUSED(row);
 		return nullptr;
 	}
 
+	esdbEntry *decodeEntry(const QVector<genericField> &fields, bool aliasMatch = true) const;
+
+	importColumnPlan columnPlan(const QStringList &header, bool doAliasMatch = true) const;
+
 	esdbTypeModule(const QString &name);
 	esdbTypeModule();
 	virtual ~esdbTypeModule();
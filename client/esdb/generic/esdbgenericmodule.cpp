@@ -81,7 +81,7 @@ esdbEntry *esdbGenericModule::decodeEntry(int id, int revision, esdbEntry *prev,
 	return g;
 }
 
-esdbEntry *esdbGenericModule::decodeEntry(const QVector<genericField> &fields, bool doAliasMatch) const
+QVector<QStringList> esdbGenericModule::aliasedFields(bool doAliasMatch) const
 {
 	QVector<QStringList> aliasedFields;
 	QStringList nameAliases;
@@ -100,16 +100,15 @@ esdbEntry *esdbGenericModule::decodeEntry(const QVector<genericField> &fields, b
 		pathAliases.push_back("group");
 	}
 	aliasedFields.push_back(pathAliases);
+	return aliasedFields;
+}
 
-	QStringList fieldNames;
-	for (auto f : fields) {
-		fieldNames.append(f.name);
-	}
+esdbEntry *esdbGenericModule::decodeEntry(const importColumnPlan &plan, const QStringList &row) const
+{
 	generic *g = new generic(-1);
-	QVector<QStringList::const_iterator> aliasMatched = aliasMatch(aliasedFields, fieldNames);
-	QVector<QString> fieldValues = aliasMatchValues(aliasedFields, aliasMatched, fields, &g->fields);
-	g->name = fieldValues[0];
-	g->path = fieldValues[1];
+	g->name = plan.value(row, 0);
+	g->path = plan.value(row, 1);
 	g->typeId = m_typeDesc->typeId;
+	addGenericFields(plan, row, &g->fields);
 	return g;
 }
@@ -16,7 +16,8 @@ class esdbGenericModule : public esdbTypeModule
 	genericTypeDesc *m_typeDesc;
 private:
 	esdbEntry *decodeEntry(int id, int revision, esdbEntry *prev, struct block *blk) const override;
-	esdbEntry *decodeEntry(const QVector<genericField> &fields, bool doAliasMatch) const override;
+	esdbEntry *decodeEntry(const importColumnPlan &plan, const QStringList &row) const override;
+	QVector<QStringList> aliasedFields(bool doAliasMatch) const override;
 public:
 	esdbGenericModule(genericTypeDesc *typeDesc);
 	QString name() const override;
@@ -10,6 +10,14 @@ void generic_1::fromBlock(block *blk)
 	fields.fromBlock(blk);
 }
 
+void generic_1::toBlock(block *blk) const
+{
+	esdbEntry::toBlock(blk);
+	blk->writeString(this->typeName, false);
+	blk->writeString(this->name, false);
+	fields.toBlock(blk);
+}
+
 void generic_2::fromBlock(block *blk)
 {
     esdbEntry::fromBlock(blk);
@@ -18,6 +26,14 @@ void generic_2::fromBlock(block *blk)
 	fields.fromBlock(blk);
 }
 
+void generic_2::toBlock(block *blk) const
+{
+	esdbEntry::toBlock(blk);
+	blk->writeString(this->typeName, false);
+	blk->writeString(this->name, false);
+	fields.toBlock(blk);
+}
+
 void generic_3::fromBlock(block *blk)
 {
 	esdbEntry::fromBlock(blk);
@@ -26,6 +42,14 @@ void generic_3::fromBlock(block *blk)
 	fields.fromBlock(blk);
 }
 
+void generic_3::toBlock(block *blk) const
+{
+	esdbEntry::toBlock(blk);
+	blk->writeString(this->typeName, false);
+	blk->writeString(this->name, false);
+	fields.toBlock(blk);
+}
+
 void generic_4::fromBlock(block *blk)
 {
 	esdbEntry::fromBlock(blk);
@@ -34,12 +58,20 @@ void generic_4::fromBlock(block *blk)
 	fields.fromBlock(blk);
 }
 
+void generic_4::toBlock(block *blk) const
+{
+	esdbEntry::toBlock(blk);
+	blk->writeU16(this->typeId);
+	blk->writeString(this->name, false);
+	fields.toBlock(blk);
+}
+
 void generic::fromBlock(block *blk)
 {
 	esdbEntry::fromBlock(blk);
 	this->typeId = blk->readU16();
 	blk->readString(this->name);
-	blk->readString(this->path);
+	blk->readInternedString(this->path);
 	fields.fromBlock(blk);
 }
 
@@ -14,6 +14,8 @@ struct generic_1 : public esdbEntry {
 	genericFields_1 fields;
 
 	void fromBlock(block *blk);
+	//Only used to produce legacy entries for testing upgrades
+	void toBlock(block *blk) const;
 	generic_1(int id_) : esdbEntry(id_, ESDB_TYPE_GENERIC, 0, id_, 1) {}
 	~generic_1() {}
 
@@ -25,6 +27,8 @@ struct generic_2 : public esdbEntry {
 	genericFields_2 fields;
 
 	void fromBlock(block *blk);
+	//Only used to produce legacy entries for testing upgrades
+	void toBlock(block *blk) const;
 	generic_2(int id_) : esdbEntry(id_, ESDB_TYPE_GENERIC, 1, id_, 1) {}
 	~generic_2() {}
 	void upgrade(const generic_1 &g)
@@ -43,6 +47,8 @@ struct generic_3 : public esdbEntry {
 	generic_3(int id_) : esdbEntry(id_, ESDB_TYPE_GENERIC, 2, id_, 1) {}
 	~generic_3() {}
 	void fromBlock(block *blk);
+	//Only used to produce legacy entries for testing upgrades
+	void toBlock(block *blk) const;
 
 	void upgrade(const generic_2 &g)
 	{
@@ -60,6 +66,8 @@ struct generic_4 : public esdbEntry {
 	generic_4(int id_) : esdbEntry(id_, ESDB_TYPE_GENERIC, 3, id_, 1) { }
 	~generic_4() {}
 	void fromBlock(block *blk);
+	//Only used to produce legacy entries for testing upgrades
+	void toBlock(block *blk) const;
 
 	void upgrade(const generic_3 &g)
 	{
@@ -9,12 +9,20 @@ void genericFields_1::fromBlock(block *blk)
 	m_fields.clear();
 	for (int i = 0; i < numFields; i++) {
 		genericField fld;
-		blk->readString(fld.name);
+		blk->readInternedString(fld.name);
 		blk->readString(fld.value);
 		m_fields.push_back(fld);
     }
 }
 
+void genericFields_1::toBlock(block *blk) const
+{
+	blk->writeU8(m_fields.size());
+	for (const genericField &fld : m_fields) {
+		blk->writeString(fld.name, true);
+		blk->writeString(fld.value, true);
+	}
+}
 
 void genericFields_2::fromBlock(block *blk)
 {
@@ -23,24 +31,53 @@ void genericFields_2::fromBlock(block *blk)
 	m_fields.clear();
 	for (int i = 0; i < numFields; i++) {
 		genericField fld;
-		blk->readString(fld.name);
-		blk->readString(fld.type);
+		blk->readInternedString(fld.name);
+		blk->readInternedString(fld.type);
 		blk->readString(fld.value);
 		m_fields.push_back(fld);
 	}
 }
 
+void genericFields_2::toBlock(block *blk) const
+{
+	blk->writeU8(m_fields.size());
+	for (const genericField &fld : m_fields) {
+		blk->writeString(fld.name, true);
+		blk->writeString(fld.type, true);
+		blk->writeString(fld.value, true);
+	}
+}
+
 void genericFields::fromBlock(block *blk)
 {
 	if (!blk->dataRemaining()) {
 		return;
 	}
+	//Only walk the lengths here, the strings are decoded by decodeRaw()
+	int start = blk->index;
 	u8 numFields = blk->readU8();
+	for (int i = 0; i < numFields; i++) {
+		int nameSize = blk->readU8();
+		blk->index += nameSize;
+		int typeSize = blk->readU8();
+		blk->index += typeSize;
+		int valueSize = blk->readU16();
+		blk->index += valueSize;
+	}
+	m_raw = blk->data.mid(start, blk->index - start);
+	m_decoded = false;
 	m_fields.clear();
+}
+
+void genericFields::decodeRaw() const
+{
+	block blk;
+	blk.data = m_raw;
+	u8 numFields = blk.readU8();
 	for (int i = 0; i < numFields; i++) {
 		genericField fld;
-		blk->readString(fld.name);
-		blk->readString(fld.type);
+		blk.readString(fld.name);
+		blk.readString(fld.type);
 
 		if (fld.name.size() > 0 && fld.name.size() &&  fld.name[0] == '.') {
 			fld.name.remove(0,1);
@@ -48,13 +85,18 @@ void genericFields::fromBlock(block *blk)
 				fld.type.prepend(".");
 			}
 		}
-		blk->readLongString(fld.value);
+		esdbStringPool::intern(fld.name);
+		esdbStringPool::intern(fld.type);
+		blk.readLongString(fld.value);
 		m_fields.push_back(fld);
 	}
+	m_raw.clear();
+	m_decoded = true;
 }
 
 void genericFields::toBlock(block *blk) const
 {
+	decode();
 	u8 count = 0;
 	for (auto fld : m_fields) {
 		if (fld.value.size()) {
@@ -79,6 +121,7 @@ void genericFields::toBlock(block *blk) const
 
 const genericField *genericFields::getField(const QString &name) const
 {
+	decode();
 	for (const genericField &f : m_fields) {
 		if (f.name == name) {
 			return &f;
@@ -89,6 +132,7 @@ const genericField *genericFields::getField(const QString &name) const
 
 void genericFields::getFields(QVector<genericField> &fields) const
 {
+	decode();
 	for (auto x : m_fields) {
 		fields.push_back(x);
 	}
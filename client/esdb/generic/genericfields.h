@@ -15,6 +15,12 @@ class genericFields_1
 public:
 	genericFields_1() {}
 	void fromBlock(block *blk);
+	//Only used to produce legacy entries for testing upgrades
+	void toBlock(block *blk) const;
+	void addField(const genericField &f)
+	{
+		m_fields.push_back(f);
+	}
 };
 
 class genericFields_2
@@ -23,41 +29,69 @@ public:
 	genericFields_2() {}
 	QList<genericField> m_fields;
 	void fromBlock(block *blk);
+	//Only used to produce legacy entries for testing upgrades
+	void toBlock(block *blk) const;
 	void upgrade(const genericFields_1 &f)
 	{
 		m_fields = f.m_fields;
 	}
 };
 
+//
+// Fields are only needed once an entry is opened, edited, exported or its
+// fields are requested, so fromBlock() keeps the raw bytes and they are
+// decoded on first access. Decoding happens through const accessors too,
+// so an instance must not be shared between threads until it is decoded.
+//
 class genericFields
 {
+	mutable QList<genericField> m_fields;
+	mutable QByteArray m_raw;
+	mutable bool m_decoded;
+	void decode() const
+	{
+		if (!m_decoded) {
+			decodeRaw();
+		}
+	}
+	void decodeRaw() const;
 public:
-	genericFields() {}
-	QList<genericField> m_fields;
+	genericFields() : m_decoded(true) {}
 	void fromBlock(block *blk);
 	void clear()
 	{
+		m_raw.clear();
+		m_decoded = true;
 		m_fields.clear();
 	}
+	bool isDecoded() const
+	{
+		return m_decoded;
+	}
 	void toBlock(block *blk) const;
 	int fieldCount() const
 	{
+		decode();
 		return m_fields.count();
 	}
 	genericField getField(int i) const
 	{
+		decode();
 		return m_fields.at(i);
 	}
 	void replaceField(int i, const genericField &f)
 	{
+		decode();
 		m_fields.replace(i, f);
 	}
 	void removeField(int i)
 	{
+		decode();
 		m_fields.removeAt(i);
 	}
 	void addField(const genericField &f)
 	{
+		decode();
 		m_fields.push_back(f);
 	}
 
@@ -67,6 +101,7 @@ public:
 
 	void upgrade(const genericFields_2 &f)
 	{
+		clear();
 		m_fields = f.m_fields;
 	}
 };
@@ -3,15 +3,15 @@
 void genericTypeDesc_1::fromBlock(block *blk)
 {
 	esdbEntry::fromBlock(blk);
-	blk->readString(this->group);
+	blk->readInternedString(this->group);
 	blk->readString(this->name);
 	int count = blk->readU8();
 	fields.clear();
 	for (int i = 0; i < count; i++) {
 		QString fieldName;
 		QString fieldType;
-		blk->readString(fieldName);
-		blk->readString(fieldType);
+		blk->readInternedString(fieldName);
+		blk->readInternedString(fieldType);
 		fieldSpec fs(fieldName, fieldType);
 		fields.push_back(fs);
     }
@@ -28,7 +28,7 @@ void genericTypeDesc::upgrade(const genericTypeDesc_1 &prev)
 void genericTypeDesc::fromBlock(block *blk)
 {
 	esdbEntry::fromBlock(blk);
-	blk->readString(this->group);
+	blk->readInternedString(this->group);
 	blk->readString(this->name);
 	typeId = blk->readU16();
 	int count = blk->readU8();
@@ -36,8 +36,8 @@ void genericTypeDesc::fromBlock(block *blk)
 	for (int i = 0; i < count; i++) {
 		QString fieldName;
 		QString fieldType;
-		blk->readString(fieldName);
-		blk->readString(fieldType);
+		blk->readInternedString(fieldName);
+		blk->readInternedString(fieldType);
 		fieldSpec fs(fieldName, fieldType);
 		fields.push_back(fs);
 	}
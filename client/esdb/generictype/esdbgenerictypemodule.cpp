@@ -45,8 +45,9 @@ esdbEntry *esdbGenericTypeModule::decodeEntry(int id, int revision, esdbEntry *p
 	return entry;
 }
 
-esdbEntry *esdbGenericTypeModule::decodeEntry(const QVector<genericField> &fields, bool doAliasMatch) const
+QVector<QStringList> esdbGenericTypeModule::aliasedFields(bool doAliasMatch) const
 {
+	Q_UNUSED(doAliasMatch);
 	QVector<QStringList> aliasedFields;
 	QStringList nameAliases;
 	QStringList pathAliases;
@@ -54,20 +55,20 @@ esdbEntry *esdbGenericTypeModule::decodeEntry(const QVector<genericField> &field
 	pathAliases.push_back("path");
 	aliasedFields.push_back(nameAliases);
 	aliasedFields.push_back(pathAliases);
-	QStringList fieldNames;
-	for (auto f : fields) {
-		fieldNames.append(f.name);
-	}
+	return aliasedFields;
+}
+
+esdbEntry *esdbGenericTypeModule::decodeEntry(const importColumnPlan &plan, const QStringList &row) const
+{
 	genericFields genFields;
-	QVector<QStringList::const_iterator> aliasMatched = aliasMatch(aliasedFields, fieldNames);
-	QVector<QString> fieldValues = aliasMatchValues(aliasedFields, aliasMatched, fields, &genFields);
+	addGenericFields(plan, row, &genFields);
 	genericTypeDesc *desc = new genericTypeDesc(-1); //TODO: Get real ID assigned
 	for (int i = 0; i < genFields.fieldCount(); i++) {
 		auto f = genFields.getField(i);
 		desc->fields.append(fieldSpec(f.name, f.value));
 	}
 	desc->typeId = generic::invalidTypeId;
-	desc->name = fieldValues[0];
-	desc->group = fieldValues[1];
+	desc->name = plan.value(row, 0);
+	desc->group = plan.value(row, 1);
 	return desc;
 }
@@ -10,6 +10,8 @@ class esdbGenericTypeModule : public esdbTypeModule
 public:
 	explicit esdbGenericTypeModule();
 	esdbEntry *decodeEntry(int id, int revision, esdbEntry *prev, struct block *blk) const;
-	esdbEntry *decodeEntry(const QVector<genericField> &fields, bool aliasMatch = true) const;
+	esdbEntry *decodeEntry(const importColumnPlan &plan, const QStringList &row) const override;
+protected:
+	QVector<QStringList> aliasedFields(bool doAliasMatch) const override;
 };
 #endif // ESDBGENERICTYPEMODULE_H
@@ -3,11 +3,12 @@
 
 #include <QWidget>
 #include <QFileDialog>
+#include <QFile>
 #include <QFileInfo>
-#include <QBuffer>
+#include <QIODevice>
 #include <QSet>
 
-#include "qtcsv/reader.h"
+#include "csvstreamreader.h"
 #include "esdb.h"
 #include "esdbtypemodule.h"
 #include "csvimportconfigure.h"
@@ -33,12 +34,127 @@ void CSVImporter::failedToOpenCSVDialogFinished(int rc)
 	done(false);
 }
 
+//
+// Sequential device over the currently open member of a zip archive
+//
+class UnzipFileDevice : public QIODevice
+{
+	unzFile m_unzFile;
+public:
+	UnzipFileDevice(unzFile f) :
+		m_unzFile(f)
+	{
+	}
+
+	bool isSequential() const override
+	{
+		return true;
+	}
+
+	bool open(OpenMode mode) override
+	{
+		if (mode != QIODevice::ReadOnly || unzOpenCurrentFile(m_unzFile) != UNZ_OK) {
+			return false;
+		}
+		return QIODevice::open(mode);
+	}
+
+	void close() override
+	{
+		if (isOpen()) {
+			unzCloseCurrentFile(m_unzFile);
+		}
+		QIODevice::close();
+	}
+
+	~UnzipFileDevice()
+	{
+		close();
+	}
+protected:
+	qint64 readData(char *data, qint64 maxSize) override
+	{
+		int rc = unzReadCurrentFile(m_unzFile, data, (unsigned int)maxSize);
+		return rc < 0 ? -1 : rc;
+	}
+
+	qint64 writeData(const char *data, qint64 maxSize) override
+	{
+		Q_UNUSED(data);
+		Q_UNUSED(maxSize);
+		return -1;
+	}
+};
+
 struct csvData {
 	QString basename;
 	QString filename;
-	QList<QStringList> data;
+	QString path;
+	QByteArray zipMember;
 };
 
+//
+// Opens the file or zip archive member described by a csvData for
+// streaming
+//
+class csvSource {
+	unzFile m_unzFile;
+	QIODevice *m_device;
+public:
+	csvSource() :
+		m_unzFile(nullptr),
+		m_device(nullptr)
+	{
+	}
+
+	bool open(const csvData *d)
+	{
+		if (d->zipMember.size()) {
+			m_unzFile = unzOpen(d->path.toLatin1().data());
+			if (m_unzFile == nullptr) {
+				return false;
+			}
+			if (unzLocateFile(m_unzFile, d->zipMember.constData(), 1) != UNZ_OK) {
+				return false;
+			}
+			m_device = new UnzipFileDevice(m_unzFile);
+		} else {
+			m_device = new QFile(d->path);
+		}
+		return m_device->open(QIODevice::ReadOnly);
+	}
+
+	QIODevice *device()
+	{
+		return m_device;
+	}
+
+	~csvSource()
+	{
+		if (m_device) {
+			m_device->close();
+			delete m_device;
+		}
+		if (m_unzFile) {
+			unzClose(m_unzFile);
+		}
+	}
+};
+
+//
+// Returns true if the source has a header followed by at least one row
+//
+static bool csvHasEntries(const csvData *d)
+{
+	csvSource src;
+	if (!src.open(d)) {
+		return false;
+	}
+	CSVStreamReader reader(src.device());
+	QStringList row;
+	return reader.readRow(row) && reader.readRow(row);
+}
+
 void CSVImporter::start()
 {
 	QFileDialog fd(m_parent, "CSV Import");
@@ -66,14 +182,11 @@ void CSVImporter::start()
 	}
 
 	for (auto fn : sl) {
-		QFile *csvFile = new QFile(fn);
-		QFileInfo csvFileInfo(*csvFile);
+		QFileInfo csvFileInfo(fn);
 		QString csvBasename = csvFileInfo.baseName();
 		QString csvFilename = csvFileInfo.fileName();
 		QString csvSuffix = csvFileInfo.suffix();
 		if (csvSuffix == "zip") {
-			csvFile->deleteLater();
-			csvFile = nullptr;
 			unzFile unzFile = unzOpen(fn.toLatin1().data());
 			if (unzFile == nullptr) {
 				SignetApplication::messageBoxError(QMessageBox::Warning,
@@ -104,19 +217,15 @@ void CSVImporter::start()
 
 				if (!zipInnerFileInfo.suffix().compare("csv", Qt::CaseInsensitive) ||
 					!zipInnerFileInfo.suffix().compare("txt", Qt::CaseInsensitive)) {
-					unzOpenCurrentFile(unzFile);
-					QByteArray contents(finfo.uncompressed_size, 0);
-					unzReadCurrentFile(unzFile, contents.data(), finfo.uncompressed_size);
-					unzCloseCurrentFile(unzFile);
-
-					QtCSV::Reader reader;
-					QBuffer buffer(&contents);
 					csvData *d = new csvData();
 					d->basename = zipInnerFileInfo.baseName();
 					d->filename = csvFilename + ":" + zipInnerFileInfo.filePath();
-					d->data = reader.readToList(buffer);
-					if (d->data.length() >= 2) {
+					d->path = fn;
+					d->zipMember = QByteArray(filename.constData());
+					if (csvHasEntries(d)) {
 						csvDataList.push_back(d);
+					} else {
+						delete d;
 					}
 				}
 
@@ -135,9 +244,8 @@ void CSVImporter::start()
 			}
 			unzClose(unzFile);
 		} else {
-			QString csvBasename = csvFileInfo.baseName();
-			if (!csvFile->open(QFile::ReadOnly)) {
-				csvFile->deleteLater();
+			QFile csvFile(fn);
+			if (!csvFile.open(QFile::ReadOnly)) {
 				auto mb = SignetApplication::messageBoxError(QMessageBox::Warning,
 						"CSV Import",
 						"Failed to open CSV file",
@@ -145,14 +253,12 @@ void CSVImporter::start()
 				connect(mb, SIGNAL(finished(int)), this, SLOT(failedToOpenCSVDialogFinished(int)));
 				return;
 			}
-			QtCSV::Reader reader;
+			csvFile.close();
 			csvData *d = new csvData();
 			d->basename = csvBasename;
 			d->filename = csvFilename;
-			d->data = reader.readToList(*csvFile);
-			csvFile->deleteLater();
-			csvFile = nullptr;
-			if (d->data.length() < 2) {
+			d->path = fn;
+			if (!csvHasEntries(d)) {
 				SignetApplication::messageBoxError(QMessageBox::Warning,
 						"CSV Import",
 						"CSV file has no entries",
@@ -209,20 +315,27 @@ void CSVImporter::start()
 			dbType = new databaseType();
 			m_db->insert(name, dbType);
 		}
-		auto csvIter = csvData->data.begin();
-		auto header = *(csvIter++);
-
-		for (; csvIter != csvData->data.end(); csvIter++) {
-			QVector<genericField> fields;
-			QStringList row = *csvIter;
-			for (int j = 0; j < row.length() && j < header.length(); j++) {
-				fields.append(genericField(header.at(j),"", row.at(j)));
-			}
-			esdbEntry *ent = module->decodeEntry(fields);
+		csvSource src;
+		if (!src.open(csvData)) {
+			SignetApplication::messageBoxError(QMessageBox::Warning,
+					"CSV Import",
+					"Failed to read \"" + csvData->filename + "\"",
+					m_parent);
+			done(false);
+			return;
+		}
+		CSVStreamReader reader(src.device());
+		QStringList header;
+		QStringList row;
+		reader.readRow(header);
+		importColumnPlan plan = module->columnPlan(header);
+		while (reader.readRow(row)) {
+			esdbEntry *ent = module->decodeEntry(plan, row);
 			if (ent) {
 				dbType->append(ent);
 			}
 		}
 	}
+	qDeleteAll(csvDataList);
 	done(true);
 }
@@ -0,0 +1,147 @@
+#include "csvstreamreader.h"
+
+#include <QIODevice>
+#include <QString>
+
+#include <string.h>
+
+#ifdef USE_SSE
+#include <emmintrin.h>
+#endif
+
+CSVStreamReader::CSVStreamReader(QIODevice *device, char separator, char textDelimiter) :
+	m_device(device),
+	m_buffer(s_chunkSize, 0),
+	m_pos(0),
+	m_len(0),
+	m_eof(false),
+	m_started(false),
+	m_separator(separator),
+	m_textDelimiter(textDelimiter)
+{
+}
+
+bool CSVStreamReader::fill()
+{
+	if (m_eof) {
+		return false;
+	}
+	qint64 n = m_device->read(m_buffer.data(), s_chunkSize);
+	if (n <= 0) {
+		m_eof = true;
+		m_pos = 0;
+		m_len = 0;
+		return false;
+	}
+	m_pos = 0;
+	m_len = (int)n;
+	if (!m_started) {
+		m_started = true;
+		if (m_len >= 3 && !memcmp(m_buffer.constData(), "\xef\xbb\xbf", 3)) {
+			m_pos = 3;
+		}
+	}
+	return true;
+}
+
+//
+// Returns a pointer to the first separator, text delimiter or line
+// ending in [p, end) or end if there is none. Unquoted field contents
+// are skipped 16 bytes at a time when SSE is available.
+//
+const char *CSVStreamReader::scanSpecial(const char *p, const char *end) const
+{
+#ifdef USE_SSE
+	const __m128i sep = _mm_set1_epi8(m_separator);
+	const __m128i quote = _mm_set1_epi8(m_textDelimiter);
+	const __m128i lf = _mm_set1_epi8('\n');
+	const __m128i cr = _mm_set1_epi8('\r');
+	while ((end - p) >= 16) {
+		__m128i v = _mm_loadu_si128((const __m128i *)p);
+		__m128i m = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, sep), _mm_cmpeq_epi8(v, quote)),
+					 _mm_or_si128(_mm_cmpeq_epi8(v, lf), _mm_cmpeq_epi8(v, cr)));
+		int bits = _mm_movemask_epi8(m);
+		if (bits) {
+			return p + __builtin_ctz(bits);
+		}
+		p += 16;
+	}
+#endif
+	for (; p < end; p++) {
+		char c = *p;
+		if (c == m_separator || c == m_textDelimiter || c == '\n' || c == '\r') {
+			return p;
+		}
+	}
+	return end;
+}
+
+bool CSVStreamReader::readRow(QStringList &row)
+{
+	QByteArray field;
+	bool quoted = false;
+	bool rowStarted = false;
+	row.clear();
+
+	while (true) {
+		if (m_pos == m_len && !fill()) {
+			if (!rowStarted) {
+				return false;
+			}
+			row.append(QString::fromUtf8(field));
+			return true;
+		}
+		const char *begin = m_buffer.constData() + m_pos;
+		const char *end = m_buffer.constData() + m_len;
+
+		if (quoted) {
+			const char *p = (const char *)memchr(begin, m_textDelimiter, end - begin);
+			if (!p) {
+				field.append(begin, end - begin);
+				m_pos = m_len;
+				continue;
+			}
+			field.append(begin, p - begin);
+			m_pos += (p - begin) + 1;
+			if (m_pos == m_len && !fill()) {
+				quoted = false;
+				continue;
+			}
+			if (m_buffer.at(m_pos) == m_textDelimiter) {
+				field.append(m_textDelimiter);
+				m_pos++;
+			} else {
+				quoted = false;
+			}
+			continue;
+		}
+
+		const char *p = scanSpecial(begin, end);
+		if (p != begin) {
+			field.append(begin, p - begin);
+			rowStarted = true;
+		}
+		m_pos += p - begin;
+		if (p == end) {
+			continue;
+		}
+		m_pos++;
+		char c = *p;
+		if (c == m_separator) {
+			row.append(QString::fromUtf8(field));
+			field.clear();
+			rowStarted = true;
+		} else if (c == m_textDelimiter) {
+			quoted = true;
+			rowStarted = true;
+		} else {
+			//A lone '\r' ends a row as well. The '\n' of a "\r\n" pair
+			//then arrives before anything else and is skipped like an
+			//empty line.
+			if (rowStarted) {
+				row.append(QString::fromUtf8(field));
+				return true;
+			}
+		}
+	}
+}
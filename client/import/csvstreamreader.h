@@ -0,0 +1,36 @@
+#ifndef CSVSTREAMREADER_H
+#define CSVSTREAMREADER_H
+
+#include <QByteArray>
+#include <QStringList>
+
+class QIODevice;
+
+//
+// Incremental CSV reader. Pulls fixed size chunks from a device and
+// returns one row at a time so that arbitrarily large files can be
+// parsed in constant memory.
+//
+class CSVStreamReader
+{
+	QIODevice *m_device;
+	QByteArray m_buffer;
+	int m_pos;
+	int m_len;
+	bool m_eof;
+	bool m_started;
+	char m_separator;
+	char m_textDelimiter;
+	static const int s_chunkSize = 64 * 1024;
+	bool fill();
+	const char *scanSpecial(const char *p, const char *end) const;
+public:
+	CSVStreamReader(QIODevice *device, char separator = ',', char textDelimiter = '"');
+	bool readRow(QStringList &row);
+	bool atEnd() const
+	{
+		return m_eof && m_pos == m_len;
+	}
+};
+
+#endif // CSVSTREAMREADER_H
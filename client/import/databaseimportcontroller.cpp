@@ -16,6 +16,7 @@
 #include <QVBoxLayout>
 #include <QHBoxLayout>
 #include <QStackedWidget>
+#include <QtConcurrent>
 
 DatabaseImportController::DatabaseImportController(DatabaseImporter *importer, LoggedInWidget *parent, bool useUpdateUids) :
 	QObject(parent),
@@ -23,26 +24,44 @@ DatabaseImportController::DatabaseImportController(DatabaseImporter *importer, L
 	m_importer(importer),
 	m_overwriteAll(false),
 	m_skipAll(false),
-	m_updatePending(false),
 	m_useUpdateUids(useUpdateUids),
 	m_importProgressDialog(nullptr),
 	m_importProgressStack(nullptr),
+	m_overwriteAllButton(nullptr),
+	m_skipAllButton(nullptr),
+	m_importEntryCount(0),
+	m_conflictsResolved(0),
+	m_unchangedCount(0),
 	m_conflictResponse(CONFLICT_RESPONSE_NONE),
 	m_importCancel(false),
 	m_importState(IMPORT_STATE_NO_SOURCE),
-	m_typeIdMapBuilt(false)
+	m_typeIdMapBuilt(false),
+	m_importBlocksWatcher(nullptr),
+	m_overwriteCount(0),
+	m_overwritesSerialized(0),
+	m_writeOrderReady(false),
+	m_writeIndex(0),
+	m_writeCompleteCount(0),
+	m_writeSkipCount(0),
+	m_batchStarted(false)
 {
 	importer->setParent(this);
+	m_importBlocksWatcher = new QFutureWatcher<importBlock>(this);
+	connect(m_importBlocksWatcher, SIGNAL(resultReadyAt(int)), this, SLOT(importBlockReady(int)));
 	connect(m_importer, SIGNAL(done(bool)), this, SLOT(importDone(bool)));
-	SignetApplication *app = SignetApplication::get();
-	connect(app, SIGNAL(signetdevCmdResp(signetdevCmdRespInfo)),
-		this, SLOT(signetdevCmdResp(signetdevCmdRespInfo)));
 	connect(this, SIGNAL(entryCreated(QString,esdbEntry*)),
 		parent, SLOT(entryCreated(QString,esdbEntry*)));
 	connect(this, SIGNAL(entryChanged(int)),
 		parent, SLOT(entryChanged(int)));
 }
 
+DatabaseImportController::~DatabaseImportController()
+{
+	//The serialization job reads m_importEntries on worker threads
+	m_importBlocks.cancel();
+	m_importBlocks.waitForFinished();
+}
+
 void DatabaseImportController::conflictResponse()
 {
 	m_importProgressStack->setCurrentIndex(0);
@@ -70,9 +89,6 @@ void DatabaseImportController::advanceDbTypeIter()
 		}
 		break;
 	}
-	case IMPORT_STATE_WRITING: {
-		m_importIndex++;
-	} break;
 	default:
 		break;
 	}
@@ -103,17 +119,20 @@ void DatabaseImportController::importFinished(int code)
 	switch(m_importState) {
 	case IMPORT_STATE_CONFLICT_RESOLUTION:
 		m_importState = IMPORT_STATE_CONFLICT_RESOLUTION_CANCEL;
-		done(true);
 		break;
 	case IMPORT_STATE_WRITING:
 		m_importState = IMPORT_STATE_WRITE_CANCEL;
-		done(true);
 		break;
 	default:
 		break;
 	}
 	m_importProgressDialog->deleteLater();
 	m_importProgressDialog = nullptr;
+	m_importBlocks.cancel();
+	m_importBlocks.waitForFinished();
+	//Closing the dialog ends the import however it went, the main window
+	//holds off other entry writes until then
+	done(true);
 }
 
 void DatabaseImportController::importCancel()
@@ -121,60 +140,181 @@ void DatabaseImportController::importCancel()
 	m_importCancel = true;
 }
 
-bool DatabaseImportController::nextEntry()
+DatabaseImportController::importBlock DatabaseImportController::serializeEntry(esdbEntry *entry)
 {
-	if (m_importState == IMPORT_STATE_WRITING) {
-		m_importProgressStack->setCurrentIndex(0);
-		if (m_importIndex == m_importEntries.size() || m_importCancel) {
-			if (m_importCancel) {
-				m_importState = IMPORT_STATE_WRITE_CANCEL;
-			} else {
-				m_importState = IMPORT_STATE_WRITE_COMPLETE;
-				m_importProgressStack->setCurrentIndex(3);
-				return true;
+	importBlock b;
+	entry->toBlock(&b.blk);
+	b.digest = b.blk.contentHash();
+	return b;
+}
+
+void DatabaseImportController::beginWriting()
+{
+	//Overwrites are serialized first so the unchanged ones are known before
+	//the first update tells the device how many more updates follow
+	QList<esdbEntry *> entries;
+	QList<QString> typenames;
+	QList<bool> overwrite;
+	for (int pass = 0; pass < 2; pass++) {
+		for (int i = 0; i < m_importEntries.size(); i++) {
+			if (m_importOverwrite.at(i) == (pass == 0)) {
+				entries.append(m_importEntries.at(i));
+				typenames.append(m_importTypenames.at(i));
+				overwrite.append(m_importOverwrite.at(i));
 			}
-			done(true);
+		}
+		if (pass == 0) {
+			m_overwriteCount = entries.size();
+		}
+	}
+	m_importEntries = entries;
+	m_importTypenames = typenames;
+	m_importOverwrite = overwrite;
+
+	m_importState = IMPORT_STATE_WRITING;
+	m_writeOrder.clear();
+	m_writeOrderReady = false;
+	m_overwritesSerialized = 0;
+	m_writeIndex = 0;
+	m_writeCompleteCount = 0;
+	m_writeSkipCount = 0;
+	m_batchStarted = false;
+	m_importBlocks = QtConcurrent::mapped(m_importEntries, serializeEntry);
+	m_importBlocksWatcher->setFuture(m_importBlocks);
+	m_importProgressBar->setMinimum(0);
+	m_importProgressBar->setMaximum(0);
+	m_importProgressLabel->setText("Preparing entries...");
+	if (buildWriteOrder()) {
+		issueWrites();
+	}
+}
+
+//
+// Overwriting an entry with identical contents costs a flash write and
+// nothing else so such entries are left out of the write order. Only the
+// digests of the overwrites are needed, so this waits for those alone.
+//
+bool DatabaseImportController::buildWriteOrder()
+{
+	while (m_overwritesSerialized < m_overwriteCount &&
+	       m_importBlocks.isResultReadyAt(m_overwritesSerialized)) {
+		m_overwritesSerialized++;
+	}
+	if (m_overwritesSerialized < m_overwriteCount) {
+		return false;
+	}
+	m_unchangedCount = 0;
+	for (int i = 0; i < m_importEntries.size(); i++) {
+		if (i < m_overwriteCount &&
+		    m_loggedInWidget->entryUnchanged(m_importEntries.at(i)->id, m_importBlocks.resultAt(i).digest)) {
+			delete m_importEntries.at(i);
+			m_importEntries[i] = nullptr;
+			m_unchangedCount++;
+			continue;
+		}
+		m_writeOrder.append(i);
+	}
+	m_writeOrderReady = true;
+	m_importProgressBar->setMaximum(m_writeOrder.size());
+	updateWriteProgress();
+	return true;
+}
+
+void DatabaseImportController::updateWriteProgress()
+{
+	m_importProgressLabel->setText("Imported " + QString::number(m_writeCompleteCount) + " of " + QString::number(m_writeOrder.size()) + " entries");
+	m_importProgressBar->setValue(m_writeCompleteCount);
+}
+
+void DatabaseImportController::importBlockReady(int index)
+{
+	if (m_importState != IMPORT_STATE_WRITING) {
+		return;
+	}
+	if (!m_writeOrderReady) {
+		if (buildWriteOrder()) {
+			issueWrites();
+		}
+	} else if (m_writeIndex < m_writeOrder.size() && index == m_writeOrder.at(m_writeIndex)) {
+		issueWrites();
+	}
+}
+
+void DatabaseImportController::issueWrites()
+{
+	if (m_writeCompleteCount + m_writeSkipCount == m_writeOrder.size()) {
+		m_importState = IMPORT_STATE_WRITE_COMPLETE;
+		QString summary = m_importer->databaseTypeName() + " import complete\n\n" +
+				  QString::number(m_writeCompleteCount) + " entries written";
+		if (m_writeSkipCount) {
+			summary += ", " + QString::number(m_writeSkipCount) + " entries skipped";
+		}
+		if (m_unchangedCount) {
+			summary += ", " + QString::number(m_unchangedCount) + " unchanged entries skipped";
+		}
+		m_importCompleteLabel->setText(summary);
+		m_importProgressStack->setCurrentIndex(3);
+		return;
+	}
+	if (m_importCancel) {
+		if (m_pendingWrites.isEmpty()) {
+			m_importBlocks.cancel();
+			m_importBlocks.waitForFinished();
+			m_importState = IMPORT_STATE_WRITE_CANCEL;
 			m_importProgressDialog->done(QDialog::Accepted);
-			return true;
 		}
-		m_entry = m_importEntries[m_importIndex];
-		m_typeName = m_importTypenames[m_importIndex];
-		QString fullTitle = m_entry->getFullTitle();
-		if (m_useUpdateUids) {
-			if (m_importIndex == 0) {
+		return;
+	}
+
+	//The first update of a batch may wait for a button press so it is sent
+	//alone. Devices without update_uids need a button press for every entry.
+	int window = 1;
+	if (m_batchStarted) {
+		window = s_writeWindow;
+	}
+
+	//Writes wait for their entry to be serialized, importBlockReady() picks
+	//them up again when it is
+	while (m_writeIndex < m_writeOrder.size() && m_pendingWrites.size() < window &&
+	       m_importBlocks.isResultReadyAt(m_writeOrder.at(m_writeIndex))) {
+		if (m_pendingWrites.isEmpty()) {
+			if (!m_batchStarted) {
+				m_buttonWaitWidget->resetTimeout();
 				m_importProgressStack->setCurrentIndex(2);
+			} else {
+				m_importProgressStack->setCurrentIndex(0);
 			}
-		} else {
-			m_importProgressStack->setCurrentIndex(2);
 		}
-
-		m_importProgressBar->setMinimum(0);
-		m_importProgressBar->setMaximum(m_importEntries.size());
-		m_importProgressLabel->setText("Imported " + QString::number(m_importIndex) + " of " + QString::number(m_importEntries.size()) + " entries");
-		m_importProgressBar->setValue(m_importIndex);
-
-		block blk;
-		m_entry->toBlock(&blk);
+		int index = m_writeOrder.at(m_writeIndex);
+		esdbEntry *entry = m_importEntries[index];
+		block blk = m_importBlocks.resultAt(index).blk;
+		int token;
 		if (m_useUpdateUids) {
-			::signetdev_update_uids(nullptr, &m_signetdevCmdToken,
-						m_entry->id,
+			::signetdev_update_uids(nullptr, &token,
+						entry->id,
 						blk.data.size(),
 						(const u8 *)blk.data.data(),
-						(const u8 *)blk.mask.data(), m_importEntries.size() - m_importIndex - 1);
+						(const u8 *)blk.mask.data(), m_writeOrder.size() - m_writeIndex - 1);
+			SignetApplication::routeResponses(token, this);
 		} else {
-			::signetdev_update_uid(nullptr, &m_signetdevCmdToken,
-					       m_entry->id,
+			::signetdev_update_uid(nullptr, &token,
+					       entry->id,
 					       blk.data.size(),
 					       (const u8 *)blk.data.data(),
 					       (const u8 *)blk.mask.data());
+			SignetApplication::routeResponses(token, this);
 		}
-		m_updatePending = true;
-		return true;
-	} else if (m_importState == IMPORT_STATE_CONFLICT_RESOLUTION) {
+		m_pendingWrites.insert(token, index);
+		m_writeIndex++;
+	}
+}
+
+bool DatabaseImportController::nextEntry()
+{
+	if (m_importState == IMPORT_STATE_CONFLICT_RESOLUTION) {
 		if (iteratorsAtEnd()) {
-			m_importState = IMPORT_STATE_WRITING;
-			m_importIndex = -1; //Will be incremented to 0 by advance function
-			return false;
+			beginWriting();
+			return true;
 		}
 		QString typeName = m_dbIter.key();
 		if (typeName != "Data types" && m_typeIdMapBuilt == false) {
@@ -196,13 +336,14 @@ bool DatabaseImportController::nextEntry()
 		}
 		m_importProgressStack->setCurrentIndex(1);
 		esdbEntry *importEntry = *m_dbTypeIter;
-		const esdbEntry *existingEntry = m_loggedInWidget->findEntry(typeName, importEntry->getFullTitle());
+		const esdbEntry *existingEntry = m_conflicts.value(importEntry);
 
 		bool overwrite = false;
 
 		if (existingEntry && m_overwriteAll) {
 			overwrite = true;
 		} else if (existingEntry && m_skipAll) {
+			m_conflictsResolved++;
 			return false;
 		} else if (existingEntry) {
 			QString fullTitle = importEntry->getFullTitle();
@@ -217,6 +358,9 @@ bool DatabaseImportController::nextEntry()
 						progressString() +
 						" already exists";
 				m_importConflictLabel->setText(conflictText);
+				QString remaining = QString::number(m_conflicts.size() - m_conflictsResolved);
+				m_overwriteAllButton->setText("Overwrite All (" + remaining + ")");
+				m_skipAllButton->setText("Skip All (" + remaining + ")");
 				m_importProgressStack->setCurrentIndex(1);
 				return true;
 			} else {
@@ -225,7 +369,6 @@ bool DatabaseImportController::nextEntry()
 				}
 				if (m_conflictResponse == CONFLICT_RESPONSE_CANCEL) {
 					m_importState = IMPORT_STATE_CONFLICT_RESOLUTION_CANCEL;
-					done(true);
 					m_importProgressDialog->done(QDialog::Accepted);
 					return true;
 				}
@@ -239,18 +382,29 @@ bool DatabaseImportController::nextEntry()
 					if (d->isOkayPressed()) {
 						importEntry->setTitle(d->newName());
 						d->deleteLater();
+						const esdbEntry *renamedConflict = m_loggedInWidget->findEntry(typeName, importEntry->getFullTitle());
+						if (renamedConflict) {
+							m_conflicts.insert(importEntry, renamedConflict);
+						} else {
+							m_conflicts.remove(importEntry);
+						}
 						return nextEntry();
 					} else {
 						d->deleteLater();
+						m_conflictsResolved++;
 						return false;
 					}
 				} else {
+					m_conflictsResolved++;
 					return false;
 				}
 			}
 		}
 		if (overwrite) {
+			m_conflictsResolved++;
 			importEntry->id = existingEntry->id;
+			importEntry->uid = existingEntry->uid;
+			importEntry->version = existingEntry->version;
 		} else {
 			importEntry->id = m_loggedInWidget->getUnusedId(m_reservedIds);
 			m_reservedIds.insert(importEntry->id);
@@ -313,19 +467,45 @@ bool DatabaseImportController::nextEntry()
 
 void DatabaseImportController::buttonCanceled()
 {
-	m_importProgressStack->setCurrentIndex(0);
 	::signetdev_cancel_button_wait();
+	//The device reports the cancel for the waiting entry and
+	//signetdevCmdResp() skips it
+	if (m_importState == IMPORT_STATE_WRITING) {
+		return;
+	}
+	m_importProgressStack->setCurrentIndex(0);
 	m_importState = IMPORT_STATE_WRITE_CANCEL;
 	m_importProgressDialog->done(QDialog::Rejected);
 }
 
 void DatabaseImportController::buttonTimeout()
 {
+	//The device reports the timeout for the waiting entry and
+	//signetdevCmdResp() skips it
+	if (m_importState == IMPORT_STATE_WRITING) {
+		return;
+	}
 	m_importProgressStack->setCurrentIndex(0);
 	m_importState = IMPORT_STATE_WRITE_CANCEL;
 	m_importProgressDialog->done(QDialog::Rejected);
 }
 
+void DatabaseImportController::detectConflicts()
+{
+	m_importEntryCount = 0;
+	m_conflicts.clear();
+	m_conflictsResolved = 0;
+	for (auto iter = m_db->begin(); iter != m_db->end(); iter++) {
+		for (auto entry : *iter.value()) {
+			m_importEntryCount++;
+			const esdbEntry *existingEntry = m_loggedInWidget->findEntry(iter.key(), entry->getFullTitle());
+			if (existingEntry) {
+				m_conflicts.insert(entry, existingEntry);
+			}
+		}
+	}
+}
+
 void DatabaseImportController::importDone(bool success)
 {
 	if (success) {
@@ -371,14 +551,20 @@ void DatabaseImportController::importDone(bool success)
 		vbox = new QVBoxLayout();
 		vbox->setAlignment(Qt::AlignTop);
 		conflictWidget->setLayout(vbox);
+		detectConflicts();
+		m_importSummaryLabel = new genericText(QString::number(m_conflicts.size()) + " of " +
+						       QString::number(m_importEntryCount) +
+						       " imported entries already exist");
+		m_importSummaryLabel->setSizePolicy(QSizePolicy::Preferred, QSizePolicy::Fixed);
+		vbox->addWidget(m_importSummaryLabel);
 		m_importConflictLabel->setSizePolicy(QSizePolicy::Preferred, QSizePolicy::Expanding);
 		vbox->addWidget(m_importConflictLabel);
 		QHBoxLayout *hbox = new QHBoxLayout();
 		hbox->setAlignment(Qt::AlignLeft);
 		QPushButton *cancelButton = new QPushButton("Cancel");
-		QPushButton *overwriteAllButton = new QPushButton("Overwrite All");
+		m_overwriteAllButton = new QPushButton("Overwrite All");
 		QPushButton *overwriteButton = new QPushButton("Overwrite");
-		QPushButton *skipAllButton = new QPushButton("Skip All");
+		m_skipAllButton = new QPushButton("Skip All");
 		QPushButton *skipButton = new QPushButton("Skip");
 		QPushButton *renameButton = new QPushButton("Rename");
 
@@ -386,17 +572,17 @@ void DatabaseImportController::importDone(bool success)
 		hbox->addWidget(cancelButton);
 		connect(cancelButton, SIGNAL(pressed()), this, SLOT(cancelConflictResponse()));
 
-		overwriteAllButton->setSizePolicy(QSizePolicy::Fixed, QSizePolicy::Fixed);
-		hbox->addWidget(overwriteAllButton);
-		connect(overwriteAllButton, SIGNAL(pressed()), this, SLOT(overwriteAllConflictResponse()));
+		m_overwriteAllButton->setSizePolicy(QSizePolicy::Fixed, QSizePolicy::Fixed);
+		hbox->addWidget(m_overwriteAllButton);
+		connect(m_overwriteAllButton, SIGNAL(pressed()), this, SLOT(overwriteAllConflictResponse()));
 
 		overwriteButton->setSizePolicy(QSizePolicy::Fixed, QSizePolicy::Fixed);
 		hbox->addWidget(overwriteButton);
 		connect(overwriteButton, SIGNAL(pressed()), this, SLOT(overwriteConflictResponse()));
 
-		skipAllButton->setSizePolicy(QSizePolicy::Fixed, QSizePolicy::Fixed);
-		hbox->addWidget(skipAllButton);
-		connect(skipAllButton, SIGNAL(pressed()), this, SLOT(skipAllConflictResponse()));
+		m_skipAllButton->setSizePolicy(QSizePolicy::Fixed, QSizePolicy::Fixed);
+		hbox->addWidget(m_skipAllButton);
+		connect(m_skipAllButton, SIGNAL(pressed()), this, SLOT(skipAllConflictResponse()));
 
 		skipButton->setSizePolicy(QSizePolicy::Fixed, QSizePolicy::Fixed);
 		hbox->addWidget(skipButton);
@@ -417,7 +603,8 @@ void DatabaseImportController::importDone(bool success)
 		QWidget *importCompleteWidget = new QWidget();
 		vbox = new QVBoxLayout();
 		vbox->setAlignment(Qt::AlignTop);
-		vbox->addWidget(new genericText(m_importer->databaseTypeName() + " import complete"));
+		m_importCompleteLabel = new genericText(m_importer->databaseTypeName() + " import complete");
+		vbox->addWidget(m_importCompleteLabel);
 		QPushButton *ok = new QPushButton("Ok");
 		connect(ok, SIGNAL(pressed()), m_importProgressDialog, SLOT(accept()));
 		vbox->addWidget(ok);
@@ -451,42 +638,48 @@ void DatabaseImportController::signetdevCmdResp(signetdevCmdRespInfo info)
 {
 	int code = info.resp_code;
 
-	if (m_signetdevCmdToken != info.token) {
+	auto iter = m_pendingWrites.find(info.token);
+	if (iter == m_pendingWrites.end()) {
 		return;
 	}
-	m_signetdevCmdToken = -1;
-	m_updatePending = false;
-
-	m_importProgressStack->setCurrentIndex(0);
-
-	bool overwrite = m_importOverwrite[m_importIndex];
-
-	advanceDbTypeIter();
+	int index = iter.value();
+	m_pendingWrites.erase(iter);
 
 	switch (code) {
 	case OKAY: {
-		switch (info.cmd) {
-		case SIGNETDEV_CMD_UPDATE_UIDS:
-		case SIGNETDEV_CMD_UPDATE_UID:
-			if (!overwrite) {
-				entryCreated(m_typeName, m_entry);
-			} else {
-				entryChanged(m_entry->id);
-			}
-			while (!nextEntry()) advanceDbTypeIter();
-			break;
+		m_batchStarted = m_useUpdateUids;
+		esdbEntry *entry = m_importEntries[index];
+		if (!m_importOverwrite[index]) {
+			entryCreated(m_importTypenames[index], entry);
+		} else {
+			entryChanged(entry->id);
 		}
+		m_loggedInWidget->setEntryDigest(entry->id, m_importBlocks.resultAt(index).digest);
+		m_writeCompleteCount++;
 	}
 	break;
 	case BUTTON_PRESS_TIMEOUT:
 	case BUTTON_PRESS_CANCELED:
+		//A missed press only skips this entry. With update_uids the device
+		//didn't start the batch, so the next entry begins a new one and
+		//waits for its own press.
+		m_batchStarted = false;
+		m_writeSkipCount++;
+		break;
 	case SIGNET_ERROR_DISCONNECT:
 	case SIGNET_ERROR_QUIT:
-		while (!nextEntry()) advanceDbTypeIter();
+		m_importCancel = true;
 		break;
-	default: {
+	default:
+		m_importCancel = true;
+		m_importBlocks.cancel();
+		m_importBlocks.waitForFinished();
 		abort();
+		return;
 	}
-	break;
+
+	if (m_importState == IMPORT_STATE_WRITING) {
+		updateWriteProgress();
+		issueWrites();
 	}
 }
@@ -3,8 +3,13 @@
 
 #include <QObject>
 #include <QSet>
+#include <QMap>
+#include <QHash>
+#include <QFuture>
+#include <QFutureWatcher>
 
 #include "databaseimporter.h"
+#include "esdb.h"
 #include "signetapplication.h"
 
 class LoggedInWidget;
@@ -12,6 +17,7 @@ class ButtonWaitWidget;
 class esdbGenericModule;
 class QDialog;
 class QProgressBar;
+class QPushButton;
 class QStackedWidget;
 
 class DatabaseImportController : public QObject
@@ -29,8 +35,6 @@ class DatabaseImportController : public QObject
 	void advanceDbTypeIter();
 	bool nextEntry();
 	QString progressString();
-	int m_signetdevCmdToken;
-	bool m_updatePending;
 	bool iteratorsAtEnd();
 	bool m_useUpdateUids;
 
@@ -39,6 +43,17 @@ class DatabaseImportController : public QObject
 	QProgressBar *m_importProgressBar;
 	QLabel *m_importProgressLabel;
 	QLabel *m_importConflictLabel;
+	QLabel *m_importSummaryLabel;
+	QLabel *m_importCompleteLabel;
+	QPushButton *m_overwriteAllButton;
+	QPushButton *m_skipAllButton;
+	int m_importEntryCount;
+	//Imported entries that collide with an existing entry, found before
+	//resolution starts. Resolution walks this instead of searching again.
+	QHash<const esdbEntry *, const esdbEntry *> m_conflicts;
+	int m_conflictsResolved;
+	int m_unchangedCount;
+	void detectConflicts();
 
 	enum conflictResponse {
 		CONFLICT_RESPONSE_NONE,
@@ -54,8 +69,6 @@ class DatabaseImportController : public QObject
 	bool m_importCancel;
 	QSet<int> m_reservedIds;
 	QSet<int> m_reservedTypeIds;
-	esdbEntry *m_entry;
-	QString m_typeName;
 public:
 	enum importState {
 		IMPORT_STATE_NO_SOURCE,
@@ -71,13 +84,41 @@ public:
 	}
 private:
 	enum importState m_importState;
-	int m_importIndex;
 	QList <esdbEntry *> m_importEntries;
 	QList <QString> m_importTypenames;
 	QList <bool> m_importOverwrite;
 	QMap <QString, int> m_typeIdMap;
 	bool m_typeIdMapBuilt;
+
+	//Entries are serialized and hashed ahead of time on a worker thread and
+	//up to s_writeWindow updates are kept outstanding with the device
+	static const int s_writeWindow = 4;
+	struct importBlock {
+		block blk;
+		QByteArray digest;
+	};
+	static importBlock serializeEntry(esdbEntry *entry);
+	QFuture<importBlock> m_importBlocks;
+	QFutureWatcher<importBlock> *m_importBlocksWatcher;
+	QMap<int, int> m_pendingWrites;
+	//Overwrites come first in m_importEntries. m_writeOrder holds the
+	//indexes left to write once the unchanged overwrites are dropped.
+	int m_overwriteCount;
+	int m_overwritesSerialized;
+	QList<int> m_writeOrder;
+	bool m_writeOrderReady;
+	bool buildWriteOrder();
+	int m_writeIndex;
+	int m_writeCompleteCount;
+	int m_writeSkipCount;
+	//Set once the device accepts the first update of an update_uids batch.
+	//Until then updates are sent one at a time, each waiting on a press.
+	bool m_batchStarted;
+	void beginWriting();
+	void issueWrites();
+	void updateWriteProgress();
 private slots:
+	void importBlockReady(int index);
 	void buttonTimeout();
 	void buttonCanceled();
 	void importFinished(int);
@@ -109,6 +150,7 @@ private slots:
 	void importCancel();
 public:
 	explicit DatabaseImportController(DatabaseImporter *importer, LoggedInWidget *parent, bool useUpdateUids);
+	~DatabaseImportController();
 	DatabaseImporter *importer()
 	{
 		return m_importer;
@@ -1,60 +1,38 @@
 #include "keepassimporter.h"
-#include "core/Database.h"
-#include "core/Entry.h"
-#include "core/Group.h"
+#include "keepassreaderthread.h"
 #include "keepassunlockdialog.h"
-#include "account.h"
 #include "signetapplication.h"
+#include "generictext.h"
 
 #include <QFileDialog>
 #include <QStringList>
 #include <QFile>
+#include <QDialog>
+#include <QLabel>
+#include <QProgressBar>
+#include <QPushButton>
+#include <QVBoxLayout>
 
 KeePassImporter::KeePassImporter(QWidget *parent) :
 	DatabaseImporter(parent),
-	m_parent(parent)
+	m_parent(parent),
+	m_reader(nullptr),
+	m_accountType(nullptr),
+	m_unlocked(false),
+	m_canceled(false),
+	m_finished(false),
+	m_progressDialog(nullptr),
+	m_progressLabel(nullptr),
+	m_progressBar(nullptr)
 {
 }
 
-void KeePassImporter::traverse(QString path, Group *g)
-{
-	const QList<Entry *> &el = g->entries();
-	QList<Entry *>::const_iterator eiter;
-	for (eiter = el.constBegin(); eiter != el.constEnd(); eiter++) {
-		Entry *e = (*eiter);
-		account *a = new account(-1);
-		a->acctName = e->title();
-		a->userName = e->username();
-		if (isEmail(a->userName)) {
-			a->email = a->userName;
-		}
-		a->url = e->url();
-		a->password = e->password();
-		if (e->notes().size()) {
-			a->fields.addField(genericField("notes", "text block", e->notes()));
-		}
-		a->setPath(path);
-		m_accountType->append(a);
-	}
-	const QList<Group*> &gl = g->children();
-	for (auto giter = gl.constBegin(); giter != gl.constEnd(); giter++) {
-		if (path.size()) {
-			QString pathNext = path;
-			pathNext.append('/').append((*giter)->name().replace("/", "//"));
-			traverse(pathNext,  (*giter));
-		} else {
-			QString pathNext = path;
-			pathNext.append((*giter)->name().replace("/", "//"));
-			traverse(pathNext,  (*giter));
-		}
-	}
-}
-
 void KeePassImporter::failedToOpenDatabaseDialogFinished(int rc)
 {
 	Q_UNUSED(rc);
 	done(false);
 }
+
 void KeePassImporter::start()
 {
 	QFileDialog *fd = new QFileDialog(m_parent, databaseTypeName() + " Import");
@@ -75,52 +53,112 @@ void KeePassImporter::start()
 	}
 	fd->deleteLater();
 
-	QFile *keePassFile = new QFile(sl.first());
-	if (!keePassFile->open(QFile::ReadOnly)) {
-		keePassFile->deleteLater();
+	QFile keePassFile(sl.first());
+	if (!keePassFile.open(QFile::ReadOnly)) {
 		auto mb = SignetApplication::messageBoxError(QMessageBox::Warning,
 		                databaseTypeName()+ " Import",
 		                "Failed to open KeePass database file",
 		                m_parent);
-		connect(mb, SIGNAL(finished(int)), this, SIGNAL(failedToOpenDatabaseDialogFinished(int)));
+		connect(mb, SIGNAL(finished(int)), this, SLOT(failedToOpenDatabaseDialogFinished(int)));
 		return;
 	}
 
-	KeePassUnlockDialog *unlockDialog = new KeePassUnlockDialog(keePassFile, m_parent);
+	m_db = new database();
+	m_accountType = new databaseType();
+	m_db->insert("Accounts", m_accountType);
+
+	//The reader's signals are connected here before the unlock dialog
+	//starts it so that no batch can arrive unobserved
+	m_reader = new KeePassReaderThread(this);
+	m_reader->setFileData(keePassFile.readAll());
+	keePassFile.close();
+	connect(m_reader, SIGNAL(opened(bool)), this, SLOT(readerOpened(bool)));
+	connect(m_reader, SIGNAL(entriesRead(DatabaseImporter::databaseType, int, int)),
+		this, SLOT(readerEntriesRead(DatabaseImporter::databaseType, int, int)));
+	connect(m_reader, SIGNAL(finished()), this, SLOT(readerFinished()));
+
+	KeePassUnlockDialog *unlockDialog = new KeePassUnlockDialog(m_reader, m_parent);
 	unlockDialog->setWindowTitle(databaseTypeName()+ " Import");
 	unlockDialog->setWindowModality(Qt::WindowModal);
 	unlockDialog->exec();
-	m_keePassDatabase = unlockDialog->database();
 	unlockDialog->deleteLater();
-	if (!m_keePassDatabase) {
-		keePassFile->deleteLater();
-		done(false);
+
+	if (!m_unlocked) {
+		m_canceled = true;
+		if (m_reader->isRunning()) {
+			m_reader->requestInterruption();
+		} else {
+			finishImport();
+		}
 		return;
 	}
-	keePassFile->deleteLater();
-	if (!m_keePassDatabase) {
-		QMessageBox *msg = new QMessageBox(QMessageBox::Warning,
-		                                   databaseTypeName()+ " Import",
-		                                   "Invalid credentials for KeePass database",
-		                                   QMessageBox::NoButton, m_parent);
-		connect(msg, SIGNAL(finished(int)), this, SLOT(invalidCredientialsDialogFinished(int)));
-		msg->setWindowModality(Qt::WindowModal);
-		msg->setAttribute(Qt::WA_DeleteOnClose);
-		msg->show();
-	} else {
-		m_db = new database();
-		m_accountType = new databaseType();
-		m_db->insert("Accounts", m_accountType);
-		traverse(QString(), m_keePassDatabase->rootGroup());
-		m_keePassDatabase->deleteLater();
-		done(true);
+	if (m_finished) {
+		return;
 	}
+
+	m_progressDialog = new QDialog(m_parent);
+	m_progressDialog->setWindowTitle(databaseTypeName() + " Import");
+	m_progressDialog->setWindowModality(Qt::WindowModal);
+	QVBoxLayout *vbox = new QVBoxLayout();
+	vbox->setAlignment(Qt::AlignTop);
+	m_progressLabel = new genericText("Reading entries...");
+	m_progressBar = new QProgressBar();
+	m_progressBar->setMinimum(0);
+	m_progressBar->setMaximum(0);
+	QPushButton *cancelButton = new QPushButton("Cancel");
+	connect(cancelButton, SIGNAL(pressed()), this, SLOT(cancel()));
+	connect(m_progressDialog, SIGNAL(rejected()), this, SLOT(cancel()));
+	vbox->addWidget(m_progressLabel);
+	vbox->addWidget(m_progressBar);
+	vbox->addWidget(cancelButton);
+	m_progressDialog->setLayout(vbox);
+	m_progressDialog->show();
 }
 
-void KeePassImporter::invalidCredientialsDialogFinished(int rc)
+void KeePassImporter::readerOpened(bool success)
 {
-	Q_UNUSED(rc);
-	m_keePassDatabase->deleteLater();
-	m_keePassDatabase = nullptr;
-	done(false);
+	if (success) {
+		m_unlocked = true;
+	}
+}
+
+void KeePassImporter::readerEntriesRead(DatabaseImporter::databaseType entries, int count, int total)
+{
+	m_accountType->append(entries);
+	if (m_progressDialog) {
+		m_progressBar->setMaximum(total);
+		m_progressBar->setValue(count);
+		m_progressLabel->setText("Read " + QString::number(count) + " of " +
+					 QString::number(total) + " entries");
+	}
+}
+
+void KeePassImporter::readerFinished()
+{
+	//A failed unlock attempt leaves the dialog open for another try
+	if (!m_unlocked && !m_canceled) {
+		return;
+	}
+	finishImport();
+}
+
+void KeePassImporter::cancel()
+{
+	m_canceled = true;
+	m_reader->requestInterruption();
+}
+
+void KeePassImporter::finishImport()
+{
+	if (m_finished) {
+		return;
+	}
+	m_finished = true;
+	m_reader->wait();
+	if (m_progressDialog) {
+		m_progressDialog->disconnect(this);
+		m_progressDialog->deleteLater();
+		m_progressDialog = nullptr;
+	}
+	done(!m_canceled);
 }
@@ -5,18 +5,24 @@
 
 #include <QString>
 
-class Database;
-class Group;
-class databaseType;
+class KeePassReaderThread;
+class QDialog;
+class QLabel;
+class QProgressBar;
 
 class KeePassImporter : public DatabaseImporter
 {
 	Q_OBJECT
 	QWidget *m_parent;
-	Database *m_keePassDatabase;
-	void traverse(QString path, Group *group);
+	KeePassReaderThread *m_reader;
 	databaseType *m_accountType;
-	void failedToOpenDatabaseDialogFinished(int rc);
+	bool m_unlocked;
+	bool m_canceled;
+	bool m_finished;
+	QDialog *m_progressDialog;
+	QLabel *m_progressLabel;
+	QProgressBar *m_progressBar;
+	void finishImport();
 public:
 	KeePassImporter(QWidget *parent = 0);
 
@@ -27,7 +33,11 @@ public:
 public slots:
 	void start();
 private slots:
-	void invalidCredientialsDialogFinished(int rc);
+	void failedToOpenDatabaseDialogFinished(int rc);
+	void readerOpened(bool success);
+	void readerEntriesRead(DatabaseImporter::databaseType entries, int count, int total);
+	void readerFinished();
+	void cancel();
 };
 
 #endif // KEEPASSIMPORTER_H
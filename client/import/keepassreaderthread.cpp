@@ -0,0 +1,99 @@
+#include "keepassreaderthread.h"
+#include "account.h"
+
+#include <QBuffer>
+
+#include <format/KeePass2Reader.h>
+#include <core/Database.h>
+#include <core/Group.h>
+#include <core/Entry.h>
+
+KeePassReaderThread::KeePassReaderThread(QObject *parent) :
+	QThread(parent),
+	m_entriesRead(0),
+	m_entriesTotal(0)
+{
+	qRegisterMetaType<DatabaseImporter::databaseType>("DatabaseImporter::databaseType");
+}
+
+void KeePassReaderThread::setFileData(const QByteArray &fileData)
+{
+	m_fileData = fileData;
+}
+
+void KeePassReaderThread::setKey(const CompositeKey &key)
+{
+	m_key = key;
+}
+
+void KeePassReaderThread::run()
+{
+	m_errorString.clear();
+	m_entriesRead = 0;
+	m_entriesTotal = 0;
+
+	QBuffer buffer(&m_fileData);
+	buffer.open(QIODevice::ReadOnly);
+	KeePass2Reader reader;
+	Database *db = reader.readDatabase(&buffer, m_key);
+	if (!db) {
+		m_errorString = reader.errorString();
+		emit opened(false);
+		return;
+	}
+	emit opened(true);
+	if (!isInterruptionRequested()) {
+		m_entriesTotal = db->rootGroup()->entriesRecursive().size();
+		traverse(QString(), db->rootGroup());
+		flush();
+	}
+	delete db;
+}
+
+void KeePassReaderThread::flush()
+{
+	if (m_batch.size()) {
+		emit entriesRead(m_batch, m_entriesRead, m_entriesTotal);
+		m_batch.clear();
+	}
+}
+
+void KeePassReaderThread::traverse(QString path, Group *g)
+{
+	const QList<Entry *> &el = g->entries();
+	for (auto eiter = el.constBegin(); eiter != el.constEnd(); eiter++) {
+		if (isInterruptionRequested()) {
+			return;
+		}
+		Entry *e = (*eiter);
+		account *a = new account(-1);
+		a->acctName = e->title();
+		a->userName = e->username();
+		if (isEmail(a->userName)) {
+			a->email = a->userName;
+		}
+		a->url = e->url();
+		a->password = e->password();
+		if (e->notes().size()) {
+			a->fields.addField(genericField("notes", "text block", e->notes()));
+		}
+		a->setPath(path);
+		m_batch.append(a);
+		m_entriesRead++;
+		if (m_batch.size() == s_batchSize) {
+			flush();
+		}
+	}
+	const QList<Group*> &gl = g->children();
+	for (auto giter = gl.constBegin(); giter != gl.constEnd(); giter++) {
+		if (path.size()) {
+			QString pathNext = path;
+			pathNext.append('/').append((*giter)->name().replace("/", "//"));
+			traverse(pathNext,  (*giter));
+		} else {
+			QString pathNext = path;
+			pathNext.append((*giter)->name().replace("/", "//"));
+			traverse(pathNext,  (*giter));
+		}
+	}
+}
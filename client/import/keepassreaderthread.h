@@ -0,0 +1,45 @@
+#ifndef KEEPASSREADERTHREAD_H
+#define KEEPASSREADERTHREAD_H
+
+#include <QThread>
+#include <QByteArray>
+#include <QString>
+
+#include "databaseimporter.h"
+#include <keys/CompositeKey.h>
+
+class Group;
+
+//
+// Decrypts a KeePass database and converts its entries to accounts off
+// the GUI thread. The key transform can take seconds for databases with
+// a high round count. Accounts are emitted in batches as they are
+// converted.
+//
+class KeePassReaderThread : public QThread
+{
+	Q_OBJECT
+	void run();
+	void traverse(QString path, Group *g);
+	void flush();
+	QByteArray m_fileData;
+	CompositeKey m_key;
+	DatabaseImporter::databaseType m_batch;
+	QString m_errorString;
+	int m_entriesRead;
+	int m_entriesTotal;
+	static const int s_batchSize = 64;
+public:
+	KeePassReaderThread(QObject *parent = 0);
+	void setFileData(const QByteArray &fileData);
+	void setKey(const CompositeKey &key);
+	const QString &errorString()
+	{
+		return m_errorString;
+	}
+signals:
+	void opened(bool success);
+	void entriesRead(DatabaseImporter::databaseType entries, int count, int total);
+};
+
+#endif // KEEPASSREADERTHREAD_H
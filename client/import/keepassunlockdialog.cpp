@@ -1,8 +1,7 @@
 #include "keepassunlockdialog.h"
+#include "keepassreaderthread.h"
 #include "signetapplication.h"
 
-#include "core/Database.h"
-
 #include <QVBoxLayout>
 #include <QHBoxLayout>
 #include <QLabel>
@@ -10,30 +9,30 @@
 #include <QLineEdit>
 #include <QFileDialog>
 #include <QCheckBox>
+#include <QProgressBar>
 
-#include <format/KeePass2Reader.h>
 #include <keys/PasswordKey.h>
 #include <keys/FileKey.h>
-#include <core/Database.h>
-#include <core/Group.h>
-#include <core/Entry.h>
 
 #include "style.h"
 
-KeePassUnlockDialog::KeePassUnlockDialog(QFile *file, QWidget *parent) :
+KeePassUnlockDialog::KeePassUnlockDialog(KeePassReaderThread *reader, QWidget *parent) :
 	QDialog(parent),
-        m_keePassDatabase(NULL),
-	m_databaseFile(file)
+	m_reader(reader)
 {
 	QVBoxLayout *top = new QVBoxLayout();
 	top->setAlignment(this, Qt::AlignTop);
-	QPushButton *okay = new QPushButton("Ok");
+	m_okayButton = new QPushButton("Ok");
 	QPushButton *cancel = new QPushButton("Cancel");
 	QHBoxLayout *password = new QHBoxLayout();
 	QHBoxLayout *keyFile = new QHBoxLayout();
 	QHBoxLayout *buttons = new QHBoxLayout();
 	m_warnLabel = new errorText("Database read failed");
 	m_warnLabel->hide();
+	m_openProgress = new QProgressBar();
+	m_openProgress->setMinimum(0);
+	m_openProgress->setMaximum(0);
+	m_openProgress->hide();
 
 	m_passwordCheckBox = new QCheckBox("Password");
 	m_passwordCheckBox->setChecked(false);
@@ -48,12 +47,13 @@ KeePassUnlockDialog::KeePassUnlockDialog(QFile *file, QWidget *parent) :
 	keyFile->addWidget(m_keyFileCheckBox);
 	keyFile->addWidget(m_keyPathEdit);
 	keyFile->addWidget(m_keyPathBrowse);
-	buttons->addWidget(okay);
+	buttons->addWidget(m_okayButton);
 	buttons->addWidget(cancel);
 	top->addWidget(new QLabel("Enter password and/or key file to read database"));
 	top->addLayout(password);
 	top->addLayout(keyFile);
 	top->addWidget(m_warnLabel);
+	top->addWidget(m_openProgress);
 	top->addLayout(buttons);
 
 	connect(m_passwordCheckBox, SIGNAL(toggled(bool)),
@@ -64,18 +64,22 @@ KeePassUnlockDialog::KeePassUnlockDialog(QFile *file, QWidget *parent) :
 		this, SLOT(passwordTextEdited()));
 	connect(m_keyPathEdit, SIGNAL(textEdited(QString)),
 		this, SLOT(keyFileTextEdited()));
-	connect(okay, SIGNAL(pressed()),
+	connect(m_okayButton, SIGNAL(pressed()),
 		this, SLOT(okayPressed()));
 	connect(cancel, SIGNAL(pressed()),
 		this, SLOT(cancelPressed()));
 	connect(m_keyPathBrowse, SIGNAL(pressed()),
 		this, SLOT(keyPathBrowse()));
+	connect(m_reader, SIGNAL(opened(bool)),
+		this, SLOT(readerOpened(bool)));
 	setLayout(top);
 }
 
 void KeePassUnlockDialog::okayPressed()
 {
-	KeePass2Reader *r = new KeePass2Reader();
+	if (m_reader->isRunning()) {
+		return;
+	}
 	CompositeKey k;
 	QString password = m_passwordEdit->text();
 	if (m_passwordCheckBox->isChecked()) {
@@ -96,9 +100,21 @@ void KeePassUnlockDialog::okayPressed()
 			return;
 		}
 	}
-	m_databaseFile->reset();
-	m_keePassDatabase = r->readDatabase(m_databaseFile, k);
-	if (!m_keePassDatabase) {
+	m_warnLabel->hide();
+	m_openProgress->show();
+	m_okayButton->setEnabled(false);
+	m_reader->setKey(k);
+	m_reader->start();
+}
+
+void KeePassUnlockDialog::readerOpened(bool success)
+{
+	if (!isVisible()) {
+		return;
+	}
+	m_openProgress->hide();
+	m_okayButton->setEnabled(true);
+	if (!success) {
 		m_warnLabel->show();
 	} else {
 		done(0);
@@ -107,6 +123,7 @@ void KeePassUnlockDialog::okayPressed()
 
 void KeePassUnlockDialog::cancelPressed()
 {
+	m_reader->requestInterruption();
 	done(1);
 }
 
@@ -3,17 +3,17 @@
 
 #include <QDialog>
 
-class Database;
+class KeePassReaderThread;
 class QLineEdit;
 class QPushButton;
 class QLabel;
-class QFile;
 class QCheckBox;
+class QProgressBar;
 
 class KeePassUnlockDialog : public QDialog
 {
 	Q_OBJECT
-	Database *m_keePassDatabase;
+	KeePassReaderThread *m_reader;
 	QCheckBox *m_passwordCheckBox;
 	QLineEdit *m_passwordEdit;
 
@@ -21,15 +21,13 @@ class KeePassUnlockDialog : public QDialog
 	QLineEdit *m_keyPathEdit;
 	QPushButton *m_keyPathBrowse;
 	QLabel *m_warnLabel;
-	QFile *m_databaseFile;
+	QPushButton *m_okayButton;
+	QProgressBar *m_openProgress;
 public:
-	KeePassUnlockDialog(QFile *file, QWidget *parent);
-	Database *database()
-	{
-		return m_keePassDatabase;
-	}
+	KeePassUnlockDialog(KeePassReaderThread *reader, QWidget *parent);
 public slots:
 	void okayPressed();
+	void readerOpened(bool success);
 	void cancelPressed();
 	void keyPathBrowse();
 	void passwordTextEdited();
@@ -0,0 +1,118 @@
+#include "passdecryptpool.h"
+
+PassDecryptPool::PassDecryptPool(QObject *parent) :
+	QObject(parent),
+	m_maxJobs(1),
+	m_nextJob(0),
+	m_nextResult(0),
+	m_canceled(false),
+	m_active(false)
+{
+}
+
+PassDecryptPool::~PassDecryptPool()
+{
+	for (auto p : m_running.keys()) {
+		p->disconnect(this);
+		p->kill();
+		p->waitForFinished();
+	}
+}
+
+QString PassDecryptPool::gpgProgram()
+{
+	QString program = QString::fromLocal8Bit(qgetenv("SIGNET_GPG"));
+	if (!program.size()) {
+		program = "gpg";
+	}
+	return program;
+}
+
+void PassDecryptPool::start(const QString &program, const QStringList &args, const QStringList &files, int maxJobs)
+{
+	m_program = program;
+	m_args = args;
+	m_files = files;
+	m_maxJobs = qMax(1, maxJobs);
+	m_nextJob = 0;
+	m_nextResult = 0;
+	m_canceled = false;
+	m_active = true;
+	m_results.clear();
+	startJobs();
+}
+
+void PassDecryptPool::startJobs()
+{
+	while (!m_canceled && m_nextJob < m_files.size() && m_running.size() < m_maxJobs) {
+		QProcess *p = new QProcess(this);
+		connect(p, SIGNAL(finished(int, QProcess::ExitStatus)),
+			this, SLOT(processFinished(int, QProcess::ExitStatus)));
+		connect(p, SIGNAL(errorOccurred(QProcess::ProcessError)),
+			this, SLOT(processError(QProcess::ProcessError)));
+		m_running.insert(p, m_nextJob);
+		m_nextJob++;
+		p->start(m_program, m_args + QStringList(m_files.at(m_nextJob - 1)));
+	}
+	if (m_active && m_running.isEmpty() && (m_canceled || m_nextResult == m_files.size())) {
+		m_active = false;
+		finished();
+	}
+}
+
+void PassDecryptPool::processError(QProcess::ProcessError error)
+{
+	//Only a failure to start leaves the process without a finished() signal
+	if (error == QProcess::FailedToStart) {
+		jobDone(qobject_cast<QProcess *>(sender()), false);
+	}
+}
+
+void PassDecryptPool::processFinished(int exitCode, QProcess::ExitStatus exitStatus)
+{
+	jobDone(qobject_cast<QProcess *>(sender()), exitStatus == QProcess::NormalExit && exitCode == 0);
+}
+
+void PassDecryptPool::jobDone(QProcess *p, bool ok)
+{
+	auto iter = m_running.find(p);
+	if (iter == m_running.end()) {
+		return;
+	}
+	int index = iter.value();
+	m_running.erase(iter);
+	p->deleteLater();
+
+	if (!m_canceled) {
+		result r;
+		r.ok = ok;
+		if (ok) {
+			r.output = p->readAllStandardOutput();
+		}
+		m_results.insert(index, r);
+		//The handlers may cancel the pool so the map is not iterated
+		while (!m_canceled && m_results.size() && m_results.firstKey() == m_nextResult) {
+			result next = m_results.take(m_nextResult);
+			int nextIndex = m_nextResult++;
+			if (next.ok) {
+				decrypted(nextIndex, next.output);
+			} else {
+				failed(nextIndex);
+			}
+		}
+	}
+	startJobs();
+}
+
+void PassDecryptPool::cancel()
+{
+	if (m_canceled) {
+		return;
+	}
+	m_canceled = true;
+	m_results.clear();
+	for (auto p : m_running.keys()) {
+		p->kill();
+	}
+	startJobs();
+}
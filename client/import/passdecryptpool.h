@@ -0,0 +1,66 @@
+#ifndef PASSDECRYPTPOOL_H
+#define PASSDECRYPTPOOL_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QByteArray>
+#include <QHash>
+#include <QMap>
+#include <QProcess>
+
+//
+// Decrypts a list of files with a pool of at most maxJobs concurrent gpg
+// processes. The processes may exit in any order but each file's result
+// is reported in list order through decrypted() or failed(). finished()
+// follows once every file is reported, or once the running processes
+// exit after cancel().
+//
+class PassDecryptPool : public QObject
+{
+	Q_OBJECT
+	QString m_program;
+	QStringList m_args;
+	QStringList m_files;
+	int m_maxJobs;
+	int m_nextJob;
+	int m_nextResult;
+	bool m_canceled;
+	bool m_active;
+	QHash<QProcess *, int> m_running;
+
+	//Results that arrived ahead of an earlier file's
+	struct result {
+		bool ok;
+		QByteArray output;
+	};
+	QMap<int, result> m_results;
+
+	void startJobs();
+	void jobDone(QProcess *p, bool ok);
+public:
+	explicit PassDecryptPool(QObject *parent = 0);
+	~PassDecryptPool();
+
+	//args are passed to every process ahead of the file name
+	void start(const QString &program, const QStringList &args, const QStringList &files, int maxJobs);
+	bool isCanceled() const
+	{
+		return m_canceled;
+	}
+
+	//The gpg executable can be overridden with SIGNET_GPG, e.g. to point
+	//the importer at a stub script when testing
+	static QString gpgProgram();
+public slots:
+	void cancel();
+signals:
+	void decrypted(int index, QByteArray plaintext);
+	void failed(int index);
+	void finished();
+private slots:
+	void processFinished(int exitCode, QProcess::ExitStatus exitStatus);
+	void processError(QProcess::ProcessError error);
+};
+
+#endif // PASSDECRYPTPOOL_H
@@ -2,9 +2,11 @@
 
 #ifdef Q_OS_UNIX
 
+#include "passdecryptpool.h"
 #include "signetapplication.h"
 #include "account.h"
 #include "passimportunlockdialog.h"
+#include "generictext.h"
 
 #include <QDir>
 #include <QFile>
@@ -13,12 +15,27 @@
 #include <QWidget>
 #include <QStringList>
 #include <QTemporaryFile>
+#include <QThread>
+#include <QDialog>
+#include <QLabel>
+#include <QProgressBar>
+#include <QPushButton>
+#include <QVBoxLayout>
 
 PassImporter::PassImporter(QWidget *parent) :
 	DatabaseImporter(parent),
-	m_parent(parent)
+	m_parent(parent),
+	m_pool(nullptr),
+	m_jobsDone(0),
+	m_progressDialog(nullptr),
+	m_progressLabel(nullptr),
+	m_progressBar(nullptr),
+	m_accountType(nullptr)
 {
-
+	m_pool = new PassDecryptPool(this);
+	connect(m_pool, SIGNAL(decrypted(int, QByteArray)), this, SLOT(entryDecrypted(int, QByteArray)));
+	connect(m_pool, SIGNAL(failed(int)), this, SLOT(entryFailed(int)));
+	connect(m_pool, SIGNAL(finished()), this, SLOT(finish()));
 }
 
 void PassImporter::start()
@@ -48,7 +65,38 @@ void PassImporter::start()
 	m_accountType = new databaseType();
 	m_db->insert("Accounts", m_accountType);
 	traverse(QString(), root);
-	done(true);
+
+	m_progressDialog = new QDialog(m_parent);
+	m_progressDialog->setWindowTitle(databaseTypeName() + " Import");
+	m_progressDialog->setWindowModality(Qt::WindowModal);
+	QVBoxLayout *vbox = new QVBoxLayout();
+	vbox->setAlignment(Qt::AlignTop);
+	m_progressLabel = new genericText("Decrypting entries...");
+	m_progressBar = new QProgressBar();
+	m_progressBar->setMinimum(0);
+	m_progressBar->setMaximum(m_jobs.size());
+	QPushButton *cancelButton = new QPushButton("Cancel");
+	connect(cancelButton, SIGNAL(pressed()), m_pool, SLOT(cancel()));
+	connect(m_progressDialog, SIGNAL(rejected()), m_pool, SLOT(cancel()));
+	vbox->addWidget(m_progressLabel);
+	vbox->addWidget(m_progressBar);
+	vbox->addWidget(cancelButton);
+	m_progressDialog->setLayout(vbox);
+	m_progressDialog->show();
+
+	m_jobsDone = 0;
+	updateProgress();
+
+	QStringList args;
+	args << "-d" << "--batch" << "-r" << m_gpgId;
+	if (m_passphrase.size()) {
+		args << "--passphrase" << m_passphrase;
+	}
+	QStringList files;
+	for (const decryptJob &job : m_jobs) {
+		files.append(job.fileName);
+	}
+	m_pool->start(PassDecryptPool::gpgProgram(), args, files, QThread::idealThreadCount());
 }
 
 void PassImporter::doneFail()
@@ -56,6 +104,11 @@ void PassImporter::doneFail()
 	done(false);
 }
 
+void PassImporter::doneSuccess()
+{
+	done(true);
+}
+
 void PassImporter::traverse(QString path, QDir &dir)
 {
 	QFileInfoList fileInfoList;
@@ -63,38 +116,11 @@ void PassImporter::traverse(QString path, QDir &dir)
 	nameFilters.append(QString("*.gpg"));
 	fileInfoList = dir.entryInfoList(nameFilters, QDir::Files);
 	for (auto info : fileInfoList) {
-		QString accountName = info.completeBaseName();
-		QString cmd;
-		cmd = "gpg -d --batch -r " + m_gpgId;
-		if (m_passphrase.size()) {
-			cmd += " --passphrase " + m_passphrase;
-		}
-		cmd += " \"" + info.absoluteFilePath() + "\"";
-		QProcess p;
-		p.start(cmd);
-		p.waitForFinished(-1);
-		int rc = p.exitCode();
-		if (rc != 0) {
-			QMessageBox *box = SignetApplication::messageBoxError(QMessageBox::Critical,
-			                   databaseTypeName() + " Import",
-			                   "Failed to decrypt " + accountName,
-			                   m_parent);
-			box->exec();
-			box->deleteLater();
-		} else {
-			QString accountPassword = QString::fromUtf8(p.readAllStandardOutput());
-
-			if (accountPassword.size()) {
-				accountPassword[accountPassword.size()-1] == '\n';
-				accountPassword.truncate(accountPassword.size()-1);
-			}
-			account *a = new account(-1);
-			a->acctName = accountName;
-			a->userName = accountName;
-			a->password = accountPassword;
-			a->setPath(path);
-			m_accountType->append(a);
-		}
+		decryptJob job;
+		job.path = path;
+		job.accountName = info.completeBaseName();
+		job.fileName = info.absoluteFilePath();
+		m_jobs.append(job);
 	}
 	fileInfoList = dir.entryInfoList(QStringList(), QDir::Dirs);
 	for (auto info : fileInfoList) {
@@ -111,6 +137,62 @@ void PassImporter::traverse(QString path, QDir &dir)
 	}
 }
 
+void PassImporter::updateProgress()
+{
+	m_progressLabel->setText("Decrypted " + QString::number(m_jobsDone) + " of " +
+				 QString::number(m_jobs.size()) + " entries");
+	m_progressBar->setValue(m_jobsDone);
+}
+
+void PassImporter::entryDecrypted(int index, QByteArray plaintext)
+{
+	const decryptJob &job = m_jobs.at(index);
+	QString accountPassword = QString::fromUtf8(plaintext);
+	if (accountPassword.endsWith('\n')) {
+		accountPassword.truncate(accountPassword.size()-1);
+	}
+	account *a = new account(-1);
+	a->acctName = job.accountName;
+	a->userName = job.accountName;
+	a->password = accountPassword;
+	a->setPath(job.path);
+	m_accountType->append(a);
+	m_jobsDone++;
+	updateProgress();
+}
+
+void PassImporter::entryFailed(int index)
+{
+	m_failed.append(m_jobs.at(index).accountName);
+	m_jobsDone++;
+	updateProgress();
+}
+
+void PassImporter::finish()
+{
+	if (m_progressDialog) {
+		m_progressDialog->disconnect(this);
+		m_progressDialog->deleteLater();
+		m_progressDialog = nullptr;
+	}
+	m_jobs.clear();
+	m_passphrase.clear();
+	if (m_pool->isCanceled()) {
+		done(false);
+		return;
+	}
+	if (m_failed.size()) {
+		QMessageBox *box = SignetApplication::messageBoxError(QMessageBox::Critical,
+		                   databaseTypeName() + " Import",
+		                   "Failed to decrypt " + m_failed.join(", "),
+		                   m_parent);
+		m_failed.clear();
+		connect(box, SIGNAL(destroyed(QObject *)), this, SLOT(doneSuccess()));
+		return;
+	}
+	done(true);
+}
+
 QString PassImporter::passwordStorePath()
 {
 	QString home = QStandardPaths::standardLocations(QStandardPaths::HomeLocation).at(0);
@@ -135,19 +217,18 @@ bool PassImporter::passphraseCheck(QString passphrase)
 	t.close();
 	t.remove();
 
-	QString cmd;
-	cmd = "gpg --batch -r " + m_gpgId +
-	      " -o " + tmpName +
-	      " -e " + gpgIdPath();
-	if (QProcess::execute(cmd)) {
+	QStringList args;
+	args << "--batch" << "-r" << m_gpgId << "-o" << tmpName << "-e" << gpgIdPath();
+	if (QProcess::execute(PassDecryptPool::gpgProgram(), args)) {
 		return false;
 	}
-	cmd = "gpg --batch -n -r " + m_gpgId;
+	args.clear();
+	args << "--batch" << "-n" << "-r" << m_gpgId;
 	if (passphrase.size()) {
-		cmd += " --passphrase " + passphrase;
+		args << "--passphrase" << passphrase;
 	}
-	cmd += " -d " + tmpName;
-	bool pass = QProcess::execute(cmd) == 0;
+	args << "-d" << tmpName;
+	bool pass = QProcess::execute(PassDecryptPool::gpgProgram(), args) == 0;
 	QFile::remove(tmpName);
 	return pass;
 }
@@ -172,9 +253,9 @@ QString PassImporter::getGPGId()
 	if (!ok) {
 		return QString();
 	}
-	QString cmd = "gpg --batch -n -r " + gpgId + " -e " + gpgIdPath();
-
-	int rc = QProcess::execute(cmd);
+	QStringList args;
+	args << "--batch" << "-n" << "-r" << gpgId << "-e" << gpgIdPath();
+	int rc = QProcess::execute(PassDecryptPool::gpgProgram(), args);
 	if (rc != 0) {
 		return QString();
 	}
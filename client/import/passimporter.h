@@ -4,15 +4,41 @@
 #include "databaseimporter.h"
 
 #include <QString>
+#include <QStringList>
 #include <QDir>
+#include <QList>
+#include <QByteArray>
 
 class databaseType;
+class PassDecryptPool;
+class QDialog;
+class QLabel;
+class QProgressBar;
 
 class PassImporter : public DatabaseImporter
 {
 	Q_OBJECT
 	QWidget *m_parent;
+
+	struct decryptJob {
+		QString path;
+		QString accountName;
+		QString fileName;
+	};
+
+	//Entries are decrypted by a pool of concurrent gpg processes and
+	//added to the database in the order they were found
+	QList<decryptJob> m_jobs;
+	PassDecryptPool *m_pool;
+	int m_jobsDone;
+	QStringList m_failed;
+
+	QDialog *m_progressDialog;
+	QLabel *m_progressLabel;
+	QProgressBar *m_progressBar;
+
 	void traverse(QString path, QDir &dir);
+	void updateProgress();
 	static QString passwordStorePath();
 	static QString gpgIdPath();
 	QString m_gpgId;
@@ -30,6 +56,10 @@ public slots:
 	void start();
 private slots:
 	void doneFail();
+	void doneSuccess();
+	void entryDecrypted(int index, QByteArray plaintext);
+	void entryFailed(int index);
+	void finish();
 };
 
 #endif // PASSIMPORTER_H
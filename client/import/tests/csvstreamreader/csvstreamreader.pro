@@ -0,0 +1,17 @@
+QT += core testlib
+QT -= gui
+CONFIG += console testcase
+CONFIG -= app_bundle
+TARGET = tst_csvstreamreader
+TEMPLATE = app
+QMAKE_CXXFLAGS += -std=c++11
+
+contains(QMAKE_HOST.arch, x86_64) {
+QMAKE_CXXFLAGS += -msse4.1 -DUSE_SSE
+}
+
+INCLUDEPATH += ../..
+
+SOURCES += tst_csvstreamreader.cpp \
+	../../csvstreamreader.cpp
+HEADERS += ../../csvstreamreader.h
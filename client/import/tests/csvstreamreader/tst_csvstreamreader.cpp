@@ -0,0 +1,88 @@
+#include "csvstreamreader.h"
+
+#include <QBuffer>
+#include <QList>
+#include <QtTest>
+
+typedef QList<QStringList> rowList;
+
+Q_DECLARE_METATYPE(rowList)
+
+class tst_CSVStreamReader : public QObject
+{
+	Q_OBJECT
+	static rowList readAll(const QByteArray &data);
+private slots:
+	void rows_data();
+	void rows();
+	void chunkBoundary();
+};
+
+rowList tst_CSVStreamReader::readAll(const QByteArray &data)
+{
+	QBuffer buffer;
+	buffer.setData(data);
+	buffer.open(QIODevice::ReadOnly);
+	CSVStreamReader reader(&buffer);
+	rowList rows;
+	QStringList row;
+	while (reader.readRow(row)) {
+		rows.append(row);
+	}
+	return rows;
+}
+
+void tst_CSVStreamReader::rows_data()
+{
+	QTest::addColumn<QByteArray>("data");
+	QTest::addColumn<rowList>("rows");
+
+	rowList two;
+	two << (QStringList() << "a" << "b") << (QStringList() << "c" << "d");
+
+	QTest::newRow("lf") << QByteArray("a,b\nc,d\n") << two;
+	QTest::newRow("crlf") << QByteArray("a,b\r\nc,d\r\n") << two;
+	QTest::newRow("cr") << QByteArray("a,b\rc,d\r") << two;
+	QTest::newRow("no trailing newline") << QByteArray("a,b\r\nc,d") << two;
+	QTest::newRow("blank lines") << QByteArray("a,b\r\n\r\n\nc,d\r\r") << two;
+	QTest::newRow("bom") << QByteArray("\xef\xbb\xbf" "a,b\r\nc,d\r\n") << two;
+	QTest::newRow("quoted crlf") << QByteArray("\"a\r\nx\",b\r\nc,d\r\n")
+		<< (rowList() << (QStringList() << "a\r\nx" << "b") << (QStringList() << "c" << "d"));
+	QTest::newRow("quoted cr") << QByteArray("\"a\rx\",b\rc,d\r")
+		<< (rowList() << (QStringList() << "a\rx" << "b") << (QStringList() << "c" << "d"));
+	QTest::newRow("escaped quote") << QByteArray("\"a\"\"b\",\"\"\r\n")
+		<< (rowList() << (QStringList() << "a\"b" << ""));
+	QTest::newRow("empty fields") << QByteArray(",\r\n")
+		<< (rowList() << (QStringList() << "" << ""));
+	QTest::newRow("utf8") << QByteArray("\xc3\xa9t\xc3\xa9,b\r")
+		<< (rowList() << (QStringList() << QString::fromUtf8("\xc3\xa9t\xc3\xa9") << "b"));
+}
+
+void tst_CSVStreamReader::rows()
+{
+	QFETCH(QByteArray, data);
+	QFETCH(rowList, rows);
+	QCOMPARE(readAll(data), rows);
+}
+
+//
+// Rows, quotes and "\r\n" pairs that straddle the reader's 64KiB chunks
+//
+void tst_CSVStreamReader::chunkBoundary()
+{
+	const int chunkSize = 64 * 1024;
+	for (int shift = 0; shift < 4; shift++) {
+		QByteArray data;
+		rowList rows;
+		QByteArray pad(chunkSize - 2 - shift, 'x');
+		data += pad + ",\"q\r\nq\"\r\n";
+		rows << (QStringList() << QString::fromLatin1(pad) << "q\r\nq");
+		data += "c,d\r";
+		rows << (QStringList() << "c" << "d");
+		QCOMPARE(readAll(data), rows);
+	}
+}
+
+QTEST_APPLESS_MAIN(tst_CSVStreamReader)
+
+#include "tst_csvstreamreader.moc"
@@ -0,0 +1,16 @@
+QT += core testlib
+QT -= gui
+CONFIG += console testcase
+CONFIG -= app_bundle
+TARGET = tst_passdecryptpool
+TEMPLATE = app
+QMAKE_CXXFLAGS += -std=c++11
+
+DEFINES += STUB_GPG=\\\"$$PWD/stub-gpg.sh\\\"
+
+INCLUDEPATH += ../..
+
+SOURCES += tst_passdecryptpool.cpp \
+	../../passdecryptpool.cpp
+HEADERS += ../../passdecryptpool.h
+DISTFILES += stub-gpg.sh
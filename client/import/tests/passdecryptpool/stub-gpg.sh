@@ -0,0 +1,18 @@
+#!/bin/sh
+#
+# Stand-in for gpg used by the pass import tests. "Decrypting" a file
+# prints it without its first line. A first line of "sleep <seconds>"
+# delays the output and a first line of "fail" exits with an error.
+#
+for file; do :; done
+read -r first < "$file" || exit 2
+case "$first" in
+fail)
+	echo "gpg: decryption failed: No secret key" >&2
+	exit 2
+	;;
+sleep\ *)
+	sleep "${first#sleep }"
+	;;
+esac
+tail -n +2 "$file"
@@ -0,0 +1,151 @@
+#include "passdecryptpool.h"
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QSignalSpy>
+#include <QTemporaryDir>
+#include <QtTest>
+
+//
+// Runs PassDecryptPool against stub-gpg.sh, which prints a file less its
+// first line after the delay or failure that line asks for.
+//
+class tst_PassDecryptPool : public QObject
+{
+	Q_OBJECT
+	QTemporaryDir m_dir;
+	QStringList m_events;
+	QStringList writeFiles(const QStringList &firstLines);
+	bool run(PassDecryptPool &pool, const QStringList &files, int maxJobs, int timeout = 20000);
+private slots:
+	void initTestCase();
+	void init();
+	void ordering_data();
+	void ordering();
+	void failures();
+	void missingProgram();
+	void cancel();
+};
+
+void tst_PassDecryptPool::initTestCase()
+{
+	QVERIFY(m_dir.isValid());
+	qputenv("SIGNET_GPG", STUB_GPG);
+	QCOMPARE(PassDecryptPool::gpgProgram(), QString(STUB_GPG));
+}
+
+void tst_PassDecryptPool::init()
+{
+	m_events.clear();
+}
+
+QStringList tst_PassDecryptPool::writeFiles(const QStringList &firstLines)
+{
+	static int serial = 0;
+	QStringList files;
+	for (int i = 0; i < firstLines.size(); i++) {
+		QString name = m_dir.path() + "/entry" + QString::number(serial++) + ".gpg";
+		QFile f(name);
+		if (!f.open(QFile::WriteOnly)) {
+			return QStringList();
+		}
+		f.write(firstLines.at(i).toLatin1() + "\nsecret " + QByteArray::number(i) + "\n");
+		files.append(name);
+	}
+	return files;
+}
+
+bool tst_PassDecryptPool::run(PassDecryptPool &pool, const QStringList &files, int maxJobs, int timeout)
+{
+	connect(&pool, &PassDecryptPool::decrypted, [this](int index, QByteArray plaintext) {
+		m_events.append(QString::number(index) + ":" + QString::fromUtf8(plaintext).trimmed());
+	});
+	connect(&pool, &PassDecryptPool::failed, [this](int index) {
+		m_events.append(QString::number(index) + ":failed");
+	});
+	QSignalSpy finished(&pool, SIGNAL(finished()));
+	QStringList args;
+	args << "-d" << "--batch";
+	pool.start(PassDecryptPool::gpgProgram(), args, files, maxJobs);
+	if (!finished.count() && !finished.wait(timeout)) {
+		return false;
+	}
+	return finished.count() == 1;
+}
+
+void tst_PassDecryptPool::ordering_data()
+{
+	QTest::addColumn<int>("maxJobs");
+	QTest::newRow("one job") << 1;
+	QTest::newRow("two jobs") << 2;
+	QTest::newRow("all jobs") << 8;
+}
+
+//
+// Later files finish first, results must still come back in file order
+//
+void tst_PassDecryptPool::ordering()
+{
+	QFETCH(int, maxJobs);
+	const int count = 8;
+	QStringList firstLines;
+	QStringList expected;
+	for (int i = 0; i < count; i++) {
+		firstLines << "sleep 0." + QString::number(count - i);
+		expected << QString::number(i) + ":secret " + QString::number(i);
+	}
+	QStringList files = writeFiles(firstLines);
+	QCOMPARE(files.size(), count);
+
+	PassDecryptPool pool;
+	QElapsedTimer timer;
+	timer.start();
+	QVERIFY(run(pool, files, maxJobs));
+	QCOMPARE(m_events, expected);
+	QVERIFY(!pool.isCanceled());
+	if (maxJobs == count) {
+		//Serially the delays add up to 3.6s
+		QVERIFY(timer.elapsed() < 3000);
+	}
+}
+
+void tst_PassDecryptPool::failures()
+{
+	QStringList files = writeFiles(QStringList() << "sleep 0.3" << "fail" << "" << "sleep 0.1" << "fail");
+	QCOMPARE(files.size(), 5);
+	PassDecryptPool pool;
+	QVERIFY(run(pool, files, 3));
+	QCOMPARE(m_events, QStringList() << "0:secret 0" << "1:failed" << "2:secret 2" << "3:secret 3" << "4:failed");
+}
+
+void tst_PassDecryptPool::missingProgram()
+{
+	QStringList files = writeFiles(QStringList() << "" << "");
+	QCOMPARE(files.size(), 2);
+	PassDecryptPool pool;
+	connect(&pool, &PassDecryptPool::failed, [this](int index) {
+		m_events.append(QString::number(index) + ":failed");
+	});
+	QSignalSpy finished(&pool, SIGNAL(finished()));
+	pool.start(m_dir.path() + "/no-such-gpg", QStringList(), files, 2);
+	QVERIFY(finished.count() || finished.wait(10000));
+	QCOMPARE(m_events, QStringList() << "0:failed" << "1:failed");
+}
+
+void tst_PassDecryptPool::cancel()
+{
+	QStringList files = writeFiles(QStringList() << "sleep 10" << "sleep 10" << "sleep 10");
+	QCOMPARE(files.size(), 3);
+	PassDecryptPool pool;
+	QTimer::singleShot(200, &pool, SLOT(cancel()));
+	QElapsedTimer timer;
+	timer.start();
+	QVERIFY(run(pool, files, 2));
+	QVERIFY(timer.elapsed() < 5000);
+	QVERIFY(pool.isCanceled());
+	QVERIFY(m_events.isEmpty());
+}
+
+QTEST_GUILESS_MAIN(tst_PassDecryptPool)
+
+#include "tst_passdecryptpool.moc"
@@ -0,0 +1,8 @@
+#
+# Unit tests for the import code. Build and run with:
+#
+#   qmake client/import/tests/tests.pro && make && make check
+#
+TEMPLATE = subdirs
+SUBDIRS = csvstreamreader \
+	passdecryptpool
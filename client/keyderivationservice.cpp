@@ -0,0 +1,279 @@
+#include "keyderivationservice.h"
+#include "signetapplication.h"
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QFutureWatcher>
+#include <QThread>
+#include <QtConcurrent>
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+extern "C" {
+#include "crypto_scrypt.h"
+};
+
+KeyDerivationService *KeyDerivationService::g_singleton = nullptr;
+
+KeyDerivation::KeyDerivation(const QString &password, const QByteArray &hashfn, const QByteArray &salt, int keyLength, int unlockTimeMs) :
+	m_password(password),
+	m_hashfn(hashfn),
+	m_salt(salt),
+	m_keyLength(keyLength),
+	m_unlockTimeMs(unlockTimeMs),
+	m_cancel(0),
+	m_released(false),
+	m_calibrating(unlockTimeMs != 0),
+	m_memory(0),
+	m_watcher(nullptr)
+{
+
+}
+
+void KeyDerivation::run()
+{
+	if (m_unlockTimeMs) {
+		m_hashfn = SignetApplication::calibrateHashfn(m_unlockTimeMs);
+		emit calibrated();
+	}
+	SignetApplication::generateKey(m_password, m_key, m_hashfn, m_salt, m_keyLength, &m_cancel);
+}
+
+void KeyDerivation::release()
+{
+	KeyDerivationService::get()->release(this);
+}
+
+void KeyDerivation::wipeKey()
+{
+	SignetApplication::wipeKey(m_key);
+}
+
+KeyDerivationService::KeyDerivationService(QObject *parent) :
+	QObject(parent),
+	m_memoryInUse(0),
+	m_memoryLimit(0),
+	m_releaseWhenIdle(false)
+{
+	//Memory, not threads, is what limits concurrency. Keep enough threads
+	//for an old and a new key to be derived side by side.
+	m_pool.setMaxThreadCount(qMax(2, QThread::idealThreadCount()));
+	m_idleTimer.setSingleShot(true);
+	m_idleTimer.setInterval(s_idleReleaseMs);
+	connect(&m_idleTimer, SIGNAL(timeout()), this, SLOT(idleTimeout()));
+}
+
+KeyDerivationService::~KeyDerivationService()
+{
+	for (auto d : m_queue) {
+		delete d;
+	}
+	m_queue.clear();
+	for (auto d : m_running) {
+		d->cancel();
+	}
+	m_pool.waitForDone();
+	for (auto d : m_running) {
+		d->wipeKey();
+		delete d;
+	}
+	m_running.clear();
+	g_singleton = nullptr;
+}
+
+KeyDerivationService *KeyDerivationService::get()
+{
+	if (!g_singleton) {
+		g_singleton = new KeyDerivationService(QCoreApplication::instance());
+	}
+	return g_singleton;
+}
+
+qint64 KeyDerivationService::availableMemory()
+{
+#ifdef Q_OS_WIN
+	MEMORYSTATUSEX status;
+	status.dwLength = sizeof(status);
+	if (GlobalMemoryStatusEx(&status)) {
+		return (qint64)status.ullAvailPhys;
+	}
+#else
+#ifdef Q_OS_LINUX
+	//Free pages leave out the page cache the kernel hands back on demand,
+	//MemAvailable counts it
+	QFile meminfo("/proc/meminfo");
+	if (meminfo.open(QFile::ReadOnly)) {
+		for (const QByteArray &line : meminfo.readAll().split('\n')) {
+			if (line.startsWith("MemAvailable:")) {
+				qint64 kb = line.mid(13).trimmed().split(' ').first().toLongLong();
+				if (kb > 0) {
+					return kb * 1024;
+				}
+			}
+		}
+	}
+#endif
+	long pageSize = sysconf(_SC_PAGESIZE);
+	long pages;
+#ifdef _SC_AVPHYS_PAGES
+	pages = sysconf(_SC_AVPHYS_PAGES);
+	if (pageSize > 0 && pages > 0) {
+		return (qint64)pageSize * pages;
+	}
+#endif
+	//Without a figure for free memory, assume half of it is
+	pages = sysconf(_SC_PHYS_PAGES);
+	if (pageSize > 0 && pages > 0) {
+		return (qint64)pageSize * pages / 2;
+	}
+#endif
+	return 0;
+}
+
+//Scratch memory scrypt maps for a derivation: one V and XY per lane computed
+//in parallel plus B for every lane
+qint64 KeyDerivationService::derivationMemory(const QByteArray &hashfn)
+{
+	unsigned int N, r, p;
+	if (!SignetApplication::scryptParams(hashfn, N, r, p)) {
+		return 0;
+	}
+	qint64 threads = qBound(1, qMin(QThread::idealThreadCount(), SCRYPT_MAX_THREADS), (int)p);
+	return threads * ((qint64)128 * r * N + 256 * r + 64) + (qint64)128 * r * p;
+}
+
+qint64 KeyDerivationService::calibrationMemory()
+{
+	return SignetApplication::calibrationMemoryLimit();
+}
+
+KeyDerivation *KeyDerivationService::derive(const QString &password, const QByteArray &hashfn, const QByteArray &salt, int keyLength)
+{
+	KeyDerivation *d = new KeyDerivation(password, hashfn, salt, keyLength, 0);
+	d->m_memory = derivationMemory(hashfn);
+	m_queue.append(d);
+	schedule();
+	return d;
+}
+
+KeyDerivation *KeyDerivationService::deriveCalibrated(const QString &password, int unlockTimeMs, const QByteArray &salt, int keyLength)
+{
+	KeyDerivation *d = new KeyDerivation(password, QByteArray(), salt, keyLength, unlockTimeMs);
+	d->m_memory = calibrationMemory();
+	connect(d, SIGNAL(calibrated()), this, SLOT(derivationCalibrated()));
+	m_queue.append(d);
+	schedule();
+	return d;
+}
+
+void KeyDerivationService::release(KeyDerivation *d)
+{
+	d->cancel();
+	if (m_running.contains(d)) {
+		//Wiped and deleted once the worker is done with it
+		d->m_released = true;
+		return;
+	}
+	d->wipeKey();
+	if (m_queue.removeOne(d)) {
+		delete d;
+		schedule();
+		checkIdle();
+	} else {
+		d->deleteLater();
+	}
+}
+
+void KeyDerivationService::releaseScratchMemory()
+{
+	m_releaseWhenIdle = true;
+	checkIdle();
+}
+
+void KeyDerivationService::checkIdle()
+{
+	if (m_running.size() || m_queue.size()) {
+		return;
+	}
+	if (m_releaseWhenIdle) {
+		m_releaseWhenIdle = false;
+		m_idleTimer.stop();
+		SignetApplication::releaseScryptArena();
+	} else {
+		m_idleTimer.start();
+	}
+}
+
+void KeyDerivationService::idleTimeout()
+{
+	if (m_running.isEmpty()) {
+		SignetApplication::releaseScryptArena();
+	}
+}
+
+void KeyDerivationService::start(KeyDerivation *d)
+{
+	m_idleTimer.stop();
+	m_running.append(d);
+	m_memoryInUse += d->m_memory;
+	d->m_watcher = new QFutureWatcher<void>(d);
+	connect(d->m_watcher, SIGNAL(finished()), this, SLOT(derivationFinished()));
+	d->m_watcher->setFuture(QtConcurrent::run(&m_pool, d, &KeyDerivation::run));
+}
+
+void KeyDerivationService::schedule()
+{
+	while (m_queue.size()) {
+		KeyDerivation *d = m_queue.first();
+		if (m_running.size()) {
+			bool calibrating = d->m_calibrating;
+			for (auto r : m_running) {
+				calibrating = calibrating || r->m_calibrating;
+			}
+			if (calibrating || (m_memoryInUse + d->m_memory) > m_memoryLimit) {
+				break;
+			}
+		} else {
+			m_memoryLimit = availableMemory();
+		}
+		m_queue.removeFirst();
+		start(d);
+	}
+}
+
+void KeyDerivationService::derivationCalibrated()
+{
+	KeyDerivation *d = qobject_cast<KeyDerivation *>(sender());
+	if (!d || !m_running.contains(d)) {
+		return;
+	}
+	//m_hashfn was written before calibrated() was emitted and isn't
+	//touched again by the worker
+	m_memoryInUse -= d->m_memory;
+	d->m_memory = derivationMemory(d->m_hashfn);
+	m_memoryInUse += d->m_memory;
+	d->m_calibrating = false;
+	schedule();
+}
+
+void KeyDerivationService::derivationFinished()
+{
+	KeyDerivation *d = qobject_cast<KeyDerivation *>(sender()->parent());
+	if (!d || !m_running.removeOne(d)) {
+		return;
+	}
+	m_memoryInUse -= d->m_memory;
+	d->m_calibrating = false;
+	if (d->m_released) {
+		d->wipeKey();
+		d->deleteLater();
+	} else {
+		d->complete();
+	}
+	schedule();
+	checkIdle();
+}
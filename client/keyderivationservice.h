@@ -0,0 +1,127 @@
+#ifndef KEYDERIVATIONSERVICE_H
+#define KEYDERIVATIONSERVICE_H
+
+#include <QObject>
+#include <QList>
+#include <QThreadPool>
+#include <QTimer>
+
+template <typename T> class QFutureWatcher;
+class KeyDerivationService;
+
+//Unlock time budget offered when choosing a new master password
+#define DEFAULT_UNLOCK_TIME_SECONDS 2
+
+//
+// A single key derivation queued with KeyDerivationService. finished() is
+// emitted on the GUI thread once the key is ready, or once a canceled
+// derivation has stopped, in which case the key is empty. Derivations are
+// owned by the service: call release() instead of deleting one.
+//
+class KeyDerivation : public QObject
+{
+	Q_OBJECT
+	friend class KeyDerivationService;
+	QString m_password;
+	QByteArray m_key;
+	QByteArray m_hashfn;
+	QByteArray m_salt;
+	int m_keyLength;
+	int m_unlockTimeMs;
+	volatile int m_cancel;
+	bool m_released;
+	bool m_calibrating;
+	qint64 m_memory;
+	QFutureWatcher<void> *m_watcher;
+	KeyDerivation(const QString &password, const QByteArray &hashfn, const QByteArray &salt, int keyLength, int unlockTimeMs);
+	void run();
+	void complete()
+	{
+		emit finished();
+	}
+public:
+	//Ask the derivation to stop. It still emits finished(), with an empty key
+	void cancel()
+	{
+		m_cancel = 1;
+	}
+	bool isCanceled()
+	{
+		return m_cancel != 0;
+	}
+	//Cancel the derivation if it's still running, wipe its key and let
+	//the service delete it. The pointer must not be used afterwards.
+	void release();
+	void wipeKey();
+	//Hand over the key without leaving a shared copy behind, so that
+	//wiping the returned array wipes the only copy
+	QByteArray takeKey()
+	{
+		QByteArray key = m_key;
+		m_key = QByteArray();
+		return key;
+	}
+	const QByteArray &getKey()
+	{
+		return m_key;
+	}
+	const QByteArray &getHashfn()
+	{
+		return m_hashfn;
+	}
+	const QByteArray &getSalt()
+	{
+		return m_salt;
+	}
+signals:
+	void calibrated();
+	void finished();
+};
+
+//
+// Runs key derivations on a private thread pool. Independent derivations run
+// concurrently as long as their scrypt scratch memory fits in the physical
+// memory that was available when the pool last went idle; the first queued
+// derivation is always started so that a single large one can't stall. A
+// derivation that is still calibrating runs alone so that other work doesn't
+// skew its timing. The shared scrypt scratch memory is released once the
+// pool has been idle for s_idleReleaseMs.
+//
+class KeyDerivationService : public QObject
+{
+	Q_OBJECT
+	QThreadPool m_pool;
+	QList<KeyDerivation *> m_queue;
+	QList<KeyDerivation *> m_running;
+	qint64 m_memoryInUse;
+	qint64 m_memoryLimit;
+	static const int s_idleReleaseMs = 5000;
+	QTimer m_idleTimer;
+	bool m_releaseWhenIdle;
+	static KeyDerivationService *g_singleton;
+	explicit KeyDerivationService(QObject *parent);
+	void schedule();
+	void checkIdle();
+	void start(KeyDerivation *d);
+	static qint64 availableMemory();
+	static qint64 derivationMemory(const QByteArray &hashfn);
+	static qint64 calibrationMemory();
+public:
+	~KeyDerivationService();
+	static KeyDerivationService *get();
+	KeyDerivation *derive(const QString &password, const QByteArray &hashfn, const QByteArray &salt, int keyLength);
+	//Pick hashfn by benchmarking this machine against an unlock time budget
+	//before deriving the key. KeyDerivation::getHashfn() returns the chosen
+	//parameters.
+	KeyDerivation *deriveCalibrated(const QString &password, int unlockTimeMs, const QByteArray &salt, int keyLength);
+	void release(KeyDerivation *d);
+	//Release the scratch memory as soon as no derivation is running
+	//instead of waiting for the idle timeout
+	void releaseScratchMemory();
+private slots:
+	void derivationCalibrated();
+	void derivationFinished();
+	void idleTimeout();
+};
+
+#endif // KEYDERIVATIONSERVICE_H
@@ -16,13 +16,17 @@
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QStyleFactory>
+#include <QMutex>
 
 extern "C" {
 #include "signetdev/host/signetdev.h"
 #include "crypto_scrypt.h"
+#include "crypto_scrypt_calibrate.h"
+#include "insecure_memzero.h"
 };
 
 #include "systemtray.h"
+#include "commandtracer.h"
 
 #include <websockethandler.h>
 
@@ -31,7 +35,18 @@ extern "C" {
 #define DEFAULT_SCRYPT_R_VALUE 32
 #define DEFAULT_SCRIPT_P_VALUE 1
 
+//Calibration never goes below the weakest parameters the old fixed security
+//levels offered, nor above the memory of the strongest one. p stays below
+//128 since generateKey() reads the hashfn bytes as signed chars.
+#define CALIBRATE_SCRYPT_MIN_N_VALUE_LOG2 12
+#define CALIBRATE_SCRYPT_R_VALUE 8
+#define CALIBRATE_SCRYPT_MAX_MEM (512 * 1024 * 1024)
+#define CALIBRATE_SCRYPT_MAX_P_VALUE 127
+#define CALIBRATE_SCRYPT_FALLBACK_N_VALUE_LOG2 15
+
 SignetApplication *SignetApplication::g_singleton = nullptr;
+struct crypto_scrypt_arena *SignetApplication::s_scryptArena = nullptr;
+QMutex SignetApplication::s_scryptArenaLock;
 
 void SignetApplication::deviceOpenedS(enum signetdev_device_type dev_type, void *this_)
 {
@@ -168,14 +183,90 @@ SignetApplication::SignetApplication(int &argc, char **argv) :
 	qRegisterMetaType<enum signetdev_device_type>();
 }
 
-void SignetApplication::generateScryptKey(const QString &password, QByteArray &key, const QByteArray &salt, unsigned int N, unsigned int r, unsigned int s)
+bool SignetApplication::generateScryptKey(const QString &password, QByteArray &key, const QByteArray &salt, unsigned int N, unsigned int r, unsigned int s, const volatile int *cancel)
 {
 	QByteArray password_utf8 = password.toUtf8();
-	crypto_scrypt((u8 *)password_utf8.data(), password_utf8.size(),
-		      (u8 *)salt.data(), salt.size(),
-		      N, r, s,
-		      (u8 *)key.data(), key.size());
+	struct crypto_scrypt_arena *arena = nullptr;
+	bool shared = s_scryptArenaLock.tryLock();
+	if (shared) {
+		if (!s_scryptArena) {
+			s_scryptArena = crypto_scrypt_arena_init();
+		}
+		arena = s_scryptArena;
+	}
+	//Derivations that overlap one in progress get their own scratch memory
+	struct crypto_scrypt_arena *temporary = nullptr;
+	if (!arena) {
+		temporary = crypto_scrypt_arena_init();
+		arena = temporary;
+	}
+	int rc = -1;
+	if (arena) {
+		rc = crypto_scrypt_arena_cancelable(arena, cancel,
+						    (u8 *)password_utf8.data(), password_utf8.size(),
+						    (u8 *)salt.data(), salt.size(),
+						    N, r, s,
+						    (u8 *)key.data(), key.size());
+	}
+	crypto_scrypt_arena_free(temporary);
+	if (shared) {
+		s_scryptArenaLock.unlock();
+	}
+	wipeKey(password_utf8);
+	return rc == 0;
+}
+
+void SignetApplication::wipeKey(QByteArray &key)
+{
+	if (key.size()) {
+		insecure_memzero(key.data(), (size_t)key.size());
+	}
+	key.clear();
+}
+
+void SignetApplication::releaseScryptArena()
+{
+	QMutexLocker locker(&s_scryptArenaLock);
+	crypto_scrypt_arena_free(s_scryptArena);
+	s_scryptArena = nullptr;
+}
+
+QByteArray SignetApplication::calibrateHashfn(int unlockTimeMs)
+{
+	int log2N = CALIBRATE_SCRYPT_MIN_N_VALUE_LOG2;
+	uint32_t p = 1;
+	int rc = -1;
 
+	s_scryptArenaLock.lock();
+	if (!s_scryptArena) {
+		s_scryptArena = crypto_scrypt_arena_init();
+	}
+	if (s_scryptArena) {
+		rc = crypto_scrypt_calibrate(s_scryptArena, unlockTimeMs / 1000.0,
+					     CALIBRATE_SCRYPT_MAX_MEM, CALIBRATE_SCRYPT_R_VALUE,
+					     &log2N, &p);
+	}
+	//Calibration probes up to CALIBRATE_SCRYPT_MAX_MEM per lane, far more
+	//than the derivation that follows needs
+	crypto_scrypt_arena_free(s_scryptArena);
+	s_scryptArena = nullptr;
+	s_scryptArenaLock.unlock();
+
+	if (rc) {
+		log2N = CALIBRATE_SCRYPT_FALLBACK_N_VALUE_LOG2;
+		p = 1;
+	}
+	if (p > CALIBRATE_SCRYPT_MAX_P_VALUE) {
+		p = CALIBRATE_SCRYPT_MAX_P_VALUE;
+	}
+
+	QByteArray hashfn(HASH_FN_SZ, 0);
+	hashfn.data()[0] = 1;
+	hashfn.data()[1] = (char)log2N;
+	hashfn.data()[2] = (char)(CALIBRATE_SCRYPT_R_VALUE & 0xff);
+	hashfn.data()[3] = (char)(CALIBRATE_SCRYPT_R_VALUE >> 8);
+	hashfn.data()[4] = (char)p;
+	return hashfn;
 }
 
 #ifdef WITH_BROWSER_PLUGINS
@@ -211,35 +302,56 @@ void SignetApplication::getFirmwareVersion(int &major, int &minor, int &step)
 	}
 }
 
-void SignetApplication::generateKey(const QString &password, QByteArray &key, const QByteArray &hashfn, const QByteArray &salt, int keyLength)
+bool SignetApplication::scryptParams(const QByteArray &hashfn, unsigned int &N, unsigned int &r, unsigned int &p)
 {
-	QByteArray s = password.toUtf8();
-	key.resize(keyLength);
-	memset(key.data(), 0, (size_t)key.length());
-
 	int fn = hashfn.at(0);
 
 	switch(fn) {
-	case 0: {
-		unsigned int N = DEFAULT_SCRYPT_N_VALUE;
-		unsigned int r = DEFAULT_SCRYPT_R_VALUE;
-		unsigned int p = DEFAULT_SCRIPT_P_VALUE;
-		QByteArray actual_salt("rand", 4);
-		generateScryptKey(password, key, actual_salt, N, r, p);
-	}
-	break;
-	case 1: {
+	case 0:
+		N = DEFAULT_SCRYPT_N_VALUE;
+		r = DEFAULT_SCRYPT_R_VALUE;
+		p = DEFAULT_SCRIPT_P_VALUE;
+		return true;
+	case 1:
 		if (hashfn.size() >= 5) {
-			unsigned int N = ((unsigned int )1) << hashfn.at(1);
-			unsigned int r = ((unsigned int)hashfn.at(2)) + (((unsigned int)hashfn.at(3))<<8);
-			unsigned int p = (unsigned int)hashfn.at(4);
-			generateScryptKey(password, key, salt, N, r, p);
+			N = ((unsigned int )1) << hashfn.at(1);
+			r = ((unsigned int)hashfn.at(2)) + (((unsigned int)hashfn.at(3))<<8);
+			p = (unsigned int)hashfn.at(4);
+			return true;
 		}
-	}
-	break;
+		break;
 	default:
 		break;
 	}
+	return false;
+}
+
+qint64 SignetApplication::calibrationMemoryLimit()
+{
+	return CALIBRATE_SCRYPT_MAX_MEM;
+}
+
+bool SignetApplication::generateKey(const QString &password, QByteArray &key, const QByteArray &hashfn, const QByteArray &salt, int keyLength, const volatile int *cancel)
+{
+	key.resize(keyLength);
+	memset(key.data(), 0, (size_t)key.length());
+
+	bool generated = true;
+	unsigned int N, r, p;
+
+	if (scryptParams(hashfn, N, r, p)) {
+		if (hashfn.at(0) == 0) {
+			QByteArray actual_salt("rand", 4);
+			generated = generateScryptKey(password, key, actual_salt, N, r, p, cancel);
+		} else {
+			generated = generateScryptKey(password, key, salt, N, r, p, cancel);
+		}
+	}
+	//Partial results of a canceled derivation are never handed back
+	if (!generated) {
+		wipeKey(key);
+	}
+	return generated;
 }
 
 void SignetApplication::deviceEventS(void *cb_param, int event_type, const void *data, int data_len)
@@ -264,101 +376,217 @@ void SignetApplication::setAsyncListener(SignetAsyncListener *l)
 	m_signetAsyncListener = l;
 }
 
+//
+// A command response copied out of the signetdev callback, so it can
+// be delivered later from the GUI thread
+//
+struct commandResp {
+	signetdevCmdRespInfo info;
+	int uid;
+	QByteArray data;
+	QByteArray mask;
+	QVector<int> formats;
+	QStringList names;
+	signetdev_startup_resp_data startup;
+	signetdev_get_progress_resp_data progress;
+	cleartext_pass cleartext;
+};
+
+static const QEvent::Type s_commandRespEventType = static_cast<QEvent::Type>(QEvent::registerEventType());
+
+class commandRespEvent : public QEvent
+{
+public:
+	commandResp resp;
+	commandRespEvent(commandResp &&resp_) :
+		QEvent(s_commandRespEventType),
+		resp(std::move(resp_))
+	{
+	}
+};
+
 void SignetApplication::commandRespS(void *cb_param, void *cmd_user_param, int cmd_token, int cmd, int end_device_state, int messages_remaining, int resp_code, const void *resp_data)
 {
-	signetdevCmdRespInfo info;
-	info.param = cmd_user_param;
-	info.cmd = cmd;
-	info.token = cmd_token;
-	info.resp_code = resp_code;
-	info.end_device_state = end_device_state;
-	info.messages_remaining = messages_remaining;
+	commandResp r;
+	r.info.param = cmd_user_param;
+	r.info.cmd = cmd;
+	r.info.token = cmd_token;
+	r.info.resp_code = resp_code;
+	r.info.end_device_state = end_device_state;
+	r.info.messages_remaining = messages_remaining;
+	r.uid = -1;
 
 	SignetApplication *this_ = static_cast<SignetApplication *>(cb_param);
 	switch(cmd) {
-	case SIGNETDEV_CMD_READ_ALL_UIDS: {
+	case SIGNETDEV_CMD_READ_ALL_UIDS:
+	case SIGNETDEV_CMD_READ_UID:
 		if (resp_data && resp_code == OKAY) {
-			signetdev_read_all_uids_resp_data *resp = (signetdev_read_all_uids_resp_data *)resp_data;
-			QByteArray data((char *)resp->data, resp->size);
-			QByteArray mask((char *)resp->mask, resp->size);
-			this_->signetdevReadAllUIdsResp(info, resp->uid, data, mask);
-		} else {
-			QByteArray data;
-			QByteArray mask;
-			this_->signetdevReadAllUIdsResp(info, -1, data, mask);
+			if (cmd == SIGNETDEV_CMD_READ_ALL_UIDS) {
+				signetdev_read_all_uids_resp_data *resp = (signetdev_read_all_uids_resp_data *)resp_data;
+				r.uid = resp->uid;
+				r.data = QByteArray((char *)resp->data, resp->size);
+				r.mask = QByteArray((char *)resp->mask, resp->size);
+			} else {
+				signetdev_read_uid_resp_data *resp = (signetdev_read_uid_resp_data *)resp_data;
+				r.data = QByteArray((char *)resp->data, resp->size);
+				r.mask = QByteArray((char *)resp->mask, resp->size);
+			}
 		}
-	}
-	break;
+		break;
 	case SIGNETDEV_CMD_GET_RAND_BITS: {
 		signetdev_get_rand_bits_resp_data *resp = (signetdev_get_rand_bits_resp_data *)resp_data;
-		QByteArray data((const char *)resp->data, resp->size);
-		this_->signetdevGetRandBits(info, data);
-	}
-	break;
-	case SIGNETDEV_CMD_READ_BLOCK: {
-		QByteArray blk((const char *)resp_data, ::signetdev_device_block_size());
-		this_->signetdevReadBlockResp(info, blk);
-	}
-	break;
-	case SIGNETDEV_CMD_GET_PROGRESS: {
-		signetdev_get_progress_resp_data *resp = (signetdev_get_progress_resp_data *)resp_data;
-		this_->signetdevGetProgressResp(info, *resp);
+		r.data = QByteArray((const char *)resp->data, resp->size);
 	}
 	break;
-	case SIGNETDEV_CMD_STARTUP: {
-		QByteArray hashfn;
-		QByteArray salt;
-		signetdev_startup_resp_data resp;
+	case SIGNETDEV_CMD_READ_BLOCK:
+		r.data = QByteArray((const char *)resp_data, ::signetdev_device_block_size());
+		break;
+	case SIGNETDEV_CMD_GET_PROGRESS:
+		r.progress = *(signetdev_get_progress_resp_data *)resp_data;
+		break;
+	case SIGNETDEV_CMD_STARTUP:
 		if (resp_data && (resp_code == OKAY || resp_code == UNKNOWN_DB_FORMAT)) {
-			signetdev_startup_resp_data *resp_ = (signetdev_startup_resp_data *)resp_data;
-			resp = *resp_;
-		}
-		this_->signetdevStartupResp(info, resp);
-	}
-	break;
-	case SIGNETDEV_CMD_READ_UID: {
-		if (resp_data && resp_code == OKAY) {
-			signetdev_read_uid_resp_data *resp = (signetdev_read_uid_resp_data *)resp_data;
-			QByteArray data((char *)resp->data, resp->size);
-			QByteArray mask((char *)resp->mask, resp->size);
-			this_->signetdevReadUIdResp(info, data, mask);
-		} else {
-			QByteArray data;
-			QByteArray mask;
-			this_->signetdevReadUIdResp(info, data, mask);
+			r.startup = *(signetdev_startup_resp_data *)resp_data;
 		}
-	}
-	break;
-	case SIGNETDEV_CMD_READ_CLEARTEXT_PASSWORD_NAMES: {
-		QStringList l;
-		QVector<int> f;
+		break;
+	case SIGNETDEV_CMD_READ_CLEARTEXT_PASSWORD_NAMES:
 		if (resp_data && resp_code == OKAY) {
 			for (int i = 0; i < NUM_CLEARTEXT_PASS; i++) {
 				const u8 *data = ((const u8 *)resp_data) + i * (CLEARTEXT_PASS_NAME_SIZE + 1);
 				u8 format = data[0];
-				f.append(format);
+				r.formats.append(format);
 				QString s = QString::fromUtf8(((const char *)data) + 1);
-				l.push_back(s);
+				r.names.push_back(s);
 			}
 		}
-		this_->signetdevReadCleartextPasswordNames(info, f, l);
-	}
-	break;
-	case SIGNETDEV_CMD_READ_CLEARTEXT_PASSWORD: {
-		cleartext_pass resp;
+		break;
+	case SIGNETDEV_CMD_READ_CLEARTEXT_PASSWORD:
 		if (resp_code == OKAY && resp_data) {
-			cleartext_pass *resp_ = (cleartext_pass *)resp_data;
-			resp = *resp_;
+			r.cleartext = *(cleartext_pass *)resp_data;
 		}
-		this_->signetdevReadCleartextPassword(info, resp);
+		break;
+	default:
+		break;
 	}
-	break;
+
+	//A single queued event per response, however many objects listen
+	CommandTracer::received(cmd_token, cmd);
+	QCoreApplication::postEvent(this_, new commandRespEvent(std::move(r)));
+}
+
+void SignetApplication::routeResponses(int token, QObject *receiver)
+{
+	CommandTracer::issued(token);
+	g_singleton->m_responseRoutes.insert(token, QPointer<QObject>(receiver));
+}
+
+void SignetApplication::deliverCommandResp(QObject *receiver, const commandResp &r)
+{
+	switch(r.info.cmd) {
+	case SIGNETDEV_CMD_READ_ALL_UIDS:
+		QMetaObject::invokeMethod(receiver, "signetdevReadAllUIdsResp", Qt::DirectConnection,
+					  Q_ARG(signetdevCmdRespInfo, r.info), Q_ARG(int, r.uid),
+					  Q_ARG(QByteArray, r.data), Q_ARG(QByteArray, r.mask));
+		break;
+	case SIGNETDEV_CMD_GET_RAND_BITS:
+		QMetaObject::invokeMethod(receiver, "signetdevGetRandBits", Qt::DirectConnection,
+					  Q_ARG(signetdevCmdRespInfo, r.info), Q_ARG(QByteArray, r.data));
+		break;
+	case SIGNETDEV_CMD_READ_BLOCK:
+		QMetaObject::invokeMethod(receiver, "signetdevReadBlockResp", Qt::DirectConnection,
+					  Q_ARG(signetdevCmdRespInfo, r.info), Q_ARG(QByteArray, r.data));
+		break;
+	case SIGNETDEV_CMD_GET_PROGRESS:
+		QMetaObject::invokeMethod(receiver, "signetdevGetProgressResp", Qt::DirectConnection,
+					  Q_ARG(signetdevCmdRespInfo, r.info),
+					  Q_ARG(signetdev_get_progress_resp_data, r.progress));
+		break;
+	case SIGNETDEV_CMD_STARTUP:
+		QMetaObject::invokeMethod(receiver, "signetdevStartupResp", Qt::DirectConnection,
+					  Q_ARG(signetdevCmdRespInfo, r.info),
+					  Q_ARG(signetdev_startup_resp_data, r.startup));
+		break;
+	case SIGNETDEV_CMD_READ_UID:
+		QMetaObject::invokeMethod(receiver, "signetdevReadUIdResp", Qt::DirectConnection,
+					  Q_ARG(signetdevCmdRespInfo, r.info),
+					  Q_ARG(QByteArray, r.data), Q_ARG(QByteArray, r.mask));
+		break;
+	case SIGNETDEV_CMD_READ_CLEARTEXT_PASSWORD_NAMES:
+		QMetaObject::invokeMethod(receiver, "signetdevReadCleartextPasswordNames", Qt::DirectConnection,
+					  Q_ARG(signetdevCmdRespInfo, r.info),
+					  Q_ARG(QVector<int>, r.formats), Q_ARG(QStringList, r.names));
+		break;
+	case SIGNETDEV_CMD_READ_CLEARTEXT_PASSWORD:
+		QMetaObject::invokeMethod(receiver, "signetdevReadCleartextPassword", Qt::DirectConnection,
+					  Q_ARG(signetdevCmdRespInfo, r.info), Q_ARG(cleartext_pass, r.cleartext));
+		break;
+	default:
+		QMetaObject::invokeMethod(receiver, "signetdevCmdResp", Qt::DirectConnection,
+					  Q_ARG(signetdevCmdRespInfo, r.info));
+		break;
+	}
+}
+
+void SignetApplication::emitCommandResp(const commandResp &r)
+{
+	switch(r.info.cmd) {
+	case SIGNETDEV_CMD_READ_ALL_UIDS:
+		signetdevReadAllUIdsResp(r.info, r.uid, r.data, r.mask);
+		break;
+	case SIGNETDEV_CMD_GET_RAND_BITS:
+		signetdevGetRandBits(r.info, r.data);
+		break;
+	case SIGNETDEV_CMD_READ_BLOCK:
+		signetdevReadBlockResp(r.info, r.data);
+		break;
+	case SIGNETDEV_CMD_GET_PROGRESS:
+		signetdevGetProgressResp(r.info, r.progress);
+		break;
+	case SIGNETDEV_CMD_STARTUP:
+		signetdevStartupResp(r.info, r.startup);
+		break;
+	case SIGNETDEV_CMD_READ_UID:
+		signetdevReadUIdResp(r.info, r.data, r.mask);
+		break;
+	case SIGNETDEV_CMD_READ_CLEARTEXT_PASSWORD_NAMES:
+		signetdevReadCleartextPasswordNames(r.info, r.formats, r.names);
+		break;
+	case SIGNETDEV_CMD_READ_CLEARTEXT_PASSWORD:
+		signetdevReadCleartextPassword(r.info, r.cleartext);
+		break;
 	default:
-		this_->signetdevCmdResp(info);
+		signetdevCmdResp(r.info);
 		break;
 	}
 }
 
+bool SignetApplication::event(QEvent *e)
+{
+	if (e->type() == s_commandRespEventType) {
+		const commandResp &r = static_cast<commandRespEvent *>(e)->resp;
+		CommandTracer::dispatched(r.info.token);
+		auto iter = m_responseRoutes.find(r.info.token);
+		if (iter == m_responseRoutes.end()) {
+			emitCommandResp(r);
+		} else {
+			QPointer<QObject> receiver = iter.value();
+			if (!r.info.messages_remaining) {
+				m_responseRoutes.erase(iter);
+			}
+			if (receiver) {
+				deliverCommandResp(receiver, r);
+			}
+		}
+		CommandTracer::handled(r.info.token, r.info.messages_remaining);
+		return true;
+	}
+#ifdef Q_OS_ANDROID
+	return QApplication::event(e);
+#else
+	return QtSingleApplication::event(e);
+#endif
+}
+
 void SignetApplication::startWebsocketServer()
 {
 #ifndef Q_OS_ANDROID
@@ -389,7 +617,7 @@ void SignetApplication::stopWebsocketServer()
 #endif
 }
 
-void SignetApplication::init(bool startInTray, QString dbFilename)
+void SignetApplication::initDeviceApi()
 {
 	signetdev_initialize_api();
 	signetdev_set_device_opened_cb(deviceOpenedS, this);
@@ -397,6 +625,11 @@ void SignetApplication::init(bool startInTray, QString dbFilename)
 	signetdev_set_command_resp_cb(commandRespS, this);
 	signetdev_set_device_event_cb(deviceEventS, this);
 	signetdev_set_error_handler(connectionErrorS, this);
+}
+
+void SignetApplication::init(bool startInTray, QString dbFilename)
+{
+	initDeviceApi();
 
 #ifndef Q_OS_ANDROID
 	m_dbFilename = dbFilename;
@@ -450,6 +683,7 @@ QMessageBox *SignetApplication::messageBoxWarn(const QString &title, const QStri
 
 SignetApplication::~SignetApplication()
 {
+	releaseScryptArena();
 #ifndef Q_OS_ANDROID
 	if (m_systray)
 		delete m_systray;
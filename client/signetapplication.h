@@ -15,10 +15,15 @@ class MainWindow;
 class SignetDeviceManager;
 #endif
 #include <QVector>
+#include <QHash>
+#include <QPointer>
 
 class QMessageBox;
 class QByteArray;
 class QString;
+class QMutex;
+struct crypto_scrypt_arena;
+struct commandResp;
 
 #ifdef WITH_BROWSER_PLUGINS
 class QWebSocketServer;
@@ -66,6 +71,8 @@ class SignetApplication : public QtSingleApplication
 public:
 	SignetApplication(int &argc, char **argv);
 	~SignetApplication();
+	//Register the signetdev callbacks without creating any windows
+	void initDeviceApi();
 	void init(bool startInTray, QString emulateFilename);
 	static QMessageBox *messageBoxError(QMessageBox::Icon icon, const QString &title, const QString &text, QWidget *parent);
 	static QMessageBox *messageBoxWarn(const QString &title, const QString &text, QWidget *parent);
@@ -95,9 +102,17 @@ private:
 	static void deviceOpenedS(enum signetdev_device_type dev_type, void *this_);
 	static void deviceClosedS(void *this_);
 	static void commandRespS(void *cb_param, void *cmd_user_param, int cmd_token, int cmd, int end_device_state, int messages_remaining, int resp_code, const void *resp_data);
+	void emitCommandResp(const commandResp &resp);
+	void deliverCommandResp(QObject *receiver, const commandResp &resp);
+	//Receivers of the commands in flight, by token. Only touched from the
+	//GUI thread.
+	QHash<int, QPointer<QObject> > m_responseRoutes;
 	static void deviceEventS(void *cb_param, int event_type, const void *data, int data_len);
 	static void connectionErrorS(void *cb_param);
-	static void generateScryptKey(const QString &password, QByteArray &key, const QByteArray &salt, unsigned int N, unsigned int r, unsigned int s);
+	static bool generateScryptKey(const QString &password, QByteArray &key, const QByteArray &salt, unsigned int N, unsigned int r, unsigned int s, const volatile int *cancel);
+	//Scratch memory for key derivation, kept mapped between derivations
+	static struct crypto_scrypt_arena *s_scryptArena;
+	static QMutex s_scryptArenaLock;
 	QByteArray m_hashfn;
 	QByteArray m_salt;
 	int m_keyLength;
@@ -248,11 +263,25 @@ public:
 		m_DBFormat = DBFormat;
 	}
 
-	static void generateKey(const QString &password, QByteArray &key, const QByteArray &hashfn, const QByteArray &salt, int keyLength);
+	static bool generateKey(const QString &password, QByteArray &key, const QByteArray &hashfn, const QByteArray &salt, int keyLength, const volatile int *cancel = nullptr);
+	static void wipeKey(QByteArray &key);
+	//Decode the scrypt parameters in hashfn. Returns false for unknown formats
+	static bool scryptParams(const QByteArray &hashfn, unsigned int &N, unsigned int &r, unsigned int &p);
+	//Most scratch memory a single calibration lane will use
+	static qint64 calibrationMemoryLimit();
+	static void releaseScryptArena();
+	static QByteArray calibrateHashfn(int unlockTimeMs);
 	void setAsyncListener(SignetAsyncListener *l);
+	//Deliver the responses to token only to receiver, through its slot
+	//named like the response signal. Call right after issuing a command.
+	//A null receiver drops the responses. Unrouted responses are
+	//broadcast through the signals below.
+	static void routeResponses(int token, QObject *receiver);
 	bool isDeviceEmulated();
 	void startWebsocketServer();
 	void stopWebsocketServer();
+protected:
+	bool event(QEvent *e);
 signals:
 	void deviceOpened(enum signetdev_device_type dev_type);
 	void deviceClosed();
@@ -0,0 +1,164 @@
+#include "signetcommands.h"
+
+extern "C" {
+#include "signetdev/host/signetdev.h"
+}
+
+SignetCommands::SignetCommands(QObject *parent) :
+	QObject(parent)
+{
+}
+
+SignetCommands::~SignetCommands()
+{
+	for (auto iter = m_pending.begin(); iter != m_pending.end(); iter++) {
+		iter->reportCanceled();
+		iter->reportFinished();
+	}
+}
+
+QFuture<signetdevReply> SignetCommands::track(int token)
+{
+	QFutureInterface<signetdevReply> fi;
+	fi.reportStarted();
+	m_pending.insert(token, fi);
+	SignetApplication::routeResponses(token, this);
+	return fi.future();
+}
+
+void SignetCommands::complete(const signetdevCmdRespInfo &info, signetdevReply &reply)
+{
+	auto iter = m_pending.find(info.token);
+	if (iter == m_pending.end()) {
+		return;
+	}
+	reply.respCode = info.resp_code;
+	reply.endDeviceState = info.end_device_state;
+	iter->reportResult(reply);
+	if (!info.messages_remaining) {
+		iter->reportFinished();
+		m_pending.erase(iter);
+	}
+}
+
+QFuture<signetdevReply> SignetCommands::readBlock(int idx)
+{
+	int token;
+	::signetdev_read_block(nullptr, &token, idx);
+	return track(token);
+}
+
+QFuture<signetdevReply> SignetCommands::writeBlock(int idx, const QByteArray &block)
+{
+	int token;
+	QByteArray data(block);
+	::signetdev_write_block(nullptr, &token, idx, data.data());
+	return track(token);
+}
+
+QFuture<signetdevReply> SignetCommands::readUId(int uid, bool masked)
+{
+	int token;
+	::signetdev_read_uid(nullptr, &token, uid, masked ? 1 : 0);
+	return track(token);
+}
+
+QFuture<signetdevReply> SignetCommands::updateUId(int uid, const QByteArray &data, const QByteArray &mask)
+{
+	int token;
+	::signetdev_update_uid(nullptr, &token, uid,
+			       data.size(),
+			       (const u8 *)data.data(),
+			       (const u8 *)mask.data());
+	return track(token);
+}
+
+QFuture<signetdevReply> SignetCommands::updateUIds(int uid, const QByteArray &data, const QByteArray &mask, int entriesRemaining)
+{
+	int token;
+	::signetdev_update_uids(nullptr, &token, uid,
+				data.size(),
+				(const u8 *)data.data(),
+				(const u8 *)mask.data(),
+				entriesRemaining);
+	return track(token);
+}
+
+QFuture<signetdevReply> SignetCommands::readAllUIds(bool masked)
+{
+	int token;
+	::signetdev_read_all_uids(nullptr, &token, masked ? 1 : 0);
+	return track(token);
+}
+
+QFuture<signetdevReply> SignetCommands::getRandBits(int count)
+{
+	int token;
+	::signetdev_get_rand_bits(nullptr, &token, count);
+	return track(token);
+}
+
+QFuture<signetdevReply> SignetCommands::beginDeviceBackup()
+{
+	int token;
+	::signetdev_begin_device_backup(nullptr, &token);
+	return track(token);
+}
+
+QFuture<signetdevReply> SignetCommands::endDeviceBackup()
+{
+	int token;
+	::signetdev_end_device_backup(nullptr, &token);
+	return track(token);
+}
+
+QFuture<signetdevReply> SignetCommands::beginDeviceRestore()
+{
+	int token;
+	::signetdev_begin_device_restore(nullptr, &token);
+	return track(token);
+}
+
+QFuture<signetdevReply> SignetCommands::endDeviceRestore()
+{
+	int token;
+	::signetdev_end_device_restore(nullptr, &token);
+	return track(token);
+}
+
+void SignetCommands::signetdevCmdResp(signetdevCmdRespInfo info)
+{
+	signetdevReply reply;
+	complete(info, reply);
+}
+
+void SignetCommands::signetdevReadBlockResp(signetdevCmdRespInfo info, QByteArray block)
+{
+	signetdevReply reply;
+	reply.data = block;
+	complete(info, reply);
+}
+
+void SignetCommands::signetdevReadUIdResp(signetdevCmdRespInfo info, QByteArray data, QByteArray mask)
+{
+	signetdevReply reply;
+	reply.data = data;
+	reply.mask = mask;
+	complete(info, reply);
+}
+
+void SignetCommands::signetdevReadAllUIdsResp(signetdevCmdRespInfo info, int uid, QByteArray data, QByteArray mask)
+{
+	signetdevReply reply;
+	reply.uid = uid;
+	reply.data = data;
+	reply.mask = mask;
+	complete(info, reply);
+}
+
+void SignetCommands::signetdevGetRandBits(signetdevCmdRespInfo info, QByteArray block)
+{
+	signetdevReply reply;
+	reply.data = block;
+	complete(info, reply);
+}
@@ -0,0 +1,72 @@
+#ifndef SIGNETCOMMANDS_H
+#define SIGNETCOMMANDS_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QFuture>
+#include <QFutureInterface>
+#include <QHash>
+
+#include "signetapplication.h"
+
+//
+// One response message from the device. uid is only set by readAllUIds()
+// and data/mask only by commands that return them.
+//
+struct signetdevReply {
+	int respCode;
+	int endDeviceState;
+	int uid;
+	QByteArray data;
+	QByteArray mask;
+	signetdevReply() :
+		respCode(-1),
+		endDeviceState(0),
+		uid(-1)
+	{
+	}
+};
+
+//
+// Issues signetdev commands and returns a QFuture for each one instead of a
+// token, so callers don't need a token member and a response slot per
+// command. Any number of commands can be in flight at once. The future
+// finishes with a single reply, except for readAllUIds() which reports one
+// reply per entry. Watch the futures with QFutureWatcher, since they finish
+// on the GUI thread. Futures still pending when the object is destroyed are
+// canceled.
+//
+class SignetCommands : public QObject
+{
+	Q_OBJECT
+	QHash<int, QFutureInterface<signetdevReply> > m_pending;
+	QFuture<signetdevReply> track(int token);
+	void complete(const signetdevCmdRespInfo &info, signetdevReply &reply);
+public:
+	explicit SignetCommands(QObject *parent = nullptr);
+	~SignetCommands();
+	int pendingCount() const
+	{
+		return m_pending.size();
+	}
+	QFuture<signetdevReply> readBlock(int idx);
+	QFuture<signetdevReply> writeBlock(int idx, const QByteArray &block);
+	QFuture<signetdevReply> readUId(int uid, bool masked);
+	QFuture<signetdevReply> updateUId(int uid, const QByteArray &data, const QByteArray &mask);
+	//Batched update, entriesRemaining counts the updates still to come
+	QFuture<signetdevReply> updateUIds(int uid, const QByteArray &data, const QByteArray &mask, int entriesRemaining);
+	QFuture<signetdevReply> readAllUIds(bool masked);
+	QFuture<signetdevReply> getRandBits(int count);
+	QFuture<signetdevReply> beginDeviceBackup();
+	QFuture<signetdevReply> endDeviceBackup();
+	QFuture<signetdevReply> beginDeviceRestore();
+	QFuture<signetdevReply> endDeviceRestore();
+private slots:
+	void signetdevCmdResp(signetdevCmdRespInfo info);
+	void signetdevReadBlockResp(signetdevCmdRespInfo info, QByteArray block);
+	void signetdevReadUIdResp(signetdevCmdRespInfo info, QByteArray data, QByteArray mask);
+	void signetdevReadAllUIdsResp(signetdevCmdRespInfo info, int uid, QByteArray data, QByteArray mask);
+	void signetdevGetRandBits(signetdevCmdRespInfo info, QByteArray block);
+};
+
+#endif // SIGNETCOMMANDS_H
@@ -31,6 +31,10 @@
 #include <sys/types.h>
 #ifndef _WIN32
 #include <sys/mman.h>
+#include <pthread.h>
+#include <unistd.h>
+#else
+#include <windows.h>
 #endif
 
 #include <errno.h>
@@ -38,34 +42,266 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "insecure_memzero.h"
 #include "sha256.h"
 #include "warnp.h"
 
 #include "crypto_scrypt_smix.h"
 #include "crypto_scrypt_smix_sse2.h"
+#include "crypto_scrypt_smix_avx2.h"
 
 #include "crypto_scrypt.h"
 
+/*
+ * Only the client build (qmake defines QT_CORE_LIB) has Qt on the include
+ * path; platform checks here use compiler macros so the benchmarks in this
+ * directory build with a plain C compiler.
+ */
+#ifdef QT_CORE_LIB
 #include <QtCore/qsystemdetection.h>
+#endif
+
+static void (*smix_func)(uint8_t *, size_t, uint64_t, void *, void *,
+    const volatile int *) = NULL;
+
+/*
+ * Scratch memory (B, and V and XY for each worker) is carved out of an
+ * arena.  An arena keeps its mapping between derivations so that repeated
+ * derivations don't pay for fresh page faults; it is wiped after each use
+ * and again before it is unmapped.
+ */
+struct crypto_scrypt_arena {
+	void * base;
+	size_t size;
+	size_t used;
+};
+
+#if !defined(MAP_ANON) && defined(MAP_ANONYMOUS)
+#define MAP_ANON MAP_ANONYMOUS
+#endif
+
+#define ARENA_HUGE_PAGE_SIZE ((size_t)2 * 1024 * 1024)
+
+/**
+ * arena_map(len):
+ * Map ${len} bytes of zeroed, 64-byte aligned memory, preferring huge pages.
+ * Return NULL on error.
+ */
+static void *
+arena_map(size_t len)
+{
+	void * p;
+
+#ifdef _WIN32
+	p = VirtualAlloc(NULL, len, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+#else
+#ifdef MAP_HUGETLB
+	/* Explicit huge pages, if the administrator has reserved any. */
+	if ((len % ARENA_HUGE_PAGE_SIZE) == 0) {
+		p = mmap(NULL, len, PROT_READ | PROT_WRITE,
+		    MAP_ANON | MAP_PRIVATE | MAP_HUGETLB, -1, 0);
+		if (p != MAP_FAILED)
+			goto mapped;
+	}
+#endif
+	p = mmap(NULL, len, PROT_READ | PROT_WRITE,
+#ifdef MAP_NOCORE
+	    MAP_ANON | MAP_PRIVATE | MAP_NOCORE,
+#else
+	    MAP_ANON | MAP_PRIVATE,
+#endif
+	    -1, 0);
+	if (p == MAP_FAILED)
+		return (NULL);
+#ifdef MADV_HUGEPAGE
+	/* Otherwise ask for transparent huge pages. */
+	(void)madvise(p, len, MADV_HUGEPAGE);
+#endif
+#ifdef MAP_HUGETLB
+mapped:
+#endif
+#ifdef MADV_DONTDUMP
+	(void)madvise(p, len, MADV_DONTDUMP);
+#endif
+#endif
+	return (p);
+}
+
+static void
+arena_unmap(void * p, size_t len)
+{
+
+#ifdef _WIN32
+	(void)len;
+	VirtualFree(p, 0, MEM_RELEASE);
+#else
+	munmap(p, len);
+#endif
+}
+
+/**
+ * crypto_scrypt_arena_init(void):
+ * Return a new, empty scratch arena or NULL on error.
+ */
+struct crypto_scrypt_arena *
+crypto_scrypt_arena_init(void)
+{
+
+	return (calloc(1, sizeof(struct crypto_scrypt_arena)));
+}
+
+/**
+ * crypto_scrypt_arena_free(arena):
+ * Wipe and unmap the scratch memory held by ${arena} and free it.
+ */
+void
+crypto_scrypt_arena_free(struct crypto_scrypt_arena * arena)
+{
+
+	if (arena == NULL)
+		return;
+	if (arena->base != NULL) {
+		insecure_memzero(arena->base, arena->used);
+		arena_unmap(arena->base, arena->size);
+	}
+	free(arena);
+}
+
+/**
+ * arena_reserve(arena, len):
+ * Make sure ${arena} holds at least ${len} bytes.  Return 0 on success or
+ * -1 on error.
+ */
+static int
+arena_reserve(struct crypto_scrypt_arena * arena, size_t len)
+{
+	void * p;
+
+	if (arena->size >= len)
+		return (0);
+	if (len > SIZE_MAX - ARENA_HUGE_PAGE_SIZE) {
+		errno = ENOMEM;
+		return (-1);
+	}
+	if (len >= ARENA_HUGE_PAGE_SIZE)
+		len = (len + ARENA_HUGE_PAGE_SIZE - 1) &
+		    ~(ARENA_HUGE_PAGE_SIZE - 1);
+	if ((p = arena_map(len)) == NULL) {
+		errno = ENOMEM;
+		return (-1);
+	}
+	if (arena->base != NULL) {
+		insecure_memzero(arena->base, arena->used);
+		arena_unmap(arena->base, arena->size);
+	}
+	arena->base = p;
+	arena->size = len;
+	arena->used = 0;
+	return (0);
+}
+
+/*
+ * The p smix lanes are independent.  Up to SCRYPT_MAX_THREADS of them are
+ * computed at once, each worker with its own V and XY and taking lanes
+ * first, first + stride, ...
+ */
+
+struct smix_worker {
+	uint8_t * B;
+	size_t r;
+	uint64_t N;
+	size_t p;
+	size_t first;
+	size_t stride;
+	void * V;
+	void * XY;
+	void (*smix)(uint8_t *, size_t, uint64_t, void *, void *,
+	    const volatile int *);
+	const volatile int * cancel;
+#ifdef _WIN32
+	HANDLE thread;
+#else
+	pthread_t thread;
+#endif
+	int threaded;
+};
+
+static void
+smix_lanes(struct smix_worker * w)
+{
+	size_t i;
+
+	/* 2: for i = 0 to p - 1 do */
+	for (i = w->first; i < w->p; i += w->stride) {
+		if ((w->cancel != NULL) && *w->cancel)
+			break;
+
+		/* 3: B_i <-- MF(B_i, N) */
+		(w->smix)(&w->B[i * 128 * w->r], w->r, w->N, w->V, w->XY,
+		    w->cancel);
+	}
+}
 
-static void (*smix_func)(uint8_t *, size_t, uint64_t, void *, void *) = NULL;
+#ifdef _WIN32
+static DWORD WINAPI
+smix_thread(LPVOID cookie)
+{
+
+	smix_lanes((struct smix_worker *)cookie);
+	return (0);
+}
+#else
+static void *
+smix_thread(void * cookie)
+{
+
+	smix_lanes((struct smix_worker *)cookie);
+	return (NULL);
+}
+#endif
+
+static size_t
+smix_thread_count(size_t p)
+{
+	long ncpu;
+#ifdef _WIN32
+	SYSTEM_INFO si;
+
+	GetSystemInfo(&si);
+	ncpu = si.dwNumberOfProcessors;
+#elif defined(_SC_NPROCESSORS_ONLN)
+	ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+#else
+	ncpu = 1;
+#endif
+	if (ncpu < 1)
+		ncpu = 1;
+	if (ncpu > SCRYPT_MAX_THREADS)
+		ncpu = SCRYPT_MAX_THREADS;
+	return ((size_t)ncpu < p ? (size_t)ncpu : p);
+}
 
 /**
- * _crypto_scrypt(passwd, passwdlen, salt, saltlen, N, r, p, buf, buflen, smix):
- * Perform the requested scrypt computation, using ${smix} as the smix routine.
+ * _crypto_scrypt(arena, cancel, passwd, passwdlen, salt, saltlen, N, r, p,
+ *     buf, buflen, smix):
+ * Perform the requested scrypt computation, using ${smix} as the smix routine
+ * and ${arena} for scratch memory.  If ${cancel} is not NULL, give up once
+ * *${cancel} becomes nonzero.
  */
 static int
-_crypto_scrypt(const uint8_t * passwd, size_t passwdlen,
+_crypto_scrypt(struct crypto_scrypt_arena * arena, const volatile int * cancel,
+    const uint8_t * passwd, size_t passwdlen,
     const uint8_t * salt, size_t saltlen, uint64_t N, uint32_t _r, uint32_t _p,
     uint8_t * buf, size_t buflen,
-    void (*smix)(uint8_t *, size_t, uint64_t, void *, void *))
+    void (*smix)(uint8_t *, size_t, uint64_t, void *, void *,
+    const volatile int *))
 {
-	void * B0, * V0, * XY0;
+	struct smix_worker workers[SCRYPT_MAX_THREADS];
 	uint8_t * B;
-	uint32_t * V;
-	uint32_t * XY;
+	uint8_t * scratch;
 	size_t r = _r, p = _p;
-	uint32_t i;
+	size_t nworkers, i;
+	size_t Blen, XYlen, Vlen;
 
 	/* Sanity-check parameters. */
 #if SIZE_MAX > UINT32_MAX
@@ -90,74 +326,91 @@ _crypto_scrypt(const uint8_t * passwd, size_t passwdlen,
 		errno = ENOMEM;
 		goto err0;
 	}
+	Blen = 128 * r * p;
+	XYlen = 256 * r + 64;
+	Vlen = 128 * r * N;
 
-	/* Allocate memory. */
-#ifdef HAVE_POSIX_MEMALIGN
-	if ((errno = posix_memalign(&B0, 64, 128 * r * p)) != 0)
+	/*
+	 * Reserve scratch memory, giving up on parallel lanes one at a time
+	 * if there isn't room for all of them.
+	 */
+	for (nworkers = smix_thread_count(p); nworkers > 0; nworkers--) {
+		if ((Vlen + XYlen) > (SIZE_MAX - Blen) / nworkers) {
+			errno = ENOMEM;
+			continue;
+		}
+		if (!arena_reserve(arena, Blen + nworkers * (Vlen + XYlen)))
+			break;
+	}
+	if (nworkers == 0)
 		goto err0;
-	B = (uint8_t *)(B0);
-	if ((errno = posix_memalign(&XY0, 64, 256 * r + 64)) != 0)
-		goto err1;
-	XY = (uint32_t *)(XY0);
-#if !defined(MAP_ANON) || !defined(HAVE_MMAP)
-	if ((errno = posix_memalign(&V0, 64, 128 * r * N)) != 0)
-		goto err2;
-	V = (uint32_t *)(V0);
-#endif
+	arena->used = Blen + nworkers * (Vlen + XYlen);
+
+	/* All of the lengths are multiples of 64. */
+	B = arena->base;
+	scratch = B + Blen;
+	for (i = 0; i < nworkers; i++) {
+		workers[i].B = B;
+		workers[i].r = r;
+		workers[i].N = N;
+		workers[i].p = p;
+		workers[i].first = i;
+		workers[i].stride = nworkers;
+		workers[i].smix = smix;
+		workers[i].cancel = cancel;
+		workers[i].threaded = 0;
+		workers[i].V = scratch;
+		workers[i].XY = scratch + Vlen;
+		scratch += Vlen + XYlen;
+	}
+
+	/* 1: (B_0 ... B_{p-1}) <-- PBKDF2(P, S, 1, p * MFLen) */
+	PBKDF2_SHA256(passwd, passwdlen, salt, saltlen, 1, B, p * 128 * r);
+
+	/*
+	 * Lanes that can't get a thread are computed on the calling thread,
+	 * as is the first worker's share.
+	 */
+	for (i = 1; i < nworkers; i++) {
+#ifdef _WIN32
+		workers[i].thread = CreateThread(NULL, 0, smix_thread,
+		    &workers[i], 0, NULL);
+		workers[i].threaded = (workers[i].thread != NULL);
 #else
-	if ((B0 = malloc(128 * r * p + 63)) == NULL)
-		goto err0;
-	B = (uint8_t *)(((uintptr_t)(B0) + 63) & ~ (uintptr_t)(63));
-	if ((XY0 = malloc(256 * r + 64 + 63)) == NULL)
-		goto err1;
-	XY = (uint32_t *)(((uintptr_t)(XY0) + 63) & ~ (uintptr_t)(63));
-#if !defined(MAP_ANON) || !defined(HAVE_MMAP)
-	if ((V0 = malloc(128 * r * N + 63)) == NULL)
-		goto err2;
-	V = (uint32_t *)(((uintptr_t)(V0) + 63) & ~ (uintptr_t)(63));
-#endif
+		workers[i].threaded = !pthread_create(&workers[i].thread, NULL,
+		    smix_thread, &workers[i]);
 #endif
-#if defined(MAP_ANON) && defined(HAVE_MMAP)
-	if ((V0 = mmap(NULL, 128 * r * N, PROT_READ | PROT_WRITE,
-#ifdef MAP_NOCORE
-	    MAP_ANON | MAP_PRIVATE | MAP_NOCORE,
+	}
+	smix_lanes(&workers[0]);
+	for (i = 1; i < nworkers; i++) {
+		if (workers[i].threaded) {
+#ifdef _WIN32
+			WaitForSingleObject(workers[i].thread, INFINITE);
+			CloseHandle(workers[i].thread);
 #else
-	    MAP_ANON | MAP_PRIVATE,
-#endif
-	    -1, 0)) == MAP_FAILED)
-		goto err2;
-	V = (uint32_t *)(V0);
+			pthread_join(workers[i].thread, NULL);
 #endif
+		} else {
+			smix_lanes(&workers[i]);
+		}
+	}
 
-	/* 1: (B_0 ... B_{p-1}) <-- PBKDF2(P, S, 1, p * MFLen) */
-	PBKDF2_SHA256(passwd, passwdlen, salt, saltlen, 1, B, p * 128 * r);
-
-	/* 2: for i = 0 to p - 1 do */
-	for (i = 0; i < p; i++) {
-		/* 3: B_i <-- MF(B_i, N) */
-		(smix)(&B[i * 128 * r], r, N, V, XY);
+	/* A canceled derivation leaves nothing behind but wiped memory. */
+	if ((cancel != NULL) && *cancel) {
+		insecure_memzero(arena->base, arena->used);
+		errno = ECANCELED;
+		goto err0;
 	}
 
 	/* 5: DK <-- PBKDF2(P, B, 1, dkLen) */
 	PBKDF2_SHA256(passwd, passwdlen, B, p * 128 * r, 1, buf, buflen);
 
-	/* Free memory. */
-#if defined(MAP_ANON) && defined(HAVE_MMAP)
-	if (munmap(V0, 128 * r * N))
-		goto err2;
-#else
-	free(V0);
-#endif
-	free(XY0);
-	free(B0);
+	/* Wipe the scratch memory but keep it mapped for the next call. */
+	insecure_memzero(arena->base, arena->used);
 
 	/* Success! */
 	return (0);
 
-err2:
-	free(XY0);
-err1:
-	free(B0);
 err0:
 	/* Failure! */
 	return (-1);
@@ -190,15 +443,22 @@ static struct scrypt_test {
 };
 
 static int
-testsmix(void (*smix)(uint8_t *, size_t, uint64_t, void *, void *))
+testsmix(void (*smix)(uint8_t *, size_t, uint64_t, void *, void *,
+    const volatile int *))
 {
+	struct crypto_scrypt_arena * arena;
 	uint8_t hbuf[TESTLEN];
+	int rc;
 
 	/* Perform the computation. */
-	if (_crypto_scrypt(
+	if ((arena = crypto_scrypt_arena_init()) == NULL)
+		return (-1);
+	rc = _crypto_scrypt(arena, NULL,
 	    (const uint8_t *)testcase.passwd, strlen(testcase.passwd),
 	    (const uint8_t *)testcase.salt, strlen(testcase.salt),
-	    testcase.N, testcase.r, testcase.p, hbuf, TESTLEN, smix))
+	    testcase.N, testcase.r, testcase.p, hbuf, TESTLEN, smix);
+	crypto_scrypt_arena_free(arena);
+	if (rc)
 		return (-1);
 
 	/* Does it match? */
@@ -210,6 +470,17 @@ selectsmix(void)
 {
 
 #ifdef USE_SSE
+	/* If we're running on an AVX2-capable CPU, try that code. */
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) {
+		/* If AVX2ized smix works, use it. */
+		if (!testsmix(crypto_scrypt_smix_avx2)) {
+			smix_func = crypto_scrypt_smix_avx2;
+			return;
+		}
+		warn0("Disabling broken AVX2 scrypt support - please report bug!");
+	}
+
 //#ifdef CPUSUPPORT_X86_SSE2
 	/* If we're running on an SSE2-capable CPU, try that code. */
 	//if (cpusupport_x86_sse2()) {
@@ -233,6 +504,38 @@ selectsmix(void)
 	abort();
 }
 
+/*
+ * Derivations may run on several threads at once, so the smix routine is
+ * selected exactly once and the other callers wait for it.
+ */
+#ifdef _WIN32
+static INIT_ONCE smix_once = INIT_ONCE_STATIC_INIT;
+
+static BOOL CALLBACK
+selectsmix_once(PINIT_ONCE once, PVOID param, PVOID * context)
+{
+
+	(void)once;
+	(void)param;
+	(void)context;
+	selectsmix();
+	return (TRUE);
+}
+#else
+static pthread_once_t smix_once = PTHREAD_ONCE_INIT;
+#endif
+
+static void
+initsmix(void)
+{
+
+#ifdef _WIN32
+	InitOnceExecuteOnce(&smix_once, selectsmix_once, NULL, NULL);
+#else
+	pthread_once(&smix_once, selectsmix);
+#endif
+}
+
 /**
  * crypto_scrypt(passwd, passwdlen, salt, saltlen, N, r, p, buf, buflen):
  * Compute scrypt(passwd[0 .. passwdlen - 1], salt[0 .. saltlen - 1], N, r,
@@ -248,9 +551,52 @@ crypto_scrypt(const uint8_t * passwd, size_t passwdlen,
     uint8_t * buf, size_t buflen)
 {
 
-	if (smix_func == NULL)
-		selectsmix();
+	struct crypto_scrypt_arena * arena;
+	int rc;
+
+	if ((arena = crypto_scrypt_arena_init()) == NULL)
+		return (-1);
+	rc = crypto_scrypt_arena(arena, passwd, passwdlen, salt, saltlen,
+	    N, _r, _p, buf, buflen);
+	crypto_scrypt_arena_free(arena);
+	return (rc);
+}
+
+/**
+ * crypto_scrypt_arena(arena, passwd, passwdlen, salt, saltlen, N, r, p, buf,
+ *     buflen):
+ * As crypto_scrypt, but take scratch memory from ${arena}, growing it if
+ * needed.  The arena is wiped before returning but stays mapped so that it
+ * can be reused by later calls.  An arena must not be used by two calls at
+ * once.
+ */
+int
+crypto_scrypt_arena(struct crypto_scrypt_arena * arena,
+    const uint8_t * passwd, size_t passwdlen,
+    const uint8_t * salt, size_t saltlen, uint64_t N, uint32_t _r, uint32_t _p,
+    uint8_t * buf, size_t buflen)
+{
+
+	return (crypto_scrypt_arena_cancelable(arena, NULL, passwd, passwdlen,
+	    salt, saltlen, N, _r, _p, buf, buflen));
+}
+
+/**
+ * crypto_scrypt_arena_cancelable(arena, cancel, passwd, passwdlen, salt,
+ *     saltlen, N, r, p, buf, buflen):
+ * As crypto_scrypt_arena, but check *${cancel} as the computation runs and
+ * give up soon after it becomes nonzero, returning -1 with errno set to
+ * ECANCELED.  The arena is wiped and ${buf} is left untouched in that case.
+ */
+int
+crypto_scrypt_arena_cancelable(struct crypto_scrypt_arena * arena,
+    const volatile int * cancel, const uint8_t * passwd, size_t passwdlen,
+    const uint8_t * salt, size_t saltlen, uint64_t N, uint32_t _r, uint32_t _p,
+    uint8_t * buf, size_t buflen)
+{
+
+	initsmix();
 
-	return (_crypto_scrypt(passwd, passwdlen, salt, saltlen, N, _r, _p,
-	    buf, buflen, smix_func));
+	return (_crypto_scrypt(arena, cancel, passwd, passwdlen, salt, saltlen,
+	    N, _r, _p, buf, buflen, smix_func));
 }
@@ -32,6 +32,12 @@
 #include <stdint.h>
 #include <unistd.h>
 
+/*
+ * Most smix lanes a single derivation computes in parallel, each with its
+ * own V and XY scratch memory.
+ */
+#define SCRYPT_MAX_THREADS 16
+
 /**
  * crypto_scrypt(passwd, passwdlen, salt, saltlen, N, r, p, buf, buflen):
  * Compute scrypt(passwd[0 .. passwdlen - 1], salt[0 .. saltlen - 1], N, r,
@@ -44,4 +50,42 @@
 int crypto_scrypt(const uint8_t *, size_t, const uint8_t *, size_t, uint64_t,
     uint32_t, uint32_t, uint8_t *, size_t);
 
+struct crypto_scrypt_arena;
+
+/**
+ * crypto_scrypt_arena_init(void):
+ * Return a new, empty scratch arena for crypto_scrypt_arena or NULL on
+ * error.  Scratch memory is mapped on first use, using huge pages where the
+ * platform provides them.
+ */
+struct crypto_scrypt_arena * crypto_scrypt_arena_init(void);
+
+/**
+ * crypto_scrypt_arena_free(arena):
+ * Wipe and unmap the scratch memory held by ${arena} and free it.
+ */
+void crypto_scrypt_arena_free(struct crypto_scrypt_arena *);
+
+/**
+ * crypto_scrypt_arena(arena, passwd, passwdlen, salt, saltlen, N, r, p, buf,
+ *     buflen):
+ * As crypto_scrypt, but take scratch memory from ${arena}, growing it if
+ * needed.  The arena is wiped before returning but stays mapped so that it
+ * can be reused by later calls.  An arena must not be used by two calls at
+ * once.
+ */
+int crypto_scrypt_arena(struct crypto_scrypt_arena *, const uint8_t *, size_t,
+    const uint8_t *, size_t, uint64_t, uint32_t, uint32_t, uint8_t *, size_t);
+
+/**
+ * crypto_scrypt_arena_cancelable(arena, cancel, passwd, passwdlen, salt,
+ *     saltlen, N, r, p, buf, buflen):
+ * As crypto_scrypt_arena, but check *${cancel} as the computation runs and
+ * give up soon after it becomes nonzero, returning -1 with errno set to
+ * ECANCELED.  The arena is wiped and ${buf} is left untouched in that case.
+ */
+int crypto_scrypt_arena_cancelable(struct crypto_scrypt_arena *,
+    const volatile int *, const uint8_t *, size_t, const uint8_t *, size_t,
+    uint64_t, uint32_t, uint32_t, uint8_t *, size_t);
+
 #endif /* !_CRYPTO_SCRYPT_H_ */
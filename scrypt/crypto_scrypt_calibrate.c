@@ -0,0 +1,128 @@
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#include <errno.h>
+#include <stdint.h>
+
+#include "crypto_scrypt.h"
+#include "insecure_memzero.h"
+
+#include "crypto_scrypt_calibrate.h"
+
+/* Wall-clock time in seconds from an arbitrary origin. */
+static double
+now(void)
+{
+#ifdef _WIN32
+	LARGE_INTEGER count, freq;
+
+	QueryPerformanceCounter(&count);
+	QueryPerformanceFrequency(&freq);
+	return ((double)count.QuadPart / (double)freq.QuadPart);
+#else
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (ts.tv_sec + ts.tv_nsec / 1e9);
+#endif
+}
+
+/**
+ * crypto_scrypt_bench(arena, logN, r, p, seconds):
+ * Time one derivation with N = 2^${logN}, ${r} and ${p} using scratch memory
+ * from ${arena} and store the wall-clock time it took in ${seconds}.  Return
+ * 0 on success or -1 on error.
+ */
+int
+crypto_scrypt_bench(struct crypto_scrypt_arena * arena, int logN,
+    uint32_t r, uint32_t p, double * seconds)
+{
+	static const uint8_t passwd[] = "calibrate";
+	uint8_t salt[32] = { 0 };
+	uint8_t buf[32];
+	double start;
+	int rc;
+
+	if ((logN < 1) || (logN > 62)) {
+		errno = EINVAL;
+		return (-1);
+	}
+
+	start = now();
+	rc = crypto_scrypt_arena(arena, passwd, sizeof(passwd) - 1,
+	    salt, sizeof(salt), (uint64_t)1 << logN, r, p, buf, sizeof(buf));
+	*seconds = now() - start;
+	insecure_memzero(buf, sizeof(buf));
+
+	return (rc);
+}
+
+/**
+ * crypto_scrypt_calibrate(arena, maxtime, maxmem, r, logN, p):
+ * Pick the strongest parameters with block size ${r} whose derivation takes
+ * at most ${maxtime} seconds on this machine, using at most ${maxmem} bytes
+ * of scratch memory per lane.  On entry ${logN} holds the smallest log2(N)
+ * to consider; it is raised as far as the time and memory budgets allow.  If
+ * memory runs out first, the remaining time is spent on ${p}, counting lanes
+ * as though they ran one after another so that the choice holds on machines
+ * with a single core.  Return 0 on success or -1 on error.
+ */
+int
+crypto_scrypt_calibrate(struct crypto_scrypt_arena * arena, double maxtime,
+    size_t maxmem, uint32_t r, int * logN, uint32_t * p)
+{
+	int memlogN, maxlogN, n;
+	double t, tn;
+	double lanes;
+	uint64_t mem;
+
+	if ((r == 0) || (r >= (1 << 30))) {
+		errno = EINVAL;
+		return (-1);
+	}
+
+	/* Largest N whose V (128 * r * N bytes) fits in the memory budget. */
+	mem = ((uint64_t)128 * r) << *logN;
+	for (memlogN = *logN; (memlogN < 62) && (mem <= maxmem / 2); memlogN++)
+		mem *= 2;
+	maxlogN = memlogN;
+
+	if (crypto_scrypt_bench(arena, *logN, r, 1, &t))
+		return (-1);
+
+	/*
+	 * Time doubles with N, so jump straight to the largest N the last
+	 * measurement predicts will fit and measure there.  Cache effects make
+	 * the prediction optimistic at large N; if it overshoots, lower the
+	 * ceiling and try again from the last N known to fit.
+	 */
+	while (*logN < maxlogN) {
+		for (n = *logN, tn = t; (n < maxlogN) && (tn * 2 <= maxtime); n++)
+			tn *= 2;
+		if (n == *logN)
+			break;
+		if (crypto_scrypt_bench(arena, n, r, 1, &tn))
+			return (-1);
+		if (tn > maxtime) {
+			maxlogN = n - 1;
+		} else {
+			*logN = n;
+			t = tn;
+		}
+	}
+
+	/* Spend whatever time memory left unused on more lanes. */
+	*p = 1;
+	if ((*logN == memlogN) && (t > 0)) {
+		lanes = maxtime / t;
+		if (lanes > (double)((1 << 30) / r - 1))
+			lanes = (double)((1 << 30) / r - 1);
+		if (lanes > 1)
+			*p = (uint32_t)lanes;
+	}
+
+	return (0);
+}
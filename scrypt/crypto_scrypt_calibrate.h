@@ -0,0 +1,31 @@
+#ifndef _CRYPTO_SCRYPT_CALIBRATE_H_
+#define _CRYPTO_SCRYPT_CALIBRATE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct crypto_scrypt_arena;
+
+/**
+ * crypto_scrypt_bench(arena, logN, r, p, seconds):
+ * Time one derivation with N = 2^${logN}, ${r} and ${p} using scratch memory
+ * from ${arena} and store the wall-clock time it took in ${seconds}.  Return
+ * 0 on success or -1 on error.
+ */
+int crypto_scrypt_bench(struct crypto_scrypt_arena *, int, uint32_t, uint32_t,
+    double *);
+
+/**
+ * crypto_scrypt_calibrate(arena, maxtime, maxmem, r, logN, p):
+ * Pick the strongest parameters with block size ${r} whose derivation takes
+ * at most ${maxtime} seconds on this machine, using at most ${maxmem} bytes
+ * of scratch memory per lane.  On entry ${logN} holds the smallest log2(N)
+ * to consider; it is raised as far as the time and memory budgets allow.  If
+ * memory runs out first, the remaining time is spent on ${p}, counting lanes
+ * as though they ran one after another so that the choice holds on machines
+ * with a single core.  Return 0 on success or -1 on error.
+ */
+int crypto_scrypt_calibrate(struct crypto_scrypt_arena *, double, size_t,
+    uint32_t, int *, uint32_t *);
+
+#endif /* !_CRYPTO_SCRYPT_CALIBRATE_H_ */
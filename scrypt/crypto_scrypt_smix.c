@@ -155,15 +155,17 @@ integerify(const void * B, size_t r)
 }
 
 /**
- * crypto_scrypt_smix(B, r, N, V, XY):
+ * crypto_scrypt_smix(B, r, N, V, XY, cancel):
  * Compute B = SMix_r(B, N).  The input B must be 128r bytes in length;
  * the temporary storage V must be 128rN bytes in length; the temporary
  * storage XY must be 256r + 64 bytes in length.  The value N must be a
  * power of 2 greater than 1.  The arrays B, V, and XY must be aligned to a
- * multiple of 64 bytes.
+ * multiple of 64 bytes.  If ${cancel} is not NULL, give up early, leaving B
+ * undefined, once *${cancel} becomes nonzero.
  */
 void
-crypto_scrypt_smix(uint8_t * B, size_t r, uint64_t N, void * _V, void * XY)
+crypto_scrypt_smix(uint8_t * B, size_t r, uint64_t N, void * _V, void * XY,
+    const volatile int * cancel)
 {
 	uint32_t * X = XY;
 	uint32_t * Y = (void *)((uint8_t *)(XY) + 128 * r);
@@ -179,6 +181,9 @@ crypto_scrypt_smix(uint8_t * B, size_t r, uint64_t N, void * _V, void * XY)
 
 	/* 2: for i = 0 to N - 1 do */
 	for (i = 0; i < N; i += 2) {
+		if ((cancel != NULL) && *cancel)
+			return;
+
 		/* 3: V_i <-- X */
 		blkcpy(&V[i * (32 * r)], X, 128 * r);
 
@@ -194,6 +199,9 @@ crypto_scrypt_smix(uint8_t * B, size_t r, uint64_t N, void * _V, void * XY)
 
 	/* 6: for i = 0 to N - 1 do */
 	for (i = 0; i < N; i += 2) {
+		if ((cancel != NULL) && *cancel)
+			return;
+
 		/* 7: j <-- Integerify(X) mod N */
 		j = integerify(X, r) & (N - 1);
 
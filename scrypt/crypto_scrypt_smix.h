@@ -2,13 +2,15 @@
 #define _CRYPTO_SCRYPT_SMIX_H_
 
 /**
- * crypto_scrypt_smix(B, r, N, V, XY):
+ * crypto_scrypt_smix(B, r, N, V, XY, cancel):
  * Compute B = SMix_r(B, N).  The input B must be 128r bytes in length;
  * the temporary storage V must be 128rN bytes in length; the temporary
  * storage XY must be 256r + 64 bytes in length.  The value N must be a
  * power of 2 greater than 1.  The arrays B, V, and XY must be aligned to a
- * multiple of 64 bytes.
+ * multiple of 64 bytes.  If ${cancel} is not NULL, give up early, leaving B
+ * undefined, once *${cancel} becomes nonzero.
  */
-void crypto_scrypt_smix(uint8_t *, size_t, uint64_t, void *, void *);
+void crypto_scrypt_smix(uint8_t *, size_t, uint64_t, void *, void *,
+    const volatile int *);
 
 #endif /* !_CRYPTO_SCRYPT_SMIX_H_ */
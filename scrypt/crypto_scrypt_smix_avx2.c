@@ -0,0 +1,260 @@
+/*-
+ * Copyright 2009 Colin Percival
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file was originally written by Colin Percival as part of the Tarsnap
+ * online backup system.
+ */
+#include <immintrin.h>
+#include <stdint.h>
+
+#include "sysendian.h"
+
+#include "crypto_scrypt_smix_avx2.h"
+
+/*
+ * The kernel is compiled for AVX2 with function attributes so that the rest
+ * of the program keeps its baseline instruction set; selectsmix() only uses
+ * it after checking CPUID.
+ */
+#define AVX2_FN __attribute__((target("avx2")))
+#define AVX2_INLINE static inline __attribute__((always_inline, target("avx2")))
+
+/*
+ * A single BlockMix stream is sequential, so the salsa20/8 core stays 128
+ * bits wide.  The gain over the SSE2 kernel comes from keeping X in
+ * registers across a whole BlockMix, from folding the V_j xor into the
+ * BlockMix input loads (256 bits at a time) and from writing the first
+ * loop's BlockMix output straight into V instead of copying it there.
+ */
+
+#define SALSA_ROUND(A, B, C, D, T)				\
+	T = _mm_add_epi32(A, D);				\
+	B = _mm_xor_si128(B, _mm_slli_epi32(T, 7));		\
+	B = _mm_xor_si128(B, _mm_srli_epi32(T, 25));		\
+	T = _mm_add_epi32(B, A);				\
+	C = _mm_xor_si128(C, _mm_slli_epi32(T, 9));		\
+	C = _mm_xor_si128(C, _mm_srli_epi32(T, 23));		\
+	T = _mm_add_epi32(C, B);				\
+	D = _mm_xor_si128(D, _mm_slli_epi32(T, 13));		\
+	D = _mm_xor_si128(D, _mm_srli_epi32(T, 19));		\
+	T = _mm_add_epi32(D, C);				\
+	A = _mm_xor_si128(A, _mm_slli_epi32(T, 18));		\
+	A = _mm_xor_si128(A, _mm_srli_epi32(T, 14));
+
+/**
+ * salsa20_8(X0, X1, X2, X3):
+ * Apply the salsa20/8 core to the block held in X0 .. X3.
+ */
+AVX2_INLINE void
+salsa20_8(__m128i * X0, __m128i * X1, __m128i * X2, __m128i * X3)
+{
+	__m128i Y0 = *X0, Y1 = *X1, Y2 = *X2, Y3 = *X3;
+	__m128i T;
+	size_t i;
+
+	for (i = 0; i < 8; i += 2) {
+		/* Operate on "columns". */
+		SALSA_ROUND(Y0, Y1, Y2, Y3, T);
+
+		/* Rearrange data. */
+		Y1 = _mm_shuffle_epi32(Y1, 0x93);
+		Y2 = _mm_shuffle_epi32(Y2, 0x4E);
+		Y3 = _mm_shuffle_epi32(Y3, 0x39);
+
+		/* Operate on "rows". */
+		SALSA_ROUND(Y0, Y3, Y2, Y1, T);
+
+		/* Rearrange data. */
+		Y1 = _mm_shuffle_epi32(Y1, 0x39);
+		Y2 = _mm_shuffle_epi32(Y2, 0x4E);
+		Y3 = _mm_shuffle_epi32(Y3, 0x93);
+	}
+
+	*X0 = _mm_add_epi32(*X0, Y0);
+	*X1 = _mm_add_epi32(*X1, Y1);
+	*X2 = _mm_add_epi32(*X2, Y2);
+	*X3 = _mm_add_epi32(*X3, Y3);
+}
+
+/**
+ * load_block(B, V, withV, acc, X0, X1, X2, X3):
+ * Load the 64 byte block B, xored with V when ${withV} is set, into
+ * X0 .. X3, or xor it into them when ${acc} is set.
+ */
+AVX2_INLINE void
+load_block(const __m128i * B, const __m128i * V, int withV, int acc,
+    __m128i * X0, __m128i * X1, __m128i * X2, __m128i * X3)
+{
+	__m256i T01 = _mm256_load_si256((const __m256i *)&B[0]);
+	__m256i T23 = _mm256_load_si256((const __m256i *)&B[2]);
+
+	if (withV) {
+		T01 = _mm256_xor_si256(T01,
+		    _mm256_load_si256((const __m256i *)&V[0]));
+		T23 = _mm256_xor_si256(T23,
+		    _mm256_load_si256((const __m256i *)&V[2]));
+	}
+	if (acc) {
+		*X0 = _mm_xor_si128(*X0, _mm256_castsi256_si128(T01));
+		*X1 = _mm_xor_si128(*X1, _mm256_extracti128_si256(T01, 1));
+		*X2 = _mm_xor_si128(*X2, _mm256_castsi256_si128(T23));
+		*X3 = _mm_xor_si128(*X3, _mm256_extracti128_si256(T23, 1));
+	} else {
+		*X0 = _mm256_castsi256_si128(T01);
+		*X1 = _mm256_extracti128_si256(T01, 1);
+		*X2 = _mm256_castsi256_si128(T23);
+		*X3 = _mm256_extracti128_si256(T23, 1);
+	}
+}
+
+AVX2_INLINE void
+store_block(__m128i * B, __m128i X0, __m128i X1, __m128i X2, __m128i X3)
+{
+
+	_mm256_store_si256((__m256i *)&B[0],
+	    _mm256_inserti128_si256(_mm256_castsi128_si256(X0), X1, 1));
+	_mm256_store_si256((__m256i *)&B[2],
+	    _mm256_inserti128_si256(_mm256_castsi128_si256(X2), X3, 1));
+}
+
+/**
+ * blockmix_salsa8(Bin, V, Bout, r, withV):
+ * Compute Bout = BlockMix_{salsa20/8, r}(Bin), or of (Bin \xor V) when
+ * ${withV} is set.  Bin, V and Bout must be 128r bytes in length.
+ */
+AVX2_INLINE void
+blockmix_salsa8(const __m128i * Bin, const __m128i * V, __m128i * Bout,
+    size_t r, int withV)
+{
+	__m128i X0, X1, X2, X3;
+	size_t i;
+
+	/* 1: X <-- B_{2r - 1} */
+	load_block(&Bin[8 * r - 4], &V[8 * r - 4], withV, 0, &X0, &X1, &X2, &X3);
+
+	/* 2: for i = 0 to 2r - 1 do */
+	for (i = 0; i < r; i++) {
+		/* 3: X <-- H(X \xor B_i) */
+		load_block(&Bin[i * 8], &V[i * 8], withV, 1, &X0, &X1, &X2, &X3);
+		salsa20_8(&X0, &X1, &X2, &X3);
+
+		/* 4: Y_i <-- X */
+		/* 6: B' <-- (Y_0, Y_2 ... Y_{2r-2}, Y_1, Y_3 ... Y_{2r-1}) */
+		store_block(&Bout[i * 4], X0, X1, X2, X3);
+
+		/* 3: X <-- H(X \xor B_i) */
+		load_block(&Bin[i * 8 + 4], &V[i * 8 + 4], withV, 1,
+		    &X0, &X1, &X2, &X3);
+		salsa20_8(&X0, &X1, &X2, &X3);
+
+		/* 4: Y_i <-- X */
+		/* 6: B' <-- (Y_0, Y_2 ... Y_{2r-2}, Y_1, Y_3 ... Y_{2r-1}) */
+		store_block(&Bout[(r + i) * 4], X0, X1, X2, X3);
+	}
+}
+
+/**
+ * integerify(B, r):
+ * Return the result of parsing B_{2r-1} as a little-endian integer.
+ */
+static inline uint64_t
+integerify(const void * B, size_t r)
+{
+	const uint32_t * X = (const void *)((uintptr_t)(B) + (2 * r - 1) * 64);
+
+	return (((uint64_t)(X[13]) << 32) + X[0]);
+}
+
+/**
+ * crypto_scrypt_smix_avx2(B, r, N, V, XY, cancel):
+ * Compute B = SMix_r(B, N).  The input B must be 128r bytes in length;
+ * the temporary storage V must be 128rN bytes in length; the temporary
+ * storage XY must be 256r + 64 bytes in length.  The value N must be a
+ * power of 2 greater than 1.  The arrays B, V, and XY must be aligned to a
+ * multiple of 64 bytes.  If ${cancel} is not NULL, give up early, leaving B
+ * undefined, once *${cancel} becomes nonzero.
+ *
+ * Use AVX2 instructions.
+ */
+AVX2_FN void
+crypto_scrypt_smix_avx2(uint8_t * B, size_t r, uint64_t N, void * _V, void * XY,
+    const volatile int * cancel)
+{
+	__m128i * X = XY;
+	__m128i * Y = (void *)((uintptr_t)(XY) + 128 * r);
+	__m128i * V = _V;
+	uint32_t * V32 = _V;
+	uint32_t * X32 = (void *)X;
+	size_t s = 8 * r;
+	uint64_t i, j;
+	size_t k;
+
+	/* 1: X <-- B */
+	/* 3: V_0 <-- X */
+	for (k = 0; k < 2 * r; k++) {
+		for (i = 0; i < 16; i++) {
+			V32[k * 16 + i] =
+			    le32dec(&B[(k * 16 + (i * 5 % 16)) * 4]);
+		}
+	}
+
+	/* 2: for i = 0 to N - 1 do */
+	for (i = 0; i < N - 1; i++) {
+		if ((cancel != NULL) && *cancel)
+			return;
+
+		/* 4: X <-- H(X) */
+		/* 3: V_{i+1} <-- X */
+		blockmix_salsa8(&V[i * s], &V[i * s], &V[(i + 1) * s], r, 0);
+	}
+	/* 4: X <-- H(X) */
+	blockmix_salsa8(&V[(N - 1) * s], &V[(N - 1) * s], X, r, 0);
+
+	/* 6: for i = 0 to N - 1 do */
+	for (i = 0; i < N; i += 2) {
+		if ((cancel != NULL) && *cancel)
+			return;
+
+		/* 7: j <-- Integerify(X) mod N */
+		j = integerify(X, r) & (N - 1);
+
+		/* 8: X <-- H(X \xor V_j) */
+		blockmix_salsa8(X, &V[j * s], Y, r, 1);
+
+		/* 7: j <-- Integerify(X) mod N */
+		j = integerify(Y, r) & (N - 1);
+
+		/* 8: X <-- H(X \xor V_j) */
+		blockmix_salsa8(Y, &V[j * s], X, r, 1);
+	}
+
+	/* 10: B' <-- X */
+	for (k = 0; k < 2 * r; k++) {
+		for (i = 0; i < 16; i++) {
+			le32enc(&B[(k * 16 + (i * 5 % 16)) * 4],
+			    X32[k * 16 + i]);
+		}
+	}
+}
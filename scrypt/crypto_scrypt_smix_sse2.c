@@ -175,17 +175,19 @@ integerify(const void * B, size_t r)
 }
 
 /**
- * crypto_scrypt_smix_sse2(B, r, N, V, XY):
+ * crypto_scrypt_smix_sse2(B, r, N, V, XY, cancel):
  * Compute B = SMix_r(B, N).  The input B must be 128r bytes in length;
  * the temporary storage V must be 128rN bytes in length; the temporary
  * storage XY must be 256r + 64 bytes in length.  The value N must be a
  * power of 2 greater than 1.  The arrays B, V, and XY must be aligned to a
- * multiple of 64 bytes.
+ * multiple of 64 bytes.  If ${cancel} is not NULL, give up early, leaving B
+ * undefined, once *${cancel} becomes nonzero.
  *
  * Use SSE2 instructions.
  */
 void
-crypto_scrypt_smix_sse2(uint8_t * B, size_t r, uint64_t N, void * V, void * XY)
+crypto_scrypt_smix_sse2(uint8_t * B, size_t r, uint64_t N, void * V, void * XY,
+    const volatile int * cancel)
 {
 	__m128i * X = XY;
 	__m128i * Y = (void *)((uintptr_t)(XY) + 128 * r);
@@ -204,6 +206,9 @@ crypto_scrypt_smix_sse2(uint8_t * B, size_t r, uint64_t N, void * V, void * XY)
 
 	/* 2: for i = 0 to N - 1 do */
 	for (i = 0; i < N; i += 2) {
+		if ((cancel != NULL) && *cancel)
+			return;
+
 		/* 3: V_i <-- X */
 		blkcpy((void *)((uintptr_t)(V) + i * 128 * r), X, 128 * r);
 
@@ -220,6 +225,9 @@ crypto_scrypt_smix_sse2(uint8_t * B, size_t r, uint64_t N, void * V, void * XY)
 
 	/* 6: for i = 0 to N - 1 do */
 	for (i = 0; i < N; i += 2) {
+		if ((cancel != NULL) && *cancel)
+			return;
+
 		/* 7: j <-- Integerify(X) mod N */
 		j = integerify(X, r) & (N - 1);
 
@@ -8,9 +8,16 @@ static void
 insecure_memzero_func(volatile void * buf, size_t len)
 {
 	volatile uint8_t * _buf = buf;
+	volatile uint64_t * _wbuf;
 	size_t i;
 
-	for (i = 0; i < len; i++)
+	/* Zero up to an 8-byte boundary, then a word at a time. */
+	for (i = 0; i < len && ((uintptr_t)&_buf[i] & 7) != 0; i++)
+		_buf[i] = 0;
+	_wbuf = (volatile uint64_t *)&_buf[i];
+	for (; len - i >= 8; i += 8)
+		*_wbuf++ = 0;
+	for (; i < len; i++)
 		_buf[i] = 0;
 }
 
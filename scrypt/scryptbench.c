@@ -0,0 +1,84 @@
+/*
+ * scryptbench: time complete scrypt derivations over a grid of N, r and p
+ * and report the parameters crypto_scrypt_calibrate picks for an unlock-time
+ * budget.  Build from this directory with, e.g.
+ *
+ *   cc -O2 -DUSE_SSE -msse2 -pthread -o scryptbench scryptbench.c \
+ *       crypto_scrypt_calibrate.c crypto_scrypt.c crypto_scrypt_smix.c \
+ *       crypto_scrypt_smix_sse2.c crypto_scrypt_smix_avx2.c sha256.c \
+ *       insecure_memzero.c warnp.c
+ *
+ * and run as "scryptbench [budget-seconds [max-log2N [max-memory-MiB]]]".
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "crypto_scrypt.h"
+#include "crypto_scrypt_calibrate.h"
+
+static const uint32_t rs[] = { 8, 16, 32 };
+static const uint32_t ps[] = { 1, 2, 4 };
+
+#define NELEM(x) (sizeof(x) / sizeof(x[0]))
+
+int
+main(int argc, char * argv[])
+{
+	double budget = (argc > 1) ? atof(argv[1]) : 2.0;
+	int maxlogN = (argc > 2) ? atoi(argv[2]) : 16;
+	size_t maxmem = (size_t)((argc > 3) ? atol(argv[3]) : 1024) << 20;
+	struct crypto_scrypt_arena * arena;
+	double t;
+	size_t i, j;
+	int logN;
+	uint32_t p;
+
+	if ((budget <= 0) || (maxlogN < 10) || (maxlogN > 30) || (maxmem == 0)) {
+		fprintf(stderr, "usage: scryptbench [budget-seconds "
+		    "[max-log2N [max-memory-MiB]]]\n");
+		return (1);
+	}
+	if ((arena = crypto_scrypt_arena_init()) == NULL) {
+		fprintf(stderr, "out of memory\n");
+		return (1);
+	}
+
+	printf("%6s %4s %4s %10s %12s\n", "log2N", "r", "p", "MiB/lane",
+	    "ms");
+	for (logN = 10; logN <= maxlogN; logN += 2) {
+		for (i = 0; i < NELEM(rs); i++) {
+			if ((((uint64_t)128 * rs[i]) << logN) > maxmem)
+				continue;
+			for (j = 0; j < NELEM(ps); j++) {
+				if (crypto_scrypt_bench(arena, logN, rs[i], ps[j],
+				    &t)) {
+					fprintf(stderr, "derivation failed\n");
+					goto err;
+				}
+				printf("%6d %4u %4u %10.1f %12.2f\n", logN, rs[i],
+				    ps[j], (double)(((uint64_t)128 * rs[i]) << logN)
+				    / (1 << 20), t * 1000);
+			}
+		}
+	}
+
+	logN = 12;
+	if (crypto_scrypt_calibrate(arena, budget, maxmem, 8, &logN, &p)) {
+		fprintf(stderr, "calibration failed\n");
+		goto err;
+	}
+	if (crypto_scrypt_bench(arena, logN, 8, p, &t)) {
+		fprintf(stderr, "derivation failed\n");
+		goto err;
+	}
+	printf("\n%.2f s budget: log2N = %d, r = 8, p = %u (%.2f ms)\n",
+	    budget, logN, p, t * 1000);
+
+	crypto_scrypt_arena_free(arena);
+	return (0);
+
+err:
+	crypto_scrypt_arena_free(arena);
+	return (1);
+}
@@ -0,0 +1,114 @@
+/*
+ * smixbench: time the scalar, SSE2 and AVX2 smix kernels at the client's
+ * default scrypt parameters (N = 4096, r = 32, p = 1) and check that they
+ * agree.  Build from this directory with, e.g.
+ *
+ *   cc -O2 -DUSE_SSE -msse2 -o smixbench smixbench.c crypto_scrypt_smix.c \
+ *       crypto_scrypt_smix_sse2.c crypto_scrypt_smix_avx2.c
+ *
+ * and run as "smixbench [N [r [iterations]]]".
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "crypto_scrypt_smix.h"
+#ifdef USE_SSE
+#include "crypto_scrypt_smix_sse2.h"
+#include "crypto_scrypt_smix_avx2.h"
+#endif
+
+typedef void (*smix_fn)(uint8_t *, size_t, uint64_t, void *, void *,
+    const volatile int *);
+
+static struct kernel {
+	const char * name;
+	smix_fn smix;
+	int supported;
+} kernels[] = {
+	{ "scalar", crypto_scrypt_smix, 1 },
+#ifdef USE_SSE
+	{ "sse2", crypto_scrypt_smix_sse2, 1 },
+	{ "avx2", crypto_scrypt_smix_avx2, 0 },
+#endif
+};
+
+#define NKERNELS (sizeof(kernels) / sizeof(kernels[0]))
+
+static double
+now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (ts.tv_sec + ts.tv_nsec / 1e9);
+}
+
+int
+main(int argc, char * argv[])
+{
+	uint64_t N = (argc > 1) ? strtoull(argv[1], NULL, 0) : 4096;
+	size_t r = (argc > 2) ? strtoul(argv[2], NULL, 0) : 32;
+	int iterations = (argc > 3) ? atoi(argv[3]) : 10;
+	uint8_t * B, * B0, * ref;
+	void * V, * XY;
+	size_t i;
+	int j, rc = 0;
+
+	if ((N < 2) || (N & (N - 1)) || (r == 0) || (iterations < 1)) {
+		fprintf(stderr, "usage: smixbench [N [r [iterations]]]\n");
+		return (1);
+	}
+#ifdef USE_SSE
+	__builtin_cpu_init();
+	kernels[2].supported = __builtin_cpu_supports("avx2");
+#endif
+
+	if (posix_memalign((void **)&B, 64, 128 * r) ||
+	    posix_memalign((void **)&B0, 64, 128 * r) ||
+	    posix_memalign((void **)&ref, 64, 128 * r) ||
+	    posix_memalign(&V, 64, 128 * r * N) ||
+	    posix_memalign(&XY, 64, 256 * r + 64)) {
+		fprintf(stderr, "out of memory\n");
+		return (1);
+	}
+	for (i = 0; i < 128 * r; i++)
+		B0[i] = (uint8_t)(i * 131 + 7);
+
+	printf("N = %llu, r = %zu, %d iterations\n",
+	    (unsigned long long)N, r, iterations);
+	for (i = 0; i < NKERNELS; i++) {
+		double t, best = 0;
+
+		if (!kernels[i].supported) {
+			printf("%-8s unsupported on this CPU\n", kernels[i].name);
+			continue;
+		}
+		for (j = 0; j < iterations; j++) {
+			memcpy(B, B0, 128 * r);
+			t = now();
+			kernels[i].smix(B, r, N, V, XY, NULL);
+			t = now() - t;
+			if ((j == 0) || (t < best))
+				best = t;
+		}
+		if (i == 0) {
+			memcpy(ref, B, 128 * r);
+		} else if (memcmp(ref, B, 128 * r)) {
+			printf("%-8s MISMATCH\n", kernels[i].name);
+			rc = 1;
+			continue;
+		}
+		printf("%-8s %8.2f ms (best of %d)\n", kernels[i].name,
+		    best * 1000, iterations);
+	}
+
+	free(XY);
+	free(V);
+	free(ref);
+	free(B0);
+	free(B);
+	return (rc);
+}